@@ -20,19 +20,96 @@ DEPENDPATH += $$PWD/ffmpeg/include
 INCLUDEPATH += $$PWD/zmq/include
 LIBS += -L$$PWD/zmq/lib -llibzmq-v140-mt-4_3_4
 
+# 进程内存采样
+win32: LIBS += -lpsapi
+
+# 共享内存导出
+unix:!mac: LIBS += -lrt
+
 SOURCES += \
+    alarmevent.cpp \
+    alarmlogmodel.cpp \
+    alarmratelimiter.cpp \
+    alarmrules.cpp \
+    alarmsearchdialog.cpp \
+    alarmsearchindex.cpp \
+    alarmsnapshotdecoder.cpp \
+    alarmstore.cpp \
+    appconfig.cpp \
+    clienttelemetry.cpp \
+    clipexporter.cpp \
+    framebus.cpp \
+    frameconverter.cpp \
+    frameexporter.cpp \
+    frameexportmanager.cpp \
+    framesampler.cpp \
+    gopcache.cpp \
+    headlessservice.cpp \
+    instantreplayplayer.cpp \
     main.cpp \
     mainwindow.cpp \
     msgClient.cpp \
+    packetring.cpp \
+    recordingindex.cpp \
+    recordingmanager.cpp \
+    recordingplaybackdialog.cpp \
+    recordingplayer.cpp \
+    restreamserver.cpp \
+    samplingmanager.cpp \
+    segmentrecorder.cpp \
+    sharedframering.cpp \
+    snapshotwriter.cpp \
     streamPlayer.cpp \
+    streamcopymuxer.cpp \
+    streamhub.cpp \
     streamlistwidget.cpp \
+    syncplayback.cpp \
+    syncplaybackdialog.cpp \
+    timelapsejob.cpp \
     videoplayerwidget.cpp
 
 HEADERS += \
+    alarmevent.h \
+    alarmlogmodel.h \
+    alarmratelimiter.h \
+    alarmrules.h \
+    alarmsearchdialog.h \
+    alarmsearchindex.h \
+    alarmsnapshotdecoder.h \
+    alarmstore.h \
+    appconfig.h \
+    clienttelemetry.h \
+    clipexporter.h \
+    framebus.h \
+    frameconverter.h \
+    frameexporter.h \
+    frameexportmanager.h \
+    framesampler.h \
+    framesink.h \
+    gopcache.h \
+    headlessservice.h \
+    instantreplayplayer.h \
     mainwindow.h \
     msgClient.hpp \
+    packetring.h \
+    packetsink.h \
+    playbackpacing.h \
+    recordingindex.h \
+    recordingmanager.h \
+    recordingplaybackdialog.h \
+    recordingplayer.h \
+    restreamserver.h \
+    samplingmanager.h \
+    segmentrecorder.h \
+    sharedframering.h \
+    snapshotwriter.h \
     streamPlayer.h \
+    streamcopymuxer.h \
+    streamhub.h \
     streamlistwidget.h \
+    syncplayback.h \
+    syncplaybackdialog.h \
+    timelapsejob.h \
     videoplayerwidget.h
 
 LIBS += -L$$PWD/ffmpeg/lib/     			\
@@ -0,0 +1,250 @@
+#include "alarmevent.h"
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <cstring>
+
+namespace {
+
+const char BINARY_MAGIC[] = "SHAB";
+const int BINARY_MAGIC_SIZE = 4;
+const int BINARY_VERSION = 1;
+const int BINARY_HEADER_SIZE = 14;
+
+// 二进制格式的只读游标，越界后ok置为false，后续读取都返回0
+class BinaryReader
+{
+public:
+    BinaryReader(const char *data, int size)
+        : m_pos(reinterpret_cast<const uchar *>(data))
+        , m_end(m_pos + size)
+        , m_ok(true) {}
+
+    bool ok() const { return m_ok; }
+
+    quint64 varint()
+    {
+        quint64 value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (m_pos >= m_end) {
+                break;
+            }
+            uchar byte = *m_pos++;
+            value |= quint64(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        m_ok = false;
+        return 0;
+    }
+
+    qint64 zigzag()
+    {
+        quint64 value = varint();
+        return qint64(value >> 1) ^ -qint64(value & 1);
+    }
+
+    const char *bytes(quint64 size)
+    {
+        if (!m_ok || size > quint64(m_end - m_pos)) {
+            m_ok = false;
+            return nullptr;
+        }
+        const char *data = reinterpret_cast<const char *>(m_pos);
+        m_pos += size;
+        return data;
+    }
+
+private:
+    const uchar *m_pos;
+    const uchar *m_end;
+    bool m_ok;
+};
+
+AlarmEvent fromBinary(const QByteArray &data)
+{
+    AlarmEvent event;
+    event.raw = QByteArray(data.constData(), data.size());
+    event.binary = true;
+
+    const uchar *header = reinterpret_cast<const uchar *>(data.constData());
+    int version = header[BINARY_MAGIC_SIZE];
+    if (version != BINARY_VERSION) {
+        event.text = QString("不支持的报警格式版本: %1").arg(version);
+        event.timestamp = QDateTime::currentMSecsSinceEpoch();
+        return event;
+    }
+
+    // 先按无符号拼接，避免移位进入符号位
+    quint64 rawTimestamp = 0;
+    for (int i = 0; i < 8; ++i) {
+        rawTimestamp |= quint64(header[6 + i]) << (8 * i);
+    }
+    qint64 timestamp = qint64(rawTimestamp);
+    event.timestamp = timestamp > 0 ? timestamp : QDateTime::currentMSecsSinceEpoch();
+
+    BinaryReader reader(data.constData() + BINARY_HEADER_SIZE, data.size() - BINARY_HEADER_SIZE);
+    quint64 count = reader.varint();
+    QVector<QString> strings;
+    strings.reserve(int(qMin<quint64>(count, 64)));
+    for (quint64 i = 0; i < count && reader.ok(); ++i) {
+        quint64 size = reader.varint();
+        const char *bytes = reader.bytes(size);
+        strings.append(QString::fromUtf8(bytes, int(size)));
+    }
+
+    auto stringAt = [&](quint64 index) {
+        return index > 0 && index <= quint64(strings.size()) ? strings.at(int(index - 1)) : QString();
+    };
+    event.id = stringAt(reader.varint());
+    event.streamId = stringAt(reader.varint());
+    event.type = stringAt(reader.varint());
+    QString message = stringAt(reader.varint());
+    event.message = message;
+
+    quint64 boxCount = reader.varint();
+    for (quint64 i = 0; i < boxCount && reader.ok(); ++i) {
+        int x = int(reader.zigzag());
+        int y = int(reader.zigzag());
+        int w = int(reader.zigzag());
+        int h = int(reader.zigzag());
+        QRect rect(x, y, w, h);
+        if (reader.ok() && rect.isValid()) {
+            event.boxes.append(rect);
+        }
+    }
+
+    if (!reader.ok()) {
+        event.text = "报警消息格式错误";
+        return event;
+    }
+    if (message.isEmpty()) {
+        event.text = event.type;
+    } else if (event.type.isEmpty()) {
+        event.text = message;
+    } else {
+        event.text = QString("%1: %2").arg(event.type, message);
+    }
+    return event;
+}
+
+// 兼容秒、毫秒和ISO时间字符串
+qint64 parseTimestamp(const QJsonValue &value)
+{
+    if (value.isDouble()) {
+        double ts = value.toDouble();
+        return ts < 1e11 ? qint64(ts * 1000.0) : qint64(ts);
+    }
+    if (value.isString()) {
+        QDateTime dt = QDateTime::fromString(value.toString(), Qt::ISODate);
+        if (dt.isValid()) {
+            return dt.toMSecsSinceEpoch();
+        }
+    }
+    return 0;
+}
+
+// 目标框支持[x, y, w, h]和{"x":..,"y":..,"w":..,"h":..}两种写法
+QRect parseBox(const QJsonValue &value)
+{
+    if (value.isArray()) {
+        QJsonArray arr = value.toArray();
+        if (arr.size() >= 4) {
+            return QRect(arr.at(0).toInt(), arr.at(1).toInt(), arr.at(2).toInt(), arr.at(3).toInt());
+        }
+    } else if (value.isObject()) {
+        QJsonObject obj = value.toObject();
+        return QRect(obj.value("x").toInt(), obj.value("y").toInt(),
+                     obj.value("w").toInt(), obj.value("h").toInt());
+    }
+    return QRect();
+}
+
+}
+
+bool AlarmEvent::isBinaryMessage(const QByteArray &data)
+{
+    return data.size() >= BINARY_HEADER_SIZE
+        && memcmp(data.constData(), BINARY_MAGIC, BINARY_MAGIC_SIZE) == 0;
+}
+
+AlarmEvent AlarmEvent::fromMessage(const QByteArray &data)
+{
+    if (isBinaryMessage(data)) {
+        return fromBinary(data);
+    }
+
+    AlarmEvent event;
+    event.raw = QByteArray(data.constData(), data.size());
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+    if (error.error != QJsonParseError::NoError || !doc.isObject()) {
+        // 旧格式的纯文本报警
+        event.text = QString::fromUtf8(data);
+        event.timestamp = QDateTime::currentMSecsSinceEpoch();
+        return event;
+    }
+
+    QJsonObject obj = doc.object();
+    event.id = obj.value("id").toString();
+    event.streamId = obj.contains("stream_id") ? obj.value("stream_id").toString()
+                                                : obj.value("streamId").toString();
+    event.type = obj.value("type").toString();
+    event.timestamp = parseTimestamp(obj.value("timestamp"));
+    if (event.timestamp <= 0) {
+        event.timestamp = QDateTime::currentMSecsSinceEpoch();
+    }
+
+    const QJsonArray boxes = obj.value("boxes").toArray();
+    for (const QJsonValue &box : boxes) {
+        QRect rect = parseBox(box);
+        if (rect.isValid()) {
+            event.boxes.append(rect);
+        }
+    }
+
+    QString message = obj.contains("message") ? obj.value("message").toString()
+                                               : obj.value("msg").toString();
+    event.message = message;
+    if (message.isEmpty()) {
+        event.text = event.type.isEmpty() ? QString::fromUtf8(data) : event.type;
+    } else if (event.type.isEmpty()) {
+        event.text = message;
+    } else {
+        event.text = QString("%1: %2").arg(event.type, message);
+    }
+
+    return event;
+}
+
+QByteArray AlarmEvent::toJson() const
+{
+    QJsonObject obj;
+    if (!id.isEmpty()) {
+        obj["id"] = id;
+    }
+    if (!streamId.isEmpty()) {
+        obj["stream_id"] = streamId;
+    }
+    if (!type.isEmpty()) {
+        obj["type"] = type;
+    }
+    obj["timestamp"] = double(timestamp);
+    // 写原始描述，text带有类型前缀，重新解析时会再加一次；没有描述和类型时（例如格式错误）保留显示文本
+    QString description = message.isEmpty() && type.isEmpty() ? text : message;
+    if (!description.isEmpty()) {
+        obj["message"] = description;
+    }
+    if (!boxes.isEmpty()) {
+        QJsonArray arr;
+        for (const QRect &box : boxes) {
+            arr.append(QJsonArray{box.x(), box.y(), box.width(), box.height()});
+        }
+        obj["boxes"] = arr;
+    }
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact);
+}
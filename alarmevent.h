@@ -0,0 +1,59 @@
+#ifndef ALARMEVENT_H
+#define ALARMEVENT_H
+
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+#include <QRect>
+#include <QByteArray>
+
+// 解析后的报警消息
+// 服务端JSON格式：
+// {"id": "...", "stream_id": "...", "type": "intrusion", "timestamp": 1700000000000,
+//  "message": "...", "boxes": [[x, y, w, h], ...]}
+// 非JSON消息整体作为文本，stream_id为空表示不属于任何流
+// 报警内容后面可以再跟一帧JPEG抓拍图：[alarm/<流ID>/][报警内容][JPEG]
+//
+// 也可使用紧凑的二进制格式（整数均为小端，varint为LEB128）：
+//   0   魔数 "SHAB"
+//   4   u8 版本号，当前为1
+//   5   u8 标志，保留为0
+//   6   i64 毫秒时间戳，0表示取接收时间
+//   14  varint 字符串表条数N，随后N个 [varint 长度][UTF-8字节]
+//       varint id、stream_id、type、message 在字符串表中的序号+1，0表示缺省
+//       varint 目标框个数，每个框4个zigzag varint：x, y, w, h
+// 相同的字符串在表中只出现一次。解析直接读取接收缓冲区，不经过JSON。
+struct AlarmEvent
+{
+    // 报警规则命中后的处理动作
+    enum Action {
+        Hidden = 0x1,           // 只记录不显示
+        Sound = 0x2,            // 播放提示音
+        Highlight = 0x4         // 高亮显示
+    };
+
+    QString id;                 // 报警ID，可选
+    QString streamId;           // 所属流ID
+    QString type;               // 报警类型
+    qint64 timestamp = 0;       // 毫秒时间戳，消息未携带时取接收时间
+    QVector<QRect> boxes;       // 目标框，可选
+    QString message;            // 消息中的报警描述，不含类型前缀
+    QString text;               // 显示文本
+    QByteArray raw;             // 原始消息
+    bool binary = false;        // raw为二进制格式
+    QByteArray snapshot;        // 触发报警的画面（JPEG），可选
+
+    quint32 actions = 0;        // Action组合，由报警规则填写
+    QString sound;              // 提示音文件，为空时使用系统提示音
+
+    // data可以是引用接收缓冲区的fromRawData，raw会另行拷贝
+    static AlarmEvent fromMessage(const QByteArray &data);
+    static bool isBinaryMessage(const QByteArray &data);
+    
+    // 以JSON格式输出，用于保存二进制格式的报警
+    QByteArray toJson() const;
+};
+
+Q_DECLARE_METATYPE(AlarmEvent)
+
+#endif // ALARMEVENT_H
@@ -0,0 +1,123 @@
+#include "alarmlogmodel.h"
+#include <QDateTime>
+#include <QColor>
+
+AlarmLogModel::AlarmLogModel(int capacity, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_capacity(qMax(1, capacity))
+    , m_head(0)
+    , m_count(0)
+    , m_nextSerial(1)
+    , m_rowHeight(0)
+{
+    m_entries.resize(m_capacity);
+}
+
+int AlarmLogModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_count;
+}
+
+int AlarmLogModel::slotForRow(int row) const
+{
+    // 第0行是最近写入的条目，即m_head的前一个位置
+    return (m_head - 1 - row + m_capacity) % m_capacity;
+}
+
+QVariant AlarmLogModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_count) {
+        return QVariant();
+    }
+
+    const AlarmLogEntry &entry = m_entries.at(slotForRow(index.row()));
+    switch (role) {
+    case Qt::DisplayRole: {
+        QString timeStr = QDateTime::fromMSecsSinceEpoch(entry.timestamp).toString("hh:mm:ss");
+        return QString("[%1] %2").arg(timeStr, entry.text);
+    }
+    case Qt::ToolTipRole:
+        return QString("[%1] %2")
+            .arg(QDateTime::fromMSecsSinceEpoch(entry.timestamp).toString("yyyy-MM-dd hh:mm:ss"), entry.text);
+    case Qt::ForegroundRole:
+        return entry.highlight ? QVariant(QColor("#FF5252")) : QVariant();
+    case Qt::DecorationRole:
+        return entry.thumbnail.isNull() ? QVariant() : QVariant(entry.thumbnail);
+    case Qt::SizeHintRole:
+        return m_rowHeight > 0 ? QVariant(QSize(1, m_rowHeight)) : QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+void AlarmLogModel::setCapacity(int capacity)
+{
+    capacity = qMax(1, capacity);
+    if (capacity == m_capacity) {
+        return;
+    }
+
+    beginResetModel();
+
+    // 按从新到旧的顺序保留最新的条目
+    int keep = qMin(m_count, capacity);
+    QVector<AlarmLogEntry> entries(capacity);
+    for (int row = 0; row < keep; ++row) {
+        entries[keep - 1 - row] = m_entries.at(slotForRow(row));
+    }
+
+    m_entries = entries;
+    m_capacity = capacity;
+    m_count = keep;
+    m_head = keep % capacity;
+
+    endResetModel();
+}
+
+quint64 AlarmLogModel::addMessage(const QString &text, qint64 timestamp, bool highlight)
+{
+    // 缓冲区已满时先淘汰最旧的一条（最后一行）
+    if (m_count == m_capacity) {
+        beginRemoveRows(QModelIndex(), m_count - 1, m_count - 1);
+        --m_count;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), 0, 0);
+    AlarmLogEntry &entry = m_entries[m_head];
+    entry.timestamp = timestamp;
+    entry.text = text;
+    entry.highlight = highlight;
+    entry.serial = m_nextSerial++;
+    entry.thumbnail = QImage();
+    m_head = (m_head + 1) % m_capacity;
+    ++m_count;
+    endInsertRows();
+    return entry.serial;
+}
+
+void AlarmLogModel::setThumbnail(quint64 serial, const QImage &thumbnail)
+{
+    // 编号连续，由编号直接算出行号
+    quint64 newest = m_nextSerial - 1;
+    if (serial == 0 || serial > newest || newest - serial >= quint64(m_count)) {
+        return;
+    }
+    int row = int(newest - serial);
+    AlarmLogEntry &entry = m_entries[slotForRow(row)];
+    if (entry.serial != serial) {
+        return;
+    }
+    entry.thumbnail = thumbnail;
+    QModelIndex idx = index(row);
+    emit dataChanged(idx, idx, QVector<int>() << Qt::DecorationRole);
+}
+
+void AlarmLogModel::clear()
+{
+    beginResetModel();
+    m_entries = QVector<AlarmLogEntry>(m_capacity);
+    m_head = 0;
+    m_count = 0;
+    endResetModel();
+}
@@ -0,0 +1,56 @@
+#ifndef ALARMLOGMODEL_H
+#define ALARMLOGMODEL_H
+
+#include <QAbstractListModel>
+#include <QVector>
+#include <QString>
+#include <QImage>
+#include <QSize>
+
+// 报警日志条目
+struct AlarmLogEntry
+{
+    qint64 timestamp = 0;   // 毫秒时间戳
+    QString text;
+    bool highlight = false; // 由报警规则指定高亮
+    quint64 serial = 0;     // 递增的条目编号，用于异步补充缩略图
+    QImage thumbnail;       // 报警抓拍缩略图，可选
+};
+
+// 基于环形缓冲区的报警日志模型
+// 最新的消息位于第0行，插入和淘汰都是O(1)，不再重建整个文本
+class AlarmLogModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit AlarmLogModel(int capacity = 2000, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    int capacity() const { return m_capacity; }
+    void setCapacity(int capacity);
+
+    // 返回新条目的编号
+    quint64 addMessage(const QString &text, qint64 timestamp, bool highlight = false);
+    void clear();
+
+    // 条目已被淘汰时忽略
+    void setThumbnail(quint64 serial, const QImage &thumbnail);
+
+    // 设置后所有行使用同一高度，以容纳缩略图并保持统一行高
+    void setRowHeight(int height) { m_rowHeight = height; }
+
+private:
+    int slotForRow(int row) const;
+
+    QVector<AlarmLogEntry> m_entries; // 环形缓冲区
+    int m_capacity;
+    int m_head;   // 下一次写入的位置
+    int m_count;  // 当前有效条目数
+    quint64 m_nextSerial;
+    int m_rowHeight;
+};
+
+#endif // ALARMLOGMODEL_H
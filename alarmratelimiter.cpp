@@ -0,0 +1,106 @@
+#include "alarmratelimiter.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+namespace {
+
+// 空闲桶的清理周期
+const qint64 PRUNE_INTERVAL_MS = 60 * 1000;
+
+}
+
+AlarmRateLimiter::AlarmRateLimiter(double ratePerSecond, int burst, qint64 windowMs)
+    : m_ratePerMs(qMax(0.0, ratePerSecond) / 1000.0)
+    , m_burst(qMax(1, burst))
+    , m_windowMs(qMax<qint64>(1000, windowMs))
+    , m_suppressedTotal(0)
+    , m_lastPrune(0)
+{
+}
+
+void AlarmRateLimiter::refill(Bucket &bucket, qint64 nowMs) const
+{
+    if (nowMs > bucket.lastRefill) {
+        bucket.tokens = qMin(m_burst, bucket.tokens + double(nowMs - bucket.lastRefill) * m_ratePerMs);
+        bucket.lastRefill = nowMs;
+    }
+}
+
+bool AlarmRateLimiter::admit(const AlarmEvent &alarm, qint64 nowMs)
+{
+    QString key = alarm.streamId + QChar(0x1F) + alarm.type;
+    auto it = m_buckets.find(key);
+    if (it == m_buckets.end()) {
+        Bucket bucket;
+        bucket.streamId = alarm.streamId;
+        bucket.type = alarm.type;
+        bucket.tokens = m_burst;
+        bucket.lastRefill = nowMs;
+        it = m_buckets.insert(key, bucket);
+    }
+
+    Bucket &bucket = it.value();
+    refill(bucket, nowMs);
+    if (bucket.tokens >= 1.0) {
+        bucket.tokens -= 1.0;
+        return true;
+    }
+
+    if (bucket.windowStart == 0) {
+        bucket.windowStart = nowMs;
+    }
+    bucket.suppressed++;
+    m_suppressedTotal++;
+    return false;
+}
+
+QVector<AlarmEvent> AlarmRateLimiter::takeSummaries(qint64 nowMs)
+{
+    QVector<AlarmEvent> summaries;
+    bool prune = nowMs - m_lastPrune >= PRUNE_INTERVAL_MS;
+
+    for (auto it = m_buckets.begin(); it != m_buckets.end();) {
+        Bucket &bucket = it.value();
+        if (bucket.windowStart != 0 && nowMs - bucket.windowStart >= m_windowMs) {
+            AlarmEvent summary;
+            summary.streamId = bucket.streamId;
+            summary.type = "suppressed";
+            summary.timestamp = nowMs;
+            summary.text = QString("报警风暴抑制: %1 在 %2 秒内抑制 %3 条")
+                               .arg(bucket.type.isEmpty() ? QString("未分类报警") : bucket.type)
+                               .arg((nowMs - bucket.windowStart) / 1000)
+                               .arg(bucket.suppressed);
+
+            QJsonObject obj;
+            obj["stream_id"] = bucket.streamId;
+            obj["type"] = summary.type;
+            obj["suppressed_type"] = bucket.type;
+            obj["count"] = bucket.suppressed;
+            obj["timestamp"] = double(nowMs);
+            obj["message"] = summary.text;
+            summary.raw = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+
+            qDebug() << summary.text << "流:" << bucket.streamId;
+            summaries.append(summary);
+
+            bucket.suppressed = 0;
+            bucket.windowStart = 0;
+        }
+
+        // 定期清理已经回满且不在抑制中的桶，防止键无限增长
+        if (prune && bucket.windowStart == 0) {
+            refill(bucket, nowMs);
+            if (bucket.tokens >= m_burst) {
+                it = m_buckets.erase(it);
+                continue;
+            }
+        }
+        ++it;
+    }
+
+    if (prune) {
+        m_lastPrune = nowMs;
+    }
+    return summaries;
+}
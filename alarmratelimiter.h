@@ -0,0 +1,46 @@
+#ifndef ALARMRATELIMITER_H
+#define ALARMRATELIMITER_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include "alarmevent.h"
+
+// 报警风暴抑制
+// 按(流ID, 报警类型)各维护一个令牌桶，令牌耗尽后的报警被丢弃并计数，
+// 每个抑制窗口结束时生成一条汇总报警。只在单个线程中使用。
+class AlarmRateLimiter
+{
+public:
+    AlarmRateLimiter(double ratePerSecond, int burst, qint64 windowMs);
+
+    // 返回true表示放行
+    bool admit(const AlarmEvent &alarm, qint64 nowMs);
+
+    // 取出已结束的抑制窗口的汇总报警
+    QVector<AlarmEvent> takeSummaries(qint64 nowMs);
+
+    quint64 suppressedTotal() const { return m_suppressedTotal; }
+
+private:
+    struct Bucket
+    {
+        QString streamId;
+        QString type;
+        double tokens = 0.0;
+        qint64 lastRefill = 0;
+        int suppressed = 0;       // 当前窗口内被抑制的条数
+        qint64 windowStart = 0;   // 当前抑制窗口的开始时间，0表示未在抑制
+    };
+
+    void refill(Bucket &bucket, qint64 nowMs) const;
+
+    double m_ratePerMs;
+    double m_burst;
+    qint64 m_windowMs;
+    QHash<QString, Bucket> m_buckets;
+    quint64 m_suppressedTotal;
+    qint64 m_lastPrune;
+};
+
+#endif // ALARMRATELIMITER_H
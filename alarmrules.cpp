@@ -0,0 +1,194 @@
+#include "alarmrules.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QSet>
+#include <QVarLengthArray>
+#include <QtAlgorithms>
+#include <QDebug>
+
+namespace {
+
+// 字段到AlarmEvent成员的映射，求值时直接按成员指针取值
+QString AlarmEvent::* const FIELD_MEMBERS[] = {
+    &AlarmEvent::streamId,
+    &AlarmEvent::type
+};
+
+// 不对应任何取值的符号，放入字段集合后该字段不再是“不限制”，但也不会有报警命中
+const int NO_SYMBOL = -1;
+
+QStringList toStringList(const QJsonValue &value)
+{
+    QStringList list;
+    if (value.isString()) {
+        list.append(value.toString());
+    } else if (value.isArray()) {
+        const QJsonArray arr = value.toArray();
+        for (const QJsonValue &item : arr) {
+            list.append(item.toString());
+        }
+    }
+    return list;
+}
+
+}
+
+int AlarmRuleSet::intern(const QString &value)
+{
+    auto it = m_symbols.constFind(value);
+    if (it != m_symbols.constEnd()) {
+        return it.value();
+    }
+    int symbol = m_symbols.size();
+    m_symbols.insert(value, symbol);
+    return symbol;
+}
+
+int AlarmRuleSet::addRow(const QVector<quint64> &mask)
+{
+    int row = m_rows.size() / m_words;
+    m_rows += mask;
+    return row;
+}
+
+QSharedPointer<AlarmRuleSet> AlarmRuleSet::load(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = QString("无法打开规则文件: %1").arg(path);
+        }
+        return QSharedPointer<AlarmRuleSet>();
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+        if (error) {
+            *error = QString("规则文件格式错误: %1").arg(parseError.errorString());
+        }
+        return QSharedPointer<AlarmRuleSet>();
+    }
+
+    QJsonObject root = doc.object();
+    QSharedPointer<AlarmRuleSet> ruleSet(new AlarmRuleSet());
+
+    // 流分组
+    QHash<QString, QStringList> groups;
+    const QJsonObject groupsObj = root.value("groups").toObject();
+    for (auto it = groupsObj.constBegin(); it != groupsObj.constEnd(); ++it) {
+        groups.insert(it.key(), toStringList(it.value()));
+    }
+
+    // 解析规则，每个字段记录允许的符号集合，空集合表示不限制
+    const QJsonArray rulesArr = root.value("rules").toArray();
+    QVector<QVector<QSet<int> > > allowed;
+    for (const QJsonValue &ruleValue : rulesArr) {
+        QJsonObject ruleObj = ruleValue.toObject();
+        QJsonObject match = ruleObj.value("match").toObject();
+
+        QVector<QSet<int> > fields(FieldCount);
+        for (const QString &value : toStringList(match.value("stream"))) {
+            fields[FieldStream].insert(ruleSet->intern(value));
+        }
+        for (const QString &group : toStringList(match.value("stream_group"))) {
+            // 分组不存在或为空时该分组不匹配任何流，而不是匹配全部流
+            fields[FieldStream].insert(NO_SYMBOL);
+            if (!groups.contains(group)) {
+                qWarning() << "报警规则引用了不存在的分组:" << group;
+            }
+            for (const QString &value : groups.value(group)) {
+                fields[FieldStream].insert(ruleSet->intern(value));
+            }
+        }
+        for (const QString &value : toStringList(match.value("type"))) {
+            fields[FieldType].insert(ruleSet->intern(value));
+        }
+
+        RuleAction action;
+        action.name = ruleObj.value("name").toString();
+        if (ruleObj.value("action").toString() == "hide") {
+            action.actions |= AlarmEvent::Hidden;
+        }
+        QJsonValue sound = ruleObj.value("sound");
+        if (sound.isString() || sound.toBool()) {
+            action.actions |= AlarmEvent::Sound;
+            action.sound = sound.toString();
+        }
+        if (ruleObj.value("highlight").toBool()) {
+            action.actions |= AlarmEvent::Highlight;
+        }
+
+        allowed.append(fields);
+        ruleSet->m_actions.append(action);
+    }
+
+    // 编译为每个字段一张“符号 -> 位图行”表
+    int ruleCount = ruleSet->m_actions.size();
+    int symbolCount = ruleSet->m_symbols.size();
+    ruleSet->m_words = qMax(1, (ruleCount + 63) / 64);
+    for (int field = 0; field < FieldCount; ++field) {
+        QVector<quint64> anyMask(ruleSet->m_words, 0);
+        QHash<int, QVector<int> > rulesBySymbol;
+        for (int rule = 0; rule < ruleCount; ++rule) {
+            const QSet<int> &symbols = allowed.at(rule).at(field);
+            if (symbols.isEmpty()) {
+                anyMask[rule / 64] |= quint64(1) << (rule % 64);
+            }
+            for (int symbol : symbols) {
+                if (symbol != NO_SYMBOL) {
+                    rulesBySymbol[symbol].append(rule);
+                }
+            }
+        }
+
+        ruleSet->m_anyRow[field] = ruleSet->addRow(anyMask);
+        ruleSet->m_rowForSymbol[field] = QVector<int>(symbolCount, ruleSet->m_anyRow[field]);
+        for (auto it = rulesBySymbol.constBegin(); it != rulesBySymbol.constEnd(); ++it) {
+            QVector<quint64> mask = anyMask;
+            for (int rule : it.value()) {
+                mask[rule / 64] |= quint64(1) << (rule % 64);
+            }
+            ruleSet->m_rowForSymbol[field][it.key()] = ruleSet->addRow(mask);
+        }
+    }
+
+    qDebug() << "加载报警规则:" << path << "规则数:" << ruleCount << "符号数:" << symbolCount;
+    return ruleSet;
+}
+
+int AlarmRuleSet::evaluate(AlarmEvent &alarm) const
+{
+    if (m_actions.isEmpty()) {
+        return -1;
+    }
+
+    QVarLengthArray<quint64, 4> acc(m_words);
+    for (int i = 0; i < m_words; ++i) {
+        acc[i] = ~quint64(0);
+    }
+
+    for (int field = 0; field < FieldCount; ++field) {
+        int symbol = m_symbols.value(alarm.*FIELD_MEMBERS[field], -1);
+        int row = symbol >= 0 ? m_rowForSymbol[field].at(symbol) : m_anyRow[field];
+        const quint64 *mask = m_rows.constData() + row * m_words;
+        for (int i = 0; i < m_words; ++i) {
+            acc[i] &= mask[i];
+        }
+    }
+
+    // 规则按文件顺序编号，最低位即优先级最高的命中规则
+    for (int i = 0; i < m_words; ++i) {
+        if (acc[i]) {
+            int rule = i * 64 + int(qCountTrailingZeroBits(acc[i]));
+            const RuleAction &action = m_actions.at(rule);
+            alarm.actions = action.actions;
+            alarm.sound = action.sound;
+            return rule;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,61 @@
+#ifndef ALARMRULES_H
+#define ALARMRULES_H
+
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include "alarmevent.h"
+
+// 报警过滤与处理规则
+// 规则文件为JSON：
+// {
+//   "groups": {"gate": ["cam-01", "cam-02"]},
+//   "rules": [
+//     {"name": "门口入侵", "match": {"type": "intrusion", "stream_group": "gate"}},
+//     {"name": "火情", "match": {"type": ["fire", "smoke"]}, "sound": "fire.wav", "highlight": true},
+//     {"name": "其他", "match": {}, "action": "hide"}
+//   ]
+// }
+// 按顺序取第一条命中的规则，都不命中时照常显示。
+//
+// 加载时编译为扁平表：规则中的字符串全部驻留为符号，每个字段一张“符号 -> 行”表，
+// 每行是满足该字段条件的规则位图。求值时每个字段一次查表、一次按字与运算，
+// 结果中最低位的规则即命中规则，求值不随规则条数逐条比较。
+class AlarmRuleSet
+{
+public:
+    static QSharedPointer<AlarmRuleSet> load(const QString &path, QString *error = nullptr);
+
+    // 在AlarmEvent上填写actions和sound，返回命中的规则序号，未命中返回-1
+    int evaluate(AlarmEvent &alarm) const;
+
+    int ruleCount() const { return m_actions.size(); }
+
+private:
+    enum Field {
+        FieldStream,
+        FieldType,
+        FieldCount
+    };
+
+    struct RuleAction
+    {
+        QString name;
+        quint32 actions = 0;
+        QString sound;
+    };
+
+    AlarmRuleSet() {}
+    int intern(const QString &value);
+    int addRow(const QVector<quint64> &mask);
+
+    QHash<QString, int> m_symbols;              // 驻留字符串 -> 符号
+    QVector<quint64> m_rows;                    // 位图行，每行m_words个字
+    int m_words = 0;
+    int m_anyRow[FieldCount];                   // 字段值不在表中时使用的行
+    QVector<int> m_rowForSymbol[FieldCount];    // 符号 -> 行
+    QVector<RuleAction> m_actions;
+};
+
+#endif // ALARMRULES_H
@@ -0,0 +1,138 @@
+#include "alarmsearchdialog.h"
+#include "alarmstore.h"
+#include "alarmsearchindex.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QDebug>
+
+AlarmSearchDialog::AlarmSearchDialog(AlarmStore *store, AlarmSearchIndex *index, QWidget *parent)
+    : QDialog(parent)
+    , m_store(store)
+    , m_index(index)
+{
+    setupUI();
+    applyStyles();
+
+    setWindowTitle("报警历史查询");
+    resize(800, 500);
+}
+
+void AlarmSearchDialog::setupUI()
+{
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(20, 20, 20, 20);
+    mainLayout->setSpacing(10);
+
+    // 查询条件
+    QHBoxLayout *queryLayout = new QHBoxLayout();
+    queryLayout->setSpacing(10);
+
+    m_queryEdit = new QLineEdit(this);
+    m_queryEdit->setPlaceholderText("输入关键字，多个关键字用空格分隔");
+    connect(m_queryEdit, &QLineEdit::returnPressed, this, &AlarmSearchDialog::onSearchClicked);
+
+    // 默认查询最近一周
+    QDateTime now = QDateTime::currentDateTime();
+    m_fromEdit = new QDateTimeEdit(now.addDays(-7), this);
+    m_fromEdit->setDisplayFormat("yyyy-MM-dd hh:mm");
+    m_fromEdit->setCalendarPopup(true);
+    m_toEdit = new QDateTimeEdit(now.addSecs(3600), this);
+    m_toEdit->setDisplayFormat("yyyy-MM-dd hh:mm");
+    m_toEdit->setCalendarPopup(true);
+
+    m_searchButton = new QPushButton("查询", this);
+    m_searchButton->setFixedSize(80, 32);
+    connect(m_searchButton, &QPushButton::clicked, this, &AlarmSearchDialog::onSearchClicked);
+
+    queryLayout->addWidget(m_queryEdit, 1);
+    queryLayout->addWidget(new QLabel("从", this));
+    queryLayout->addWidget(m_fromEdit);
+    queryLayout->addWidget(new QLabel("到", this));
+    queryLayout->addWidget(m_toEdit);
+    queryLayout->addWidget(m_searchButton);
+    mainLayout->addLayout(queryLayout);
+
+    // 查询结果
+    m_resultList = new QListWidget(this);
+    m_resultList->setUniformItemSizes(true);
+    m_resultList->setSelectionMode(QAbstractItemView::SingleSelection);
+    mainLayout->addWidget(m_resultList);
+
+    m_statusLabel = new QLabel(this);
+    mainLayout->addWidget(m_statusLabel);
+}
+
+void AlarmSearchDialog::applyStyles()
+{
+    setStyleSheet(R"(
+        QDialog {
+            background-color: #1e1e1e;
+            color: #ffffff;
+        }
+        QLabel {
+            color: #ffffff;
+        }
+        QLineEdit, QDateTimeEdit {
+            background-color: #2d2d2d;
+            border: 1px solid #3d3d3d;
+            border-radius: 4px;
+            color: #ffffff;
+            padding: 4px;
+        }
+        QListWidget {
+            background-color: #2d2d2d;
+            border: 1px solid #3d3d3d;
+            border-radius: 6px;
+            color: #ffffff;
+            font-size: 12px;
+        }
+        QPushButton {
+            background-color: #4CAF50;
+            border: 1px solid #45a049;
+            border-radius: 6px;
+            color: #ffffff;
+            font-weight: bold;
+        }
+        QPushButton:hover {
+            background-color: #45a049;
+        }
+    )");
+}
+
+void AlarmSearchDialog::onSearchClicked()
+{
+    m_resultList->clear();
+
+    qint64 fromMs = m_fromEdit->dateTime().toMSecsSinceEpoch();
+    qint64 toMs = m_toEdit->dateTime().toMSecsSinceEpoch();
+    QString query = m_queryEdit->text().trimmed();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 没有关键字时按时间范围列出最新的记录
+    QVector<quint64> ids;
+    if (query.isEmpty()) {
+        QVector<AlarmRecord> records = m_store->query(fromMs, toMs, MAX_RESULTS);
+        for (const AlarmRecord &record : records) {
+            ids.append(record.id);
+        }
+    } else {
+        QVector<AlarmSearchHit> hits = m_index->search(query, fromMs, toMs, MAX_RESULTS);
+        for (const AlarmSearchHit &hit : hits) {
+            ids.append(hit.id);
+        }
+    }
+    qint64 searchMs = timer.elapsed();
+
+    // 按命中顺序读取原文
+    QVector<AlarmRecord> records = m_store->records(ids);
+    for (const AlarmRecord &record : records) {
+        QString timeStr = QDateTime::fromMSecsSinceEpoch(record.timestamp).toString("yyyy-MM-dd hh:mm:ss");
+        m_resultList->addItem(QString("[%1] %2").arg(timeStr, QString::fromUtf8(record.payload)));
+    }
+
+    m_statusLabel->setText(QString("共 %1 条结果，检索耗时 %2 ms，索引文档数 %3")
+                               .arg(records.size()).arg(searchMs).arg(m_index->documentCount()));
+    qDebug() << "报警检索:" << query << "结果:" << records.size() << "耗时(ms):" << searchMs;
+}
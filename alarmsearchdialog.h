@@ -0,0 +1,44 @@
+#ifndef ALARMSEARCHDIALOG_H
+#define ALARMSEARCHDIALOG_H
+
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QDateTimeEdit>
+#include <QListWidget>
+
+class AlarmStore;
+class AlarmSearchIndex;
+
+// 报警历史检索对话框
+class AlarmSearchDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    AlarmSearchDialog(AlarmStore *store, AlarmSearchIndex *index, QWidget *parent = nullptr);
+
+private slots:
+    void onSearchClicked();
+
+private:
+    void setupUI();
+    void applyStyles();
+
+    AlarmStore *m_store;
+    AlarmSearchIndex *m_index;
+
+    QLineEdit *m_queryEdit;
+    QDateTimeEdit *m_fromEdit;
+    QDateTimeEdit *m_toEdit;
+    QPushButton *m_searchButton;
+    QListWidget *m_resultList;
+    QLabel *m_statusLabel;
+
+    static const int MAX_RESULTS = 500;
+};
+
+#endif // ALARMSEARCHDIALOG_H
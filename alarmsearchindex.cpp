@@ -0,0 +1,317 @@
+#include "alarmsearchindex.h"
+#include <QElapsedTimer>
+#include <QDebug>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <cmath>
+
+namespace {
+
+// BM25参数
+const float BM25_K1 = 1.2f;
+const float BM25_B = 0.75f;
+
+// 重建时每批加锁索引的记录数
+const int REBUILD_BATCH = 4096;
+
+bool isCjk(uint c)
+{
+    return (c >= 0x4E00 && c <= 0x9FFF)     // 中日韩统一表意文字
+        || (c >= 0x3400 && c <= 0x4DBF)     // 扩展A
+        || (c >= 0x20000 && c <= 0x2A6DF)   // 扩展B
+        || (c >= 0xF900 && c <= 0xFAFF)     // 兼容表意文字
+        || (c >= 0x3040 && c <= 0x30FF)     // 平假名、片假名
+        || (c >= 0xAC00 && c <= 0xD7AF);    // 韩文音节
+}
+
+}
+
+AlarmSearchIndex::AlarmSearchIndex()
+    : m_docBase(0)
+    , m_totalLength(0)
+    , m_minId(0)
+    , m_rebuilding(false)
+{
+}
+
+QStringList AlarmSearchIndex::tokenize(const QString &text, bool forQuery)
+{
+    QStringList tokens;
+    QString word;
+    QVector<uint> cjkRun;
+
+    auto flushWord = [&]() {
+        if (!word.isEmpty()) {
+            if (word.size() <= MAX_TERM_LENGTH) {
+                tokens.append(word.toLower());
+            }
+            word.clear();
+        }
+    };
+
+    // 索引时同时写入单字和双字；查询时连续两个字以上只用双字，单个字才用单字
+    auto flushCjk = [&]() {
+        int n = cjkRun.size();
+        if (n == 0) {
+            return;
+        }
+        if (!forQuery || n == 1) {
+            for (int i = 0; i < n; ++i) {
+                tokens.append(QString::fromUcs4(&cjkRun[i], 1));
+            }
+        }
+        for (int i = 0; i + 1 < n; ++i) {
+            tokens.append(QString::fromUcs4(&cjkRun[i], 2));
+        }
+        cjkRun.clear();
+    };
+
+    const QVector<uint> ucs4 = text.toUcs4();
+    for (uint c : ucs4) {
+        if (isCjk(c)) {
+            flushWord();
+            cjkRun.append(c);
+        } else if (QChar::isLetterOrNumber(c)) {
+            flushCjk();
+            word.append(QString::fromUcs4(&c, 1));
+        } else {
+            flushWord();
+            flushCjk();
+        }
+    }
+    flushWord();
+    flushCjk();
+
+    return tokens;
+}
+
+void AlarmSearchIndex::indexRecord(const AlarmRecord &record)
+{
+    // 记录必须按序号递增，重复提交的和已淘汰的直接忽略
+    if (record.id < m_minId || (!m_docIds.isEmpty() && record.id <= m_docIds.last())) {
+        return;
+    }
+
+    QStringList tokens = tokenize(QString::fromUtf8(record.payload), false);
+    QHash<QString, int> freqs;
+    for (const QString &token : tokens) {
+        ++freqs[token];
+    }
+
+    quint32 docNo = m_docBase + quint32(m_docIds.size());
+    for (auto it = freqs.constBegin(); it != freqs.constEnd(); ++it) {
+        int termId = m_termIds.value(it.key(), -1);
+        if (termId < 0) {
+            termId = m_postings.size();
+            m_termIds.insert(it.key(), termId);
+            m_postings.append(Posting());
+        }
+        Posting &posting = m_postings[termId];
+        posting.docs.append(docNo);
+        posting.freqs.append(quint16(qMin(it.value(), 0xFFFF)));
+    }
+
+    m_docIds.append(record.id);
+    m_docTimes.append(record.timestamp);
+    m_docLengths.append(quint16(qMin(tokens.size(), 0xFFFF)));
+    m_totalLength += tokens.size();
+}
+
+void AlarmSearchIndex::beginRebuild()
+{
+    QWriteLocker locker(&m_lock);
+    m_rebuilding = true;
+}
+
+void AlarmSearchIndex::rebuild(const AlarmStore &store, quint64 untilId)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<AlarmRecord> batch;
+    store.scan(untilId, [&](const AlarmRecord &record) {
+        batch.append(record);
+        if (batch.size() >= REBUILD_BATCH) {
+            QWriteLocker locker(&m_lock);
+            for (const AlarmRecord &r : batch) {
+                indexRecord(r);
+            }
+            batch.clear();
+        }
+    });
+
+    QWriteLocker locker(&m_lock);
+    for (const AlarmRecord &record : batch) {
+        indexRecord(record);
+    }
+    for (const AlarmRecord &record : m_pendingLive) {
+        indexRecord(record);
+    }
+    m_pendingLive.clear();
+    m_rebuilding = false;
+
+    qDebug() << "报警全文索引重建完成，文档数:" << m_docIds.size()
+             << "词条数:" << m_termIds.size() << "耗时(ms):" << timer.elapsed();
+}
+
+void AlarmSearchIndex::addRecords(const QVector<AlarmRecord> &records)
+{
+    QWriteLocker locker(&m_lock);
+    if (m_rebuilding) {
+        m_pendingLive += records;
+        return;
+    }
+    for (const AlarmRecord &record : records) {
+        indexRecord(record);
+    }
+}
+
+void AlarmSearchIndex::dropBefore(quint64 beforeId)
+{
+    QWriteLocker locker(&m_lock);
+    if (beforeId <= m_minId) {
+        return;
+    }
+    m_minId = beforeId;
+    int count = int(std::lower_bound(m_docIds.constBegin(), m_docIds.constEnd(), beforeId) - m_docIds.constBegin());
+    if (count == 0) {
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        m_totalLength -= m_docLengths.at(i);
+    }
+    m_docIds.remove(0, count);
+    m_docTimes.remove(0, count);
+    m_docLengths.remove(0, count);
+    m_docBase += quint32(count);
+
+    // 去掉各倒排表中已淘汰的前缀，清空的词条一并删除，词条编号重新分配
+    QHash<QString, int> termIds;
+    QVector<Posting> postings;
+    termIds.reserve(m_termIds.size());
+    for (auto it = m_termIds.constBegin(); it != m_termIds.constEnd(); ++it) {
+        Posting &posting = m_postings[it.value()];
+        int drop = int(std::lower_bound(posting.docs.constBegin(), posting.docs.constEnd(), m_docBase)
+                       - posting.docs.constBegin());
+        if (drop == posting.docs.size()) {
+            continue;
+        }
+        posting.docs.remove(0, drop);
+        posting.freqs.remove(0, drop);
+        termIds.insert(it.key(), postings.size());
+        postings.append(posting);
+    }
+    m_termIds.swap(termIds);
+    m_postings.swap(postings);
+    qDebug() << "报警全文索引淘汰文档:" << count << "剩余:" << m_docIds.size();
+}
+
+int AlarmSearchIndex::documentCount() const
+{
+    QReadLocker locker(&m_lock);
+    return m_docIds.size();
+}
+
+QVector<AlarmSearchHit> AlarmSearchIndex::search(const QString &query, qint64 fromMs, qint64 toMs, int limit) const
+{
+    QVector<AlarmSearchHit> hits;
+    QStringList terms = tokenize(query, true);
+    terms.removeDuplicates();
+    if (terms.isEmpty() || limit <= 0) {
+        return hits;
+    }
+
+    QReadLocker locker(&m_lock);
+
+    // 任一查询词不存在则没有结果
+    QVector<const Posting *> lists;
+    for (const QString &term : terms) {
+        auto it = m_termIds.constFind(term);
+        if (it == m_termIds.constEnd()) {
+            return hits;
+        }
+        lists.append(&m_postings.at(it.value()));
+    }
+
+    // 从最短的倒排表开始求交集
+    std::sort(lists.begin(), lists.end(), [](const Posting *a, const Posting *b) {
+        return a->docs.size() < b->docs.size();
+    });
+
+    // 文档按时间递增编号，时间范围直接换算为编号范围
+    quint32 lo = m_docBase + quint32(std::lower_bound(m_docTimes.constBegin(), m_docTimes.constEnd(), fromMs)
+                                     - m_docTimes.constBegin());
+    quint32 hi = m_docBase + quint32(std::upper_bound(m_docTimes.constBegin(), m_docTimes.constEnd(), toMs)
+                                     - m_docTimes.constBegin());
+    if (lo >= hi) {
+        return hits;
+    }
+
+    const float docCount = float(m_docIds.size());
+    const float avgLength = m_totalLength > 0 ? float(m_totalLength) / docCount : 1.0f;
+    QVector<float> idf;
+    for (const Posting *posting : lists) {
+        float df = float(posting->docs.size());
+        idf.append(std::log(1.0f + (docCount - df + 0.5f) / (df + 0.5f)));
+    }
+
+    auto termScore = [&](int list, int pos, quint32 doc) {
+        float tf = float(lists.at(list)->freqs.at(pos));
+        float norm = BM25_K1 * (1.0f - BM25_B + BM25_B * float(m_docLengths.at(int(doc - m_docBase))) / avgLength);
+        return idf.at(list) * tf * (BM25_K1 + 1.0f) / (tf + norm);
+    };
+
+    // 小顶堆保留得分最高的limit条，同分时编号大（更新）的优先
+    typedef std::pair<float, quint32> Scored;
+    std::priority_queue<Scored, std::vector<Scored>, std::greater<Scored> > heap;
+
+    const Posting *driver = lists.first();
+    QVector<int> cursors(lists.size(), 0);
+    int start = int(std::lower_bound(driver->docs.constBegin(), driver->docs.constEnd(), lo)
+                    - driver->docs.constBegin());
+
+    bool exhausted = false;
+    for (int i = start; i < driver->docs.size() && !exhausted; ++i) {
+        quint32 doc = driver->docs.at(i);
+        if (doc >= hi) {
+            break;
+        }
+
+        float score = termScore(0, i, doc);
+        bool matched = true;
+        for (int j = 1; j < lists.size(); ++j) {
+            const QVector<quint32> &docs = lists.at(j)->docs;
+            auto it = std::lower_bound(docs.constBegin() + cursors[j], docs.constEnd(), doc);
+            cursors[j] = int(it - docs.constBegin());
+            if (it == docs.constEnd()) {
+                exhausted = true;
+                matched = false;
+                break;
+            }
+            if (*it != doc) {
+                matched = false;
+                break;
+            }
+            score += termScore(j, cursors[j], doc);
+        }
+
+        if (matched) {
+            heap.push(Scored(score, doc));
+            if (int(heap.size()) > limit) {
+                heap.pop();
+            }
+        }
+    }
+
+    hits.resize(int(heap.size()));
+    for (int i = hits.size() - 1; i >= 0; --i) {
+        const Scored &top = heap.top();
+        hits[i].id = m_docIds.at(int(top.second - m_docBase));
+        hits[i].timestamp = m_docTimes.at(int(top.second - m_docBase));
+        hits[i].score = top.first;
+        heap.pop();
+    }
+    return hits;
+}
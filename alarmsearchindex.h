@@ -0,0 +1,68 @@
+#ifndef ALARMSEARCHINDEX_H
+#define ALARMSEARCHINDEX_H
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "alarmstore.h"
+
+// 一条搜索命中
+struct AlarmSearchHit
+{
+    quint64 id = 0;
+    qint64 timestamp = 0;
+    float score = 0.0f;
+};
+
+// 报警历史的内存倒排索引
+// 英文和数字按词切分并转小写，中日韩文字同时索引单字和相邻双字，
+// 查询词全部命中才返回，按BM25风格的词频和逆文档频率排序，同分时新的在前。
+class AlarmSearchIndex
+{
+public:
+    AlarmSearchIndex();
+
+    // 重建期间收到的新记录先缓存，重建完成后按序号顺序补入
+    void beginRebuild();
+    void rebuild(const AlarmStore &store, quint64 untilId);
+
+    // 线程安全，记录必须按序号递增提交
+    void addRecords(const QVector<AlarmRecord> &records);
+    // 删除序号小于beforeId的文档，与报警存储淘汰的段同步，线程安全
+    void dropBefore(quint64 beforeId);
+
+    QVector<AlarmSearchHit> search(const QString &query, qint64 fromMs, qint64 toMs, int limit) const;
+
+    int documentCount() const;
+
+    static QStringList tokenize(const QString &text, bool forQuery);
+
+private:
+    struct Posting
+    {
+        QVector<quint32> docs;   // 文档编号（不随淘汰改变），递增
+        QVector<quint16> freqs;  // 对应的词频
+    };
+
+    void indexRecord(const AlarmRecord &record);
+
+    mutable QReadWriteLock m_lock;
+    QHash<QString, int> m_termIds;
+    QVector<Posting> m_postings;
+    // 以下按(文档编号 - m_docBase)下标访问
+    QVector<quint64> m_docIds;      // 存储序号
+    QVector<qint64> m_docTimes;     // 时间戳，单调递增
+    QVector<quint16> m_docLengths;  // 词条数
+    quint32 m_docBase;              // 最旧的未淘汰文档的编号
+    qint64 m_totalLength;
+    quint64 m_minId;                // 小于此序号的记录已被淘汰，不再索引
+
+    bool m_rebuilding;
+    QVector<AlarmRecord> m_pendingLive;
+
+    static const int MAX_TERM_LENGTH = 32;
+};
+
+#endif // ALARMSEARCHINDEX_H
@@ -0,0 +1,67 @@
+#include "alarmsnapshotdecoder.h"
+#include <QBuffer>
+#include <QImageReader>
+#include <QRunnable>
+#include <QDebug>
+
+class SnapshotDecodeTask : public QRunnable
+{
+public:
+    SnapshotDecodeTask(AlarmSnapshotDecoder *decoder, quint64 key, const QByteArray &jpeg)
+        : m_decoder(decoder), m_key(key), m_jpeg(jpeg) {}
+
+    void run() override
+    {
+        QBuffer buffer(&m_jpeg);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer, "jpeg");
+
+        // 先读头部得到原始尺寸，再让解码器直接输出缩略图大小
+        QSize size = reader.size();
+        if (size.isValid()) {
+            reader.setScaledSize(size.scaled(m_decoder->m_thumbnailSize, Qt::KeepAspectRatio));
+        }
+        QImage thumbnail = reader.read();
+        m_decoder->m_pending.fetch_sub(1);
+
+        if (thumbnail.isNull()) {
+            qDebug() << "报警抓拍解码失败:" << reader.errorString();
+            return;
+        }
+        emit m_decoder->decoded(m_key, thumbnail);
+    }
+
+private:
+    AlarmSnapshotDecoder *m_decoder;
+    quint64 m_key;
+    QByteArray m_jpeg;
+};
+
+AlarmSnapshotDecoder::AlarmSnapshotDecoder(const QSize &thumbnailSize, int threads, QObject *parent)
+    : QObject(parent)
+    , m_thumbnailSize(thumbnailSize)
+    , m_pending(0)
+{
+    qRegisterMetaType<QImage>("QImage");
+    m_pool.setMaxThreadCount(qMax(1, threads));
+}
+
+AlarmSnapshotDecoder::~AlarmSnapshotDecoder()
+{
+    // 丢弃尚未开始的任务，等待正在解码的任务结束
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void AlarmSnapshotDecoder::decode(quint64 key, const QByteArray &jpeg)
+{
+    if (jpeg.isEmpty()) {
+        return;
+    }
+    if (m_pending.fetch_add(1) >= MAX_PENDING) {
+        m_pending.fetch_sub(1);
+        qDebug() << "报警抓拍积压过多，丢弃一张";
+        return;
+    }
+    m_pool.start(new SnapshotDecodeTask(this, key, jpeg));
+}
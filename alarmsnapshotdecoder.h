@@ -0,0 +1,38 @@
+#ifndef ALARMSNAPSHOTDECODER_H
+#define ALARMSNAPSHOTDECODER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QImage>
+#include <QSize>
+#include <QThreadPool>
+#include <atomic>
+
+// 报警抓拍图解码
+// JPEG在独立的小线程池中解码，解码时直接按缩略图尺寸缩小（libjpeg按DCT缩放，不解出全尺寸图），
+// 结果通过decoded信号回到接收者线程。积压过多时丢弃新的抓拍，不影响报警文字的显示。
+class AlarmSnapshotDecoder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AlarmSnapshotDecoder(const QSize &thumbnailSize, int threads = 2, QObject *parent = nullptr);
+    ~AlarmSnapshotDecoder();
+
+    // key由调用者定义，原样随decoded返回
+    void decode(quint64 key, const QByteArray &jpeg);
+
+signals:
+    void decoded(quint64 key, const QImage &thumbnail);
+
+private:
+    friend class SnapshotDecodeTask;
+
+    QThreadPool m_pool;
+    QSize m_thumbnailSize;
+    std::atomic<int> m_pending;
+
+    static const int MAX_PENDING = 32;
+};
+
+#endif // ALARMSNAPSHOTDECODER_H
@@ -0,0 +1,528 @@
+#include "alarmstore.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QDebug>
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 记录头：4字节负载长度 + 8字节时间戳
+const qint64 RECORD_HEADER_SIZE = sizeof(quint32) + sizeof(qint64);
+
+void syncFile(QFile &file)
+{
+    file.flush();
+#ifdef Q_OS_WIN
+    _commit(file.handle());
+#else
+    ::fsync(file.handle());
+#endif
+}
+
+}
+
+AlarmStore::AlarmStore(const QString &dir, qint64 segmentBytes, int maxSegments, QObject *parent)
+    : QThread(parent)
+    , m_dir(dir)
+    , m_segmentBytes(qMax<qint64>(segmentBytes, 64 * 1024))
+    , m_maxSegments(qMax(2, maxSegments))
+    , m_stop(false)
+    , m_dropped(0)
+    , m_activeFirstId(0)
+    , m_activeLogSize(0)
+    , m_lastTimestamp(0)
+    , m_writeFailed(false)
+{
+}
+
+AlarmStore::~AlarmStore()
+{
+    stop();
+    closeActiveSegment();
+
+    for (Segment &segment : m_segments) {
+        unmapSegment(segment);
+    }
+    m_segments.clear();
+}
+
+QString AlarmStore::segmentPath(quint64 firstId, const QString &suffix) const
+{
+    return QString("%1/%2%3").arg(m_dir).arg(firstId, 20, 10, QChar('0')).arg(suffix);
+}
+
+bool AlarmStore::open()
+{
+    if (!QDir().mkpath(m_dir)) {
+        qWarning() << "无法创建报警存储目录:" << m_dir;
+        return false;
+    }
+
+    // 按文件名（即首条记录序号）排序加载已有的段
+    QDir dir(m_dir);
+    QStringList idxFiles = dir.entryList(QStringList() << "*.idx", QDir::Files, QDir::Name);
+
+    quint64 nextId = 0;
+    for (const QString &name : idxFiles) {
+        Segment segment;
+        segment.firstId = QFileInfo(name).baseName().toULongLong();
+        segment.idxPath = dir.filePath(name);
+        segment.logPath = segmentPath(segment.firstId, ".log");
+        if (!mapSegment(segment)) {
+            continue;
+        }
+        if (segment.count == 0) {
+            unmapSegment(segment);
+            QFile::remove(segment.idxPath);
+            QFile::remove(segment.logPath);
+            continue;
+        }
+        nextId = segment.firstId + segment.count;
+        m_lastTimestamp = segment.entries[segment.count - 1].timestamp;
+        m_segments.append(segment);
+    }
+
+    enforceRetention();
+
+    if (!openActiveSegment(nextId)) {
+        return false;
+    }
+
+    qDebug() << "报警存储已打开:" << m_dir << "段数:" << m_segments.size() << "下一序号:" << nextId;
+    return true;
+}
+
+bool AlarmStore::mapSegment(Segment &segment)
+{
+    segment.idxFile = new QFile(segment.idxPath);
+    if (!segment.idxFile->open(QIODevice::ReadOnly)) {
+        qWarning() << "无法打开报警索引:" << segment.idxPath;
+        delete segment.idxFile;
+        segment.idxFile = nullptr;
+        return false;
+    }
+
+    qint64 size = segment.idxFile->size();
+    segment.count = size / sizeof(IndexEntry);
+    segment.entries = nullptr;
+    if (segment.count > 0) {
+        uchar *data = segment.idxFile->map(0, segment.count * sizeof(IndexEntry));
+        if (!data) {
+            qWarning() << "无法映射报警索引:" << segment.idxPath;
+            unmapSegment(segment);
+            return false;
+        }
+        segment.entries = reinterpret_cast<const IndexEntry *>(data);
+    }
+
+    // 异常退出时索引可能比数据文件多写了几项，去掉指向文件末尾之外的部分
+    qint64 logSize = QFileInfo(segment.logPath).size();
+    while (segment.count > 0
+           && qint64(segment.entries[segment.count - 1].offset) + RECORD_HEADER_SIZE > logSize) {
+        --segment.count;
+    }
+    return true;
+}
+
+void AlarmStore::unmapSegment(Segment &segment)
+{
+    if (segment.idxFile) {
+        segment.idxFile->close(); // close会同时解除映射
+        delete segment.idxFile;
+        segment.idxFile = nullptr;
+    }
+    segment.entries = nullptr;
+    segment.count = 0;
+}
+
+bool AlarmStore::openActiveSegment(quint64 firstId)
+{
+    m_activeLog.setFileName(segmentPath(firstId, ".log"));
+    m_activeIdx.setFileName(segmentPath(firstId, ".idx"));
+
+    if (!m_activeLog.open(QIODevice::WriteOnly | QIODevice::Truncate)
+        || !m_activeIdx.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "无法创建报警段文件:" << m_activeLog.fileName();
+        m_activeLog.close();
+        m_activeIdx.close();
+        return false;
+    }
+
+    m_activeFirstId = firstId;
+    m_activeIndex.clear();
+    m_activeLogSize = 0;
+    return true;
+}
+
+void AlarmStore::closeActiveSegment()
+{
+    if (!m_activeLog.isOpen()) {
+        return;
+    }
+
+    syncFile(m_activeLog);
+    syncFile(m_activeIdx);
+    m_activeLog.close();
+    m_activeIdx.close();
+
+    // 空段不保留
+    if (m_activeIndex.isEmpty()) {
+        QFile::remove(m_activeLog.fileName());
+        QFile::remove(m_activeIdx.fileName());
+    }
+}
+
+void AlarmStore::rotateSegment()
+{
+    closeActiveSegment();
+
+    QMutexLocker locker(&m_segmentsMutex);
+    Segment segment;
+    segment.firstId = m_activeFirstId;
+    segment.logPath = m_activeLog.fileName();
+    segment.idxPath = m_activeIdx.fileName();
+    if (mapSegment(segment)) {
+        m_segments.append(segment);
+    }
+
+    if (!openActiveSegment(m_activeFirstId + m_activeIndex.size())) {
+        m_writeFailed = true;
+        emit errorOccurred("无法创建新的报警段文件");
+    }
+    enforceRetention();
+}
+
+void AlarmStore::enforceRetention()
+{
+    // 活动段也计入段数上限
+    bool expired = false;
+    while (!m_segments.isEmpty() && m_segments.size() + 1 > m_maxSegments) {
+        Segment oldest = m_segments.takeFirst();
+        unmapSegment(oldest);
+        QFile::remove(oldest.idxPath);
+        QFile::remove(oldest.logPath);
+        qDebug() << "删除过期报警段:" << oldest.logPath;
+        expired = true;
+    }
+    if (expired) {
+        emit segmentsExpired(m_segments.isEmpty() ? m_activeFirstId : m_segments.first().firstId);
+    }
+}
+
+void AlarmStore::stop()
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_queueMutex);
+        m_stop.store(true);
+        m_queueCond.wakeAll();
+    }
+    wait();
+}
+
+void AlarmStore::append(qint64 timestamp, const QString &payload)
+{
+    QMutexLocker locker(&m_queueMutex);
+    if (m_queue.size() >= MAX_PENDING) {
+        // 磁盘跟不上时丢弃，绝不阻塞调用方
+        m_dropped.fetch_add(1);
+        return;
+    }
+
+    PendingAlarm alarm;
+    alarm.timestamp = timestamp;
+    alarm.payload = payload.toUtf8();
+    m_queue.append(alarm);
+    m_queueCond.wakeOne();
+}
+
+void AlarmStore::run()
+{
+    qDebug() << "报警存储写线程已启动";
+
+    QVector<PendingAlarm> batch;
+    forever {
+        {
+            QMutexLocker locker(&m_queueMutex);
+            while (m_queue.isEmpty() && !m_stop.load()) {
+                m_queueCond.wait(&m_queueMutex);
+            }
+            if (m_queue.isEmpty() && m_stop.load()) {
+                break;
+            }
+            // 一次取走所有积压的报警，合并为一次提交
+            batch.swap(m_queue);
+        }
+
+        if (!m_writeFailed) {
+            writeBatch(batch);
+        }
+        batch.clear();
+    }
+
+    qDebug() << "报警存储写线程已停止";
+}
+
+void AlarmStore::writeBatch(const QVector<PendingAlarm> &batch)
+{
+    QByteArray logBuf;
+    QByteArray idxBuf;
+    QVector<IndexEntry> entries;
+    QVector<AlarmRecord> committed;
+
+    for (const PendingAlarm &alarm : batch) {
+        // 段写满后先提交已缓冲的部分再轮转
+        if (m_activeLogSize + logBuf.size() >= m_segmentBytes
+            && m_activeIndex.size() + entries.size() > 0) {
+            if (!commit(logBuf, idxBuf, entries, committed)) {
+                return;
+            }
+            rotateSegment();
+            if (m_writeFailed) {
+                return;
+            }
+        }
+
+        // 索引要求时间戳单调，时钟回拨时沿用上一条的时间
+        IndexEntry entry;
+        entry.timestamp = qMax(alarm.timestamp, m_lastTimestamp);
+        entry.offset = quint64(m_activeLogSize + logBuf.size());
+        m_lastTimestamp = entry.timestamp;
+
+        quint32 length = quint32(alarm.payload.size());
+        logBuf.append(reinterpret_cast<const char *>(&length), sizeof(length));
+        logBuf.append(reinterpret_cast<const char *>(&entry.timestamp), sizeof(entry.timestamp));
+        logBuf.append(alarm.payload);
+        idxBuf.append(reinterpret_cast<const char *>(&entry), sizeof(entry));
+        entries.append(entry);
+
+        AlarmRecord record;
+        record.id = m_activeFirstId + quint64(m_activeIndex.size() + entries.size() - 1);
+        record.timestamp = entry.timestamp;
+        record.payload = alarm.payload;
+        committed.append(record);
+    }
+
+    commit(logBuf, idxBuf, entries, committed);
+}
+
+bool AlarmStore::commit(QByteArray &logBuf, QByteArray &idxBuf, QVector<IndexEntry> &entries,
+                        QVector<AlarmRecord> &committed)
+{
+    if (entries.isEmpty()) {
+        return true;
+    }
+
+    // 先写数据再写索引，同步落盘后才对查询可见
+    if (m_activeLog.write(logBuf) != logBuf.size() || m_activeIdx.write(idxBuf) != idxBuf.size()) {
+        qWarning() << "写入报警段失败:" << m_activeLog.errorString();
+        m_writeFailed = true;
+        emit errorOccurred(QString("写入报警历史失败: %1").arg(m_activeLog.errorString()));
+        return false;
+    }
+    syncFile(m_activeLog);
+    syncFile(m_activeIdx);
+
+    {
+        QMutexLocker locker(&m_segmentsMutex);
+        m_activeIndex += entries;
+    }
+    m_activeLogSize += logBuf.size();
+
+    emit recordsCommitted(committed);
+
+    logBuf.clear();
+    idxBuf.clear();
+    entries.clear();
+    committed.clear();
+    return true;
+}
+
+bool AlarmStore::readRecord(QFile &log, quint64 offset, AlarmRecord &record) const
+{
+    if (!log.seek(qint64(offset))) {
+        return false;
+    }
+
+    quint32 length = 0;
+    qint64 timestamp = 0;
+    if (log.read(reinterpret_cast<char *>(&length), sizeof(length)) != sizeof(length)
+        || log.read(reinterpret_cast<char *>(&timestamp), sizeof(timestamp)) != sizeof(timestamp)) {
+        return false;
+    }
+
+    record.timestamp = timestamp;
+    record.payload = log.read(length);
+    return record.payload.size() == int(length);
+}
+
+QVector<AlarmRecord> AlarmStore::query(qint64 fromMs, qint64 toMs, int limit) const
+{
+    QVector<AlarmRecord> result;
+    if (limit <= 0 || fromMs > toMs) {
+        return result;
+    }
+
+    QMutexLocker locker(&m_segmentsMutex);
+
+    // 从活动段开始由新到旧遍历，i == m_segments.size()表示活动段
+    for (int i = m_segments.size(); i >= 0 && result.size() < limit; --i) {
+        const IndexEntry *entries;
+        quint64 count;
+        quint64 firstId;
+        QString logPath;
+        if (i == m_segments.size()) {
+            entries = m_activeIndex.constData();
+            count = quint64(m_activeIndex.size());
+            firstId = m_activeFirstId;
+            logPath = m_activeLog.fileName();
+        } else {
+            const Segment &segment = m_segments.at(i);
+            entries = segment.entries;
+            count = segment.count;
+            firstId = segment.firstId;
+            logPath = segment.logPath;
+        }
+
+        if (count == 0 || entries[0].timestamp > toMs) {
+            continue;
+        }
+        if (entries[count - 1].timestamp < fromMs) {
+            break; // 更早的段只会更旧
+        }
+
+        QFile log(logPath);
+        if (!log.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+
+        const IndexEntry *end = std::upper_bound(entries, entries + count, toMs,
+                                                 [](qint64 value, const IndexEntry &entry) {
+                                                     return value < entry.timestamp;
+                                                 });
+        for (const IndexEntry *it = end; it != entries && result.size() < limit;) {
+            --it;
+            if (it->timestamp < fromMs) {
+                break;
+            }
+            AlarmRecord record;
+            record.id = firstId + quint64(it - entries);
+            if (readRecord(log, it->offset, record)) {
+                result.append(record);
+            }
+        }
+    }
+
+    return result;
+}
+
+quint64 AlarmStore::nextId() const
+{
+    QMutexLocker locker(&m_segmentsMutex);
+    return m_activeFirstId + quint64(m_activeIndex.size());
+}
+
+QVector<AlarmRecord> AlarmStore::records(const QVector<quint64> &ids) const
+{
+    QVector<AlarmRecord> result;
+    result.reserve(ids.size());
+
+    QMutexLocker locker(&m_segmentsMutex);
+    QFile log;
+    for (quint64 id : ids) {
+        const IndexEntry *entries = nullptr;
+        quint64 firstId = 0;
+        QString logPath;
+        if (id >= m_activeFirstId) {
+            if (id - m_activeFirstId >= quint64(m_activeIndex.size())) {
+                continue;
+            }
+            entries = m_activeIndex.constData();
+            firstId = m_activeFirstId;
+            logPath = m_activeLog.fileName();
+        } else {
+            // 段按首序号有序，二分找到包含该序号的段
+            auto it = std::upper_bound(m_segments.constBegin(), m_segments.constEnd(), id,
+                                       [](quint64 value, const Segment &segment) {
+                                           return value < segment.firstId;
+                                       });
+            if (it == m_segments.constBegin()) {
+                continue;
+            }
+            --it;
+            if (id - it->firstId >= it->count) {
+                continue;
+            }
+            entries = it->entries;
+            firstId = it->firstId;
+            logPath = it->logPath;
+        }
+
+        if (log.fileName() != logPath) {
+            log.close();
+            log.setFileName(logPath);
+            if (!log.open(QIODevice::ReadOnly)) {
+                continue;
+            }
+        }
+
+        AlarmRecord record;
+        record.id = id;
+        if (readRecord(log, entries[id - firstId].offset, record)) {
+            result.append(record);
+        }
+    }
+    return result;
+}
+
+void AlarmStore::scan(quint64 untilId, const std::function<void(const AlarmRecord &)> &visitor) const
+{
+    struct ScanTarget
+    {
+        quint64 firstId;
+        quint64 count;
+        QString logPath;
+    };
+
+    // 只在锁内取段快照，顺序读取数据文件时不阻塞写线程
+    QVector<ScanTarget> targets;
+    {
+        QMutexLocker locker(&m_segmentsMutex);
+        for (const Segment &segment : m_segments) {
+            targets.append({segment.firstId, segment.count, segment.logPath});
+        }
+        targets.append({m_activeFirstId, quint64(m_activeIndex.size()), m_activeLog.fileName()});
+    }
+
+    for (const ScanTarget &target : targets) {
+        if (target.firstId >= untilId) {
+            break;
+        }
+
+        QFile log(target.logPath);
+        if (!log.open(QIODevice::ReadOnly)) {
+            continue; // 段可能刚被淘汰
+        }
+
+        quint64 count = qMin(target.count, untilId - target.firstId);
+        qint64 offset = 0;
+        for (quint64 i = 0; i < count; ++i) {
+            AlarmRecord record;
+            record.id = target.firstId + i;
+            if (!readRecord(log, quint64(offset), record)) {
+                break;
+            }
+            offset += RECORD_HEADER_SIZE + record.payload.size();
+            visitor(record);
+        }
+    }
+}
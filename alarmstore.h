@@ -0,0 +1,124 @@
+#ifndef ALARMSTORE_H
+#define ALARMSTORE_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QFile>
+#include <QList>
+#include <QVector>
+#include <QString>
+#include <QByteArray>
+#include <atomic>
+#include <functional>
+
+// 一条持久化的报警记录
+struct AlarmRecord
+{
+    quint64 id = 0;         // 全局递增序号
+    qint64 timestamp = 0;   // 毫秒时间戳
+    QByteArray payload;     // UTF-8原文
+};
+
+// 报警历史存储
+// 只追加的段文件(.log)加上定长时间索引(.idx)，段写满后封存并内存映射，
+// 按时间查询时对索引二分查找。写入在后台线程上成组提交，append()只入队。
+class AlarmStore : public QThread
+{
+    Q_OBJECT
+public:
+    AlarmStore(const QString &dir, qint64 segmentBytes, int maxSegments, QObject *parent = nullptr);
+    ~AlarmStore();
+
+    bool open();
+    void stop();
+
+    // 线程安全，不会阻塞在磁盘上
+    void append(qint64 timestamp, const QString &payload);
+
+    // 返回[fromMs, toMs]内最多limit条记录，由新到旧排列
+    QVector<AlarmRecord> query(qint64 fromMs, qint64 toMs, int limit = 1000) const;
+
+    // 按序号读取记录，已被淘汰的序号会被跳过
+    QVector<AlarmRecord> records(const QVector<quint64> &ids) const;
+
+    // 由旧到新顺序遍历序号小于untilId的全部记录，用于重建派生索引
+    void scan(quint64 untilId, const std::function<void(const AlarmRecord &)> &visitor) const;
+
+    quint64 nextId() const;
+    quint64 droppedCount() const { return m_dropped.load(); }
+
+signals:
+    // 在写线程上发出，记录已落盘且可查询
+    void recordsCommitted(const QVector<AlarmRecord> &records);
+    // 在写线程上发出，序号小于firstId的记录所在的段已被淘汰删除
+    void segmentsExpired(quint64 firstId);
+    void errorOccurred(const QString &error_msg);
+
+protected:
+    void run() override;
+
+private:
+    // 索引项，按本机字节序直接映射
+    struct IndexEntry
+    {
+        qint64 timestamp;
+        quint64 offset;
+    };
+
+    struct Segment
+    {
+        quint64 firstId = 0;
+        QString logPath;
+        QString idxPath;
+        QFile *idxFile = nullptr;
+        const IndexEntry *entries = nullptr;
+        quint64 count = 0;
+    };
+
+    struct PendingAlarm
+    {
+        qint64 timestamp;
+        QByteArray payload;
+    };
+
+    QString segmentPath(quint64 firstId, const QString &suffix) const;
+    bool mapSegment(Segment &segment);
+    void unmapSegment(Segment &segment);
+    bool openActiveSegment(quint64 firstId);
+    void closeActiveSegment();
+    void rotateSegment();
+    void enforceRetention();
+    void writeBatch(const QVector<PendingAlarm> &batch);
+    bool commit(QByteArray &logBuf, QByteArray &idxBuf, QVector<IndexEntry> &entries,
+                QVector<AlarmRecord> &committed);
+    bool readRecord(QFile &log, quint64 offset, AlarmRecord &record) const;
+
+    QString m_dir;
+    qint64 m_segmentBytes;
+    int m_maxSegments;
+    std::atomic<bool> m_stop;
+    std::atomic<quint64> m_dropped;
+
+    // 待写入队列
+    QMutex m_queueMutex;
+    QWaitCondition m_queueCond;
+    QVector<PendingAlarm> m_queue;
+
+    // 已封存的段（由旧到新）和活动段索引，查询与轮转都在此锁下进行
+    mutable QMutex m_segmentsMutex;
+    QList<Segment> m_segments;
+    quint64 m_activeFirstId;
+    QVector<IndexEntry> m_activeIndex;
+
+    // 以下只在写线程中访问
+    QFile m_activeLog;
+    QFile m_activeIdx;
+    qint64 m_activeLogSize;
+    qint64 m_lastTimestamp;
+    bool m_writeFailed;
+
+    static const int MAX_PENDING = 100000;
+};
+
+#endif // ALARMSTORE_H
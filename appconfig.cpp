@@ -0,0 +1,135 @@
+#include "appconfig.h"
+#include <QCoreApplication>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QDebug>
+
+QString AppConfig::defaultPath()
+{
+    return QCoreApplication::applicationDirPath() + "/StreamHive.ini";
+}
+
+AppConfig AppConfig::load(const QString &path)
+{
+    AppConfig config;
+    QSettings settings(path, QSettings::IniFormat);
+    settings.setIniCodec("UTF-8");
+
+    settings.beginGroup("zmq");
+    // 早期版本只有单个server_ip，没有servers时沿用
+    config.servers = settings.value("servers", settings.value("server_ip", config.servers)).toStringList();
+    config.alarmTopicFilter = settings.value("topic_filter", config.alarmTopicFilter).toBool();
+    settings.endGroup();
+
+    settings.beginGroup("alarm");
+    config.alarmHistoryLimit = settings.value("history_limit", config.alarmHistoryLimit).toInt();
+    config.alarmRulesFile = settings.value("rules_file").toString();
+    config.alarmRateLimit = settings.value("rate_limit", config.alarmRateLimit).toDouble();
+    config.alarmRateBurst = settings.value("rate_burst", config.alarmRateBurst).toInt();
+    config.alarmSuppressWindowMs = settings.value("suppress_window_ms", config.alarmSuppressWindowMs).toInt();
+    config.alarmStoreDir = settings.value("store_dir").toString();
+    config.alarmSegmentBytes = settings.value("segment_bytes", config.alarmSegmentBytes).toLongLong();
+    config.alarmMaxSegments = settings.value("max_segments", config.alarmMaxSegments).toInt();
+    settings.endGroup();
+
+    settings.beginGroup("clip");
+    config.clipDir = settings.value("dir").toString();
+    config.clipPreSeconds = settings.value("pre_seconds", config.clipPreSeconds).toInt();
+    config.clipPostSeconds = settings.value("post_seconds", config.clipPostSeconds).toInt();
+    config.clipBufferMB = settings.value("buffer_mb", config.clipBufferMB).toInt();
+    config.clipFormat = settings.value("format", config.clipFormat).toString();
+    config.clipOnAlarm = settings.value("on_alarm", config.clipOnAlarm).toBool();
+    settings.endGroup();
+
+    settings.beginGroup("replay");
+    config.replaySeconds = settings.value("seconds", config.replaySeconds).toInt();
+    settings.endGroup();
+
+    settings.beginGroup("snapshot");
+    config.snapshotDir = settings.value("dir").toString();
+    config.snapshotFormat = settings.value("format", config.snapshotFormat).toString();
+    config.snapshotQuality = settings.value("quality", config.snapshotQuality).toInt();
+    config.snapshotThreads = settings.value("threads", config.snapshotThreads).toInt();
+    settings.endGroup();
+
+    settings.beginGroup("sample");
+    config.sampleStreams = settings.value("streams").toStringList();
+    config.sampleDir = settings.value("dir").toString();
+    config.sampleIntervalMs = settings.value("interval_ms", config.sampleIntervalMs).toInt();
+    config.sampleWidth = settings.value("width", config.sampleWidth).toInt();
+    config.sampleHeight = settings.value("height", config.sampleHeight).toInt();
+    config.sampleFormat = settings.value("format", config.sampleFormat).toString();
+    config.sampleQuality = settings.value("quality", config.sampleQuality).toInt();
+    config.sampleThreads = settings.value("threads", config.sampleThreads).toInt();
+    config.samplePending = settings.value("pending", config.samplePending).toInt();
+    config.sampleQueueMB = settings.value("queue_mb", config.sampleQueueMB).toInt();
+    settings.endGroup();
+
+    settings.beginGroup("record");
+    config.recordStreams = settings.value("streams").toStringList();
+    config.recordDir = settings.value("dir").toString();
+    config.recordSegmentSeconds = settings.value("segment_seconds", config.recordSegmentSeconds).toInt();
+    config.recordPreallocMB = settings.value("prealloc_mb", config.recordPreallocMB).toInt();
+    config.recordQueueMB = settings.value("queue_mb", config.recordQueueMB).toInt();
+    config.recordQuotaGB = settings.value("quota_gb", config.recordQuotaGB).toInt();
+    settings.endGroup();
+
+    settings.beginGroup("playback");
+    config.playbackCacheMB = settings.value("cache_mb", config.playbackCacheMB).toInt();
+    settings.endGroup();
+
+    settings.beginGroup("timelapse");
+    config.timelapseIntervalSeconds = settings.value("interval_s", config.timelapseIntervalSeconds).toInt();
+    config.timelapseThumbWidth = settings.value("thumb_width", config.timelapseThumbWidth).toInt();
+    config.timelapseColumns = settings.value("columns", config.timelapseColumns).toInt();
+    config.timelapseCpuBudget = settings.value("cpu_budget", config.timelapseCpuBudget).toDouble();
+    config.timelapseFps = settings.value("fps", config.timelapseFps).toInt();
+    settings.endGroup();
+
+    settings.beginGroup("export");
+    config.exportStreams = settings.value("streams").toStringList();
+    config.exportFormat = settings.value("format", config.exportFormat).toString();
+    config.exportWidth = settings.value("width", config.exportWidth).toInt();
+    config.exportHeight = settings.value("height", config.exportHeight).toInt();
+    config.exportSlots = settings.value("slots", config.exportSlots).toInt();
+    config.exportAnnounce = settings.value("announce", config.exportAnnounce).toString();
+    settings.endGroup();
+
+    settings.beginGroup("restream");
+    config.restreamPort = settings.value("port", config.restreamPort).toInt();
+    config.restreamClientQueueKB = settings.value("client_queue_kb", config.restreamClientQueueKB).toInt();
+    settings.endGroup();
+
+    settings.beginGroup("telemetry");
+    config.telemetryPort = settings.value("port", config.telemetryPort).toInt();
+    config.telemetryIntervalMs = settings.value("interval_ms", config.telemetryIntervalMs).toInt();
+    config.telemetryClientId = settings.value("client_id").toString();
+    settings.endGroup();
+
+    if (config.alarmRulesFile.isEmpty()) {
+        config.alarmRulesFile = QCoreApplication::applicationDirPath() + "/alarm_rules.json";
+    }
+    if (config.alarmStoreDir.isEmpty()) {
+        config.alarmStoreDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/alarms";
+    }
+
+    if (config.clipDir.isEmpty()) {
+        config.clipDir = QStandardPaths::writableLocation(QStandardPaths::MoviesLocation) + "/StreamHive";
+    }
+    if (config.snapshotDir.isEmpty()) {
+        config.snapshotDir = QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) + "/StreamHive";
+    }
+    if (config.sampleDir.isEmpty()) {
+        config.sampleDir = QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) + "/StreamHive/samples";
+    }
+    if (config.recordDir.isEmpty()) {
+        config.recordDir = QStandardPaths::writableLocation(QStandardPaths::MoviesLocation) + "/StreamHive/record";
+    }
+    if (config.telemetryClientId.isEmpty()) {
+        config.telemetryClientId = QSysInfo::machineHostName();
+    }
+
+    qDebug() << "加载配置:" << path;
+    return config;
+}
@@ -0,0 +1,98 @@
+#ifndef APPCONFIG_H
+#define APPCONFIG_H
+
+#include <QString>
+#include <QStringList>
+
+// 程序配置，从可执行文件同目录下的StreamHive.ini读取，缺省项使用默认值
+struct AppConfig
+{
+    // 消息服务
+    QStringList servers = QStringList() << "192.168.10.107";  // 同时连接的全部消息服务器
+    bool alarmTopicFilter = false;                  // 只订阅正在观看的流的报警主题，旧服务端不带主题，默认关闭
+
+    // 报警显示
+    int alarmHistoryLimit = 2000;
+
+    // 报警规则文件，为空时使用可执行文件同目录下的alarm_rules.json，文件不存在则不过滤
+    QString alarmRulesFile;
+
+    // 报警风暴抑制，按(流, 类型)限速，rate为0表示不限速
+    double alarmRateLimit = 5.0;
+    int alarmRateBurst = 10;
+    int alarmSuppressWindowMs = 10000;
+
+    // 报警历史存储
+    QString alarmStoreDir;                          // 为空时使用应用数据目录下的alarms
+    qint64 alarmSegmentBytes = 64 * 1024 * 1024;    // 单个段文件大小上限
+    int alarmMaxSegments = 256;                     // 超过后删除最旧的段
+
+    // 报警片段：报警前后各保留若干秒，按流拷贝导出
+    QString clipDir;                                // 为空时使用视频目录下的StreamHive
+    int clipPreSeconds = 10;                        // 0表示不缓冲，也就无法导出片段
+    int clipPostSeconds = 10;
+    int clipBufferMB = 64;                          // 每路流报警前缓冲的内存上限
+    QString clipFormat = "mp4";                     // mp4或mkv
+    bool clipOnAlarm = true;                        // 正在观看的流报警时自动导出
+
+    // 即时回看，从同一个压缩包缓冲中取，缓冲时长取两者中较长的，内存上限仍为clipBufferMB
+    int replaySeconds = 30;
+
+    // 截图：在后台用MJPEG/PNG编码器保存
+    QString snapshotDir;                            // 为空时使用图片目录下的StreamHive
+    QString snapshotFormat = "jpg";                 // jpg或png
+    int snapshotQuality = 90;                       // 1-100，只对jpg有效
+    int snapshotThreads = 2;                        // 编码线程数
+
+    // 连续取样：按间隔保存缩小后的画面用于采集数据，streams为空表示不取样
+    QStringList sampleStreams;                      // 流ID或RTSP URL
+    QString sampleDir;                              // 为空时使用图片目录下的StreamHive/samples
+    int sampleIntervalMs = 1000;
+    int sampleWidth = 640;                          // 缩小到此尺寸以内，0表示保持原尺寸
+    int sampleHeight = 360;
+    QString sampleFormat = "jpg";                   // jpg或png
+    int sampleQuality = 90;
+    int sampleThreads = 2;                          // 编码线程数，所有流共用
+    int samplePending = 64;                         // 等待写盘的样本上限，超出时丢弃
+    int sampleQueueMB = 8;                          // 每路流待解码队列的内存上限
+
+    // 连续录像：按流拷贝写成分片MP4，streams为空表示不录像
+    QStringList recordStreams;                      // 流ID或RTSP URL
+    QString recordDir;                              // 为空时使用视频目录下的StreamHive/record
+    int recordSegmentSeconds = 300;                 // 单个分段时长，在关键帧处切换
+    int recordPreallocMB = 64;                      // 新分段预先分配的空间
+    int recordQueueMB = 32;                         // 每路流待写队列的内存上限
+    int recordQuotaGB = 100;                        // 录像目录总大小上限，0表示不限制
+
+    // 录像回放
+    int playbackCacheMB = 512;                      // 已解码GOP缓存的内存上限
+
+    // 缩略图条和延时视频，只取关键帧
+    int timelapseIntervalSeconds = 60;              // 取关键帧的间隔
+    int timelapseThumbWidth = 160;
+    int timelapseColumns = 20;                      // 精灵图每行的格数
+    double timelapseCpuBudget = 1.0;                // 允许占用的CPU核数
+    int timelapseFps = 25;                          // 延时视频的帧率
+
+    // 共享内存导出：解码后的画面写入共享内存供外部分析进程读取，streams为空表示不导出
+    QStringList exportStreams;                      // 流ID或RTSP URL
+    QString exportFormat = "yuv";                   // yuv（YUV420P）或rgb（RGB24）
+    int exportWidth = 0;                            // 缩小到此尺寸以内，0表示保持原尺寸
+    int exportHeight = 0;
+    int exportSlots = 4;                            // 每路流共享内存中的画面槽数
+    QString exportAnnounce = "tcp://127.0.0.1:5560";    // 新画面通知的ZMQ PUB地址，为空表示不通知
+
+    // 本地转发：以HTTP提供MPEG-TS流，多个观看端共用一路摄像机连接，port为0表示不启用
+    int restreamPort = 0;
+    int restreamClientQueueKB = 2048;               // 每个客户端待发数据上限，超出时丢到下一个关键帧
+
+    // 客户端遥测，interval为0表示不发布
+    int telemetryPort = 5557;
+    int telemetryIntervalMs = 5000;
+    QString telemetryClientId;                      // 为空时使用主机名
+
+    static QString defaultPath();
+    static AppConfig load(const QString &path = defaultPath());
+};
+
+#endif // APPCONFIG_H
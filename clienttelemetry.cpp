@@ -0,0 +1,107 @@
+#include "clienttelemetry.h"
+#include <QDateTime>
+#include <QMutexLocker>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_LINUX)
+#include <QFile>
+#include <QList>
+#include <unistd.h>
+#endif
+
+StreamStatsRegistry &StreamStatsRegistry::instance()
+{
+    static StreamStatsRegistry registry;
+    return registry;
+}
+
+QSharedPointer<StreamCounters> StreamStatsRegistry::counters(const QString &streamId)
+{
+    QMutexLocker locker(&m_mutex);
+    QSharedPointer<StreamCounters> &counters = m_streams[streamId];
+    if (!counters) {
+        counters.reset(new StreamCounters());
+    }
+    return counters;
+}
+
+QHash<QString, QSharedPointer<StreamCounters> > StreamStatsRegistry::streams() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_streams;
+}
+
+ProcessUsage::ProcessUsage()
+    : m_lastCpuUs(cpuTimeUs())
+    , m_lastWallMs(QDateTime::currentMSecsSinceEpoch())
+{
+}
+
+double ProcessUsage::cpuPercent()
+{
+    qint64 cpuUs = cpuTimeUs();
+    qint64 wallMs = QDateTime::currentMSecsSinceEpoch();
+    double percent = 0.0;
+    if (wallMs > m_lastWallMs && cpuUs >= m_lastCpuUs) {
+        percent = double(cpuUs - m_lastCpuUs) / 10.0 / double(wallMs - m_lastWallMs);
+    }
+    m_lastCpuUs = cpuUs;
+    m_lastWallMs = wallMs;
+    return percent;
+}
+
+qint64 ProcessUsage::cpuTimeUs()
+{
+#if defined(Q_OS_WIN)
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    // FILETIME单位为100纳秒
+    quint64 k = (quint64(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+    quint64 u = (quint64(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+    return qint64((k + u) / 10);
+#elif defined(Q_OS_LINUX)
+    // /proc/self/stat的第14、15列为用户态、内核态时间（时钟滴答）
+    QFile file("/proc/self/stat");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    QByteArray line = file.readAll();
+    int pos = line.lastIndexOf(')');
+    QList<QByteArray> fields = line.mid(pos + 2).split(' ');
+    if (fields.size() < 13) {
+        return 0;
+    }
+    qint64 ticks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+    return ticks * 1000000 / sysconf(_SC_CLK_TCK);
+#else
+    return 0;
+#endif
+}
+
+qint64 ProcessUsage::residentKb() const
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return qint64(counters.WorkingSetSize / 1024);
+#elif defined(Q_OS_LINUX)
+    // /proc/self/statm第二列为常驻页数
+    QFile file("/proc/self/statm");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    QList<QByteArray> fields = file.readAll().split(' ');
+    if (fields.size() < 2) {
+        return 0;
+    }
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE) / 1024;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,52 @@
+#ifndef CLIENTTELEMETRY_H
+#define CLIENTTELEMETRY_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <atomic>
+
+// 单路流的解码计数器，播放线程只做原子累加，遥测定时读取并按差值计算速率
+struct StreamCounters
+{
+    std::atomic<quint64> frames{0};         // 解码出的帧数
+    std::atomic<quint64> decodeUs{0};       // 解码耗时累计（微秒），只含avcodec_send_packet/receive_frame
+    std::atomic<quint64> drops{0};          // 解码失败丢弃的包/帧数
+    std::atomic<quint64> reconnects{0};     // 断流或打开失败后的自动重连次数，不含使用者主动重新打开
+    std::atomic<qint64> ringBytes{0};       // 报警前/回看缓冲当前占用的字节数
+};
+
+// 按流ID登记的计数器表，同一路流多次播放共用一组计数器
+class StreamStatsRegistry
+{
+public:
+    static StreamStatsRegistry &instance();
+
+    QSharedPointer<StreamCounters> counters(const QString &streamId);
+    QHash<QString, QSharedPointer<StreamCounters> > streams() const;
+
+private:
+    StreamStatsRegistry() {}
+
+    mutable QMutex m_mutex;
+    QHash<QString, QSharedPointer<StreamCounters> > m_streams;
+};
+
+// 进程CPU与内存占用采样，CPU为两次调用之间的平均占用（按单核100%计）
+class ProcessUsage
+{
+public:
+    ProcessUsage();
+
+    double cpuPercent();
+    qint64 residentKb() const;
+
+private:
+    static qint64 cpuTimeUs();
+
+    qint64 m_lastCpuUs;
+    qint64 m_lastWallMs;
+};
+
+#endif // CLIENTTELEMETRY_H
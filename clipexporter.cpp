@@ -0,0 +1,130 @@
+#include "clipexporter.h"
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QDebug>
+
+extern "C"
+{
+    #include "libavcodec/avcodec.h"
+}
+
+namespace {
+
+// 流停止后仍没有收到结束时间之后的包时，最多再等这么久
+const qint64 INPUT_GRACE_MS = 5000;
+
+}
+
+ClipExporter::ClipExporter(const QString &path, qint64 untilWallMs, QObject *parent)
+    : QThread(parent)
+    , m_path(path)
+    , m_untilWallMs(untilWallMs)
+    , m_inputDone(false)
+    , m_receivedAny(false)
+{
+}
+
+ClipExporter::~ClipExporter()
+{
+    finishInput();
+    wait();
+    for (AVPacket *packet : m_pending) {
+        av_packet_free(&packet);
+    }
+}
+
+void ClipExporter::streamOpened(const AVCodecParameters *codecpar, AVRational timeBase)
+{
+    Q_UNUSED(codecpar);
+    Q_UNUSED(timeBase);
+    // 注册时补发的通知忽略；收到过包之后流被重新打开，参数可能已变化，片段到此为止
+    QMutexLocker locker(&m_mutex);
+    if (m_receivedAny) {
+        m_inputDone = true;
+        m_cond.wakeOne();
+    }
+}
+
+void ClipExporter::packetReceived(const AVPacket *packet, qint64 wallMs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_inputDone) {
+        return;
+    }
+    if (wallMs > m_untilWallMs || m_pending.size() >= MAX_PENDING) {
+        m_inputDone = true;
+        m_cond.wakeOne();
+        return;
+    }
+
+    AVPacket *ref = av_packet_clone(packet);
+    if (ref) {
+        m_receivedAny = true;
+        m_pending.append(ref);
+        m_cond.wakeOne();
+    }
+}
+
+void ClipExporter::streamClosed()
+{
+    finishInput();
+}
+
+void ClipExporter::finishInput()
+{
+    QMutexLocker locker(&m_mutex);
+    m_inputDone = true;
+    m_cond.wakeOne();
+}
+
+void ClipExporter::run()
+{
+    bool ok = m_preRoll && !m_preRoll->packets.isEmpty()
+              && m_muxer.open(m_path, m_preRoll->codecpar, m_preRoll->timeBase);
+
+    // 报警前的部分
+    if (ok) {
+        for (const AVPacket *packet : m_preRoll->packets) {
+            if (!m_muxer.write(packet)) {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    // 报警后的部分，边收边写
+    QVector<AVPacket *> batch;
+    forever {
+        bool done = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_pending.isEmpty() && !m_inputDone) {
+                m_cond.wait(&m_mutex, 1000);
+            }
+            batch.swap(m_pending);
+            if (QDateTime::currentMSecsSinceEpoch() > m_untilWallMs + INPUT_GRACE_MS) {
+                m_inputDone = true;
+            }
+            done = m_inputDone && batch.isEmpty();
+        }
+        if (done) {
+            break;
+        }
+
+        for (AVPacket *packet : batch) {
+            if (ok && !m_muxer.write(packet)) {
+                ok = false;
+            }
+            av_packet_free(&packet);
+        }
+        batch.clear();
+    }
+
+    if (!m_muxer.close()) {
+        ok = false;
+    }
+    m_preRoll.clear();
+
+    qDebug() << (ok ? "报警片段已导出:" : "报警片段导出失败:") << m_path;
+    emit exportFinished(m_path, ok);
+}
@@ -0,0 +1,60 @@
+#ifndef CLIPEXPORTER_H
+#define CLIPEXPORTER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include "packetsink.h"
+#include "packetring.h"
+#include "streamcopymuxer.h"
+
+// 报警片段导出
+// 以环形缓冲取出的报警前片段开头，再作为PacketSink接收之后的包直到untilWallMs，
+// 按流拷贝转封装为MP4/MKV（由文件扩展名决定），不重新编码。封装和写盘都在本线程上进行。
+// 应先注册为PacketSink再从环形缓冲取出报警前片段，两者重叠的包按dts去掉。
+class ClipExporter : public QThread, public PacketSink
+{
+    Q_OBJECT
+public:
+    ClipExporter(const QString &path, qint64 untilWallMs, QObject *parent = nullptr);
+    ~ClipExporter();
+    
+    // 需在start()之前设置
+    void setPreRoll(const QSharedPointer<PacketClip> &preRoll) { m_preRoll = preRoll; }
+
+    QString path() const { return m_path; }
+
+    // PacketSink，在解复用线程上调用
+    void streamOpened(const AVCodecParameters *codecpar, AVRational timeBase) override;
+    void packetReceived(const AVPacket *packet, qint64 wallMs) override;
+    void streamClosed() override;
+
+signals:
+    void exportFinished(const QString &path, bool ok);
+
+protected:
+    void run() override;
+
+private:
+    void finishInput();
+
+    QString m_path;
+    QSharedPointer<PacketClip> m_preRoll;
+    qint64 m_untilWallMs;
+
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    QVector<AVPacket *> m_pending;
+    bool m_inputDone;
+    bool m_receivedAny;
+
+    // 只在导出线程中访问
+    StreamCopyMuxer m_muxer;
+
+    static const int MAX_PENDING = 4096;
+};
+
+#endif // CLIPEXPORTER_H
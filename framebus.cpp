@@ -0,0 +1,260 @@
+#include "framebus.h"
+#include "streamhub.h"
+#include "streamPlayer.h"
+#include <QMutexLocker>
+#include <QDebug>
+
+extern "C"
+{
+    #include "libavcodec/avcodec.h"
+    #include "libavutil/frame.h"
+}
+
+BusItem::~BusItem()
+{
+    avcodec_parameters_free(&codecpar);
+    av_packet_free(&packet);
+    av_frame_free(&frame);
+}
+
+bool BusItem::isKey() const
+{
+    if (packet) {
+        return packet->flags & AV_PKT_FLAG_KEY;
+    }
+    if (frame) {
+#ifdef AV_FRAME_FLAG_KEY
+        return frame->flags & AV_FRAME_FLAG_KEY;
+#else
+        return frame->key_frame;
+#endif
+    }
+    return false;
+}
+
+FrameSubscription::FrameSubscription(DropPolicy policy, int maxItems)
+    : m_policy(policy)
+    , m_maxItems(qMax(1, maxItems))
+    , m_mediaItems(0)
+    , m_waitKey(false)
+    , m_closed(false)
+    , m_dropped(0)
+{
+}
+
+FrameSubscription::~FrameSubscription()
+{
+    close();
+}
+
+QSharedPointer<BusItem> FrameSubscription::pop(int timeoutMs)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_items.isEmpty() && !m_closed) {
+        m_cond.wait(&m_mutex, ulong(qMax(0, timeoutMs)));
+    }
+    if (m_items.isEmpty() || m_closed) {
+        return QSharedPointer<BusItem>();
+    }
+    QSharedPointer<BusItem> item = m_items.dequeue();
+    if (item->kind == BusItem::Packet || item->kind == BusItem::Frame) {
+        m_mediaItems--;
+    }
+    return item;
+}
+
+void FrameSubscription::close()
+{
+    QMutexLocker locker(&m_mutex);
+    m_closed = true;
+    m_items.clear();
+    m_mediaItems = 0;
+    m_cond.wakeAll();
+}
+
+int FrameSubscription::queued() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_items.size();
+}
+
+void FrameSubscription::streamOpened(const AVCodecParameters *codecpar, AVRational timeBase)
+{
+    BusItem *item = new BusItem();
+    item->kind = BusItem::Opened;
+    item->codecpar = avcodec_parameters_alloc();
+    if (item->codecpar) {
+        avcodec_parameters_copy(item->codecpar, codecpar);
+    }
+    item->timeBase = timeBase;
+    push(item);
+}
+
+void FrameSubscription::packetReceived(const AVPacket *packet, qint64 wallMs)
+{
+    AVPacket *ref = av_packet_clone(packet);
+    if (!ref) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    BusItem *item = new BusItem();
+    item->kind = BusItem::Packet;
+    item->packet = ref;
+    item->wallMs = wallMs;
+    push(item);
+}
+
+void FrameSubscription::streamClosed()
+{
+    BusItem *item = new BusItem();
+    item->kind = BusItem::Closed;
+    push(item);
+}
+
+void FrameSubscription::frameDecoded(const AVFrame *frame, qint64 wallMs)
+{
+    // 只增加缓冲区引用，不拷贝画面数据
+    AVFrame *ref = av_frame_clone(frame);
+    if (!ref) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    BusItem *item = new BusItem();
+    item->kind = BusItem::Frame;
+    item->frame = ref;
+    item->wallMs = wallMs;
+    push(item);
+}
+
+void FrameSubscription::push(BusItem *item)
+{
+    QSharedPointer<BusItem> shared(item);
+    bool media = item->kind == BusItem::Packet || item->kind == BusItem::Frame;
+
+    QMutexLocker locker(&m_mutex);
+    if (m_closed) {
+        return;
+    }
+    if (!media) {
+        // 重新打开后从关键帧开始，之前的丢弃状态不再有意义
+        if (item->kind == BusItem::Opened) {
+            m_waitKey = false;
+        }
+        m_items.enqueue(shared);
+        m_cond.wakeOne();
+        return;
+    }
+
+    if (m_waitKey) {
+        if (!item->isKey()) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m_waitKey = false;
+    }
+    if (m_mediaItems >= m_maxItems) {
+        switch (m_policy) {
+        case DropOldest:
+            for (int i = 0; i < m_items.size(); ++i) {
+                BusItem::Kind kind = m_items.at(i)->kind;
+                if (kind == BusItem::Packet || kind == BusItem::Frame) {
+                    m_items.removeAt(i);
+                    m_mediaItems--;
+                    break;
+                }
+            }
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case DropNewest:
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        case DropToKeyframe:
+            // 已排队的包和画面全部作废，保留Opened/Closed
+            for (int i = m_items.size() - 1; i >= 0; --i) {
+                BusItem::Kind kind = m_items.at(i)->kind;
+                if (kind == BusItem::Packet || kind == BusItem::Frame) {
+                    m_items.removeAt(i);
+                }
+            }
+            m_dropped.fetch_add(quint64(m_mediaItems), std::memory_order_relaxed);
+            m_mediaItems = 0;
+            if (!item->isKey()) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                m_waitKey = true;
+                return;
+            }
+            break;
+        }
+    }
+    m_items.enqueue(shared);
+    m_mediaItems++;
+    m_cond.wakeOne();
+}
+
+FrameBus::FrameBus(StreamHub *hub, QObject *parent)
+    : QObject(parent)
+    , m_hub(hub)
+{
+}
+
+FrameBus::~FrameBus()
+{
+    for (auto it = m_subscriptions.constBegin(); it != m_subscriptions.constEnd(); ++it) {
+        detach(it.key(), it.value());
+        delete it.key();
+    }
+}
+
+FrameSubscription *FrameBus::subscribe(const QString &url, const QString &streamId, int kinds,
+                                       FrameSubscription::DropPolicy policy, int maxItems)
+{
+    if (!m_hub || !(kinds & (Packets | Frames))) {
+        return nullptr;
+    }
+
+    Entry entry;
+    entry.kinds = kinds;
+    entry.player = m_hub->acquire(url, streamId, kinds & Frames);
+    FrameSubscription *subscription = new FrameSubscription(policy, maxItems);
+    if (kinds & Packets) {
+        entry.player->addPacketSink(subscription);
+    }
+    if (kinds & Frames) {
+        entry.player->addFrameSink(subscription);
+    }
+    m_subscriptions.insert(subscription, entry);
+    qDebug() << "帧总线订阅:" << (streamId.isEmpty() ? url : streamId) << "订阅数:" << m_subscriptions.size();
+    return subscription;
+}
+
+void FrameBus::unsubscribe(FrameSubscription *subscription)
+{
+    auto it = m_subscriptions.find(subscription);
+    if (it == m_subscriptions.end()) {
+        return;
+    }
+    Entry entry = it.value();
+    m_subscriptions.erase(it);
+    detach(subscription, entry);
+    if (subscription->dropped() > 0) {
+        qDebug() << "帧总线订阅结束，丢弃:" << subscription->dropped();
+    }
+    delete subscription;
+}
+
+void FrameBus::detach(FrameSubscription *subscription, const Entry &entry)
+{
+    // 先摘下，返回后解复用线程不会再回调；StreamHub先销毁时播放器已随之停止并释放
+    if (m_hub) {
+        if (entry.kinds & Packets) {
+            entry.player->removePacketSink(subscription);
+        }
+        if (entry.kinds & Frames) {
+            entry.player->removeFrameSink(subscription);
+        }
+    }
+    subscription->close();
+    if (m_hub) {
+        m_hub->release(entry.player, entry.kinds & Frames);
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef FRAMEBUS_H
+#define FRAMEBUS_H
+
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QWaitCondition>
+#include <atomic>
+#include "framesink.h"
+#include "packetsink.h"
+
+class StreamHub;
+class StreamPlayer;
+
+// 总线上传递的一项，持有包或画面的引用，析构时释放；同一项可以交给多个使用者
+struct BusItem
+{
+    enum Kind { Opened, Packet, Frame, Closed };
+
+    BusItem() {}
+    ~BusItem();
+
+    Kind kind = Packet;
+    AVCodecParameters *codecpar = nullptr;  // 只有Opened有
+    AVRational timeBase = {1, 90000};       // 只有Opened有
+    AVPacket *packet = nullptr;
+    AVFrame *frame = nullptr;
+    qint64 wallMs = 0;
+
+    bool isKey() const;
+
+private:
+    Q_DISABLE_COPY(BusItem)
+};
+
+// 一个使用者对一路流的订阅
+// 在解复用线程上收到包和画面，只增加引用后放入自己的有界队列，使用者在自己的线程上取出。
+// 队列满时按丢弃策略处理，不阻塞解复用线程，也不影响其他使用者。Opened/Closed不计入上限也不丢弃。
+class FrameSubscription : public PacketSink, public FrameSink
+{
+public:
+    enum DropPolicy {
+        DropOldest,         // 丢弃最旧的一项，适合只要最新画面的分析
+        DropNewest,         // 丢弃新到的一项，保持已排队内容连续
+        DropToKeyframe      // 清空并丢到下一个关键帧，适合需要解码或转封装的压缩包使用者
+    };
+
+    FrameSubscription(DropPolicy policy, int maxItems);
+    ~FrameSubscription();
+
+    // 最多等待timeoutMs，超时或已关闭时返回空指针
+    QSharedPointer<BusItem> pop(int timeoutMs);
+    // 唤醒等待中的pop，之后不再接收新内容
+    void close();
+
+    int queued() const;
+    quint64 dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    // PacketSink/FrameSink，在解复用线程上调用
+    void streamOpened(const AVCodecParameters *codecpar, AVRational timeBase) override;
+    void packetReceived(const AVPacket *packet, qint64 wallMs) override;
+    void streamClosed() override;
+    void frameDecoded(const AVFrame *frame, qint64 wallMs) override;
+
+private:
+    void push(BusItem *item);
+
+    DropPolicy m_policy;
+    int m_maxItems;
+    mutable QMutex m_mutex;
+    QWaitCondition m_cond;
+    QQueue<QSharedPointer<BusItem> > m_items;
+    int m_mediaItems;       // 队列中的包和画面数
+    bool m_waitKey;         // DropToKeyframe丢弃后等待关键帧
+    bool m_closed;
+    std::atomic<quint64> m_dropped;
+};
+
+// 进程内的帧总线
+// 按流发布压缩包和解码后的画面，任意多个使用者订阅同一路流时仍只有一个连接、一次解复用和一次解码。
+// 连接和解码由StreamHub共享，只有订阅画面的使用者才会打开解码。只在GUI线程中使用。
+class FrameBus : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Kind {
+        Packets = 0x1,
+        Frames = 0x2
+    };
+
+    explicit FrameBus(StreamHub *hub, QObject *parent = nullptr);
+    ~FrameBus();
+
+    // kinds为Kind的组合；返回的订阅由总线持有，调用unsubscribe释放
+    FrameSubscription *subscribe(const QString &url, const QString &streamId, int kinds,
+                                 FrameSubscription::DropPolicy policy, int maxItems);
+    // 使用者线程需已停止pop；返回后订阅已删除
+    void unsubscribe(FrameSubscription *subscription);
+
+    int subscriptionCount() const { return m_subscriptions.size(); }
+
+private:
+    struct Entry
+    {
+        StreamPlayer *player = nullptr;
+        int kinds = 0;
+    };
+
+    void detach(FrameSubscription *subscription, const Entry &entry);
+
+    QPointer<StreamHub> m_hub;
+    QHash<FrameSubscription *, Entry> m_subscriptions;
+};
+
+#endif // FRAMEBUS_H
@@ -0,0 +1,59 @@
+#include "frameconverter.h"
+
+extern "C"
+{
+    #include "libavutil/frame.h"
+    #include "libswscale/swscale.h"
+}
+
+FrameConverter::FrameConverter(Quality quality)
+    : m_flags(quality == Fast ? SWS_FAST_BILINEAR : quality == Smooth ? SWS_BICUBIC : SWS_BILINEAR)
+    , m_swsCtx(nullptr)
+{
+}
+
+FrameConverter::~FrameConverter()
+{
+    sws_freeContext(m_swsCtx);
+}
+
+QSize FrameConverter::fitSize(const AVFrame *frame, const QSize &maxSize)
+{
+    QSize size(frame->width, frame->height);
+    if (!maxSize.isEmpty() && (size.width() > maxSize.width() || size.height() > maxSize.height())) {
+        size.scale(maxSize, Qt::KeepAspectRatio);
+    }
+    return size;
+}
+
+bool FrameConverter::prepare(const AVFrame *frame, const QSize &size, int dstFormat)
+{
+    if (frame->width <= 0 || frame->height <= 0 || size.isEmpty()) {
+        return false;
+    }
+    m_swsCtx = sws_getCachedContext(m_swsCtx, frame->width, frame->height, AVPixelFormat(frame->format),
+                                    size.width(), size.height(), AVPixelFormat(dstFormat), m_flags,
+                                    nullptr, nullptr, nullptr);
+    return m_swsCtx != nullptr;
+}
+
+void FrameConverter::scale(const AVFrame *frame, uint8_t *const dst[], const int dstLinesize[])
+{
+    sws_scale(m_swsCtx, frame->data, frame->linesize, 0, frame->height, dst, dstLinesize);
+}
+
+QImage FrameConverter::toImage(const AVFrame *frame, const QSize &maxSize)
+{
+    QSize size = fitSize(frame, maxSize);
+    if (!prepare(frame, size, AV_PIX_FMT_RGB24)) {
+        return QImage();
+    }
+    QImage img(size, QImage::Format_RGB888);
+    if (img.isNull()) {
+        return QImage();
+    }
+    uint8_t *dst[4] = { img.bits(), nullptr, nullptr, nullptr };
+    int dstLinesize[4] = { int(img.bytesPerLine()), 0, 0, 0 };
+    scale(frame, dst, dstLinesize);
+    return img;
+}
@@ -0,0 +1,45 @@
+#ifndef FRAMECONVERTER_H
+#define FRAMECONVERTER_H
+
+#include <QImage>
+#include <QSize>
+#include <cstdint>
+
+struct AVFrame;
+struct SwsContext;
+
+// 解码帧的格式转换和缩放
+// 直播、录像回放、即时回看和共享内存导出共用。SwsContext按源尺寸、源格式、目标尺寸和格式缓存，
+// 只在这些变化时（例如流中途改分辨率）才重建。不是线程安全的，每个解码线程各用一个。
+class FrameConverter
+{
+public:
+    // 缩放算法：Fast用于缩略图，Smooth用于截图等单张高质量输出
+    enum Quality {
+        Fast,
+        Normal,
+        Smooth
+    };
+
+    explicit FrameConverter(Quality quality = Normal);
+    ~FrameConverter();
+
+    // maxSize为空时保持原尺寸，否则按比例缩小到其以内，不放大
+    static QSize fitSize(const AVFrame *frame, const QSize &maxSize);
+
+    // 准备转换到size和dstFormat（AVPixelFormat），失败返回false
+    bool prepare(const AVFrame *frame, const QSize &size, int dstFormat);
+    // 转换到调用者的缓冲区，需先prepare
+    void scale(const AVFrame *frame, uint8_t *const dst[], const int dstLinesize[]);
+
+    // 转为RGB888图像，直接写入图像内存；失败返回空图像
+    QImage toImage(const AVFrame *frame, const QSize &maxSize = QSize());
+
+private:
+    Q_DISABLE_COPY(FrameConverter)
+
+    int m_flags;
+    SwsContext *m_swsCtx;
+};
+
+#endif // FRAMECONVERTER_H
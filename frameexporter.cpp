@@ -0,0 +1,123 @@
+#include "frameexporter.h"
+#include "frameexportmanager.h"
+#include "framebus.h"
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QDebug>
+
+extern "C"
+{
+    #include "libavutil/frame.h"
+    #include "libavutil/imgutils.h"
+}
+
+FrameExporter::FrameExporter(const QString &streamId, FrameSubscription *subscription, FrameExportManager *manager,
+                             QObject *parent)
+    : QThread(parent)
+    , m_streamId(streamId)
+    , m_subscription(subscription)
+    , m_manager(manager)
+    , m_format(SharedFrameRing::YUV420P)
+    , m_slotCount(4)
+    , m_stop(false)
+    , m_exported(0)
+    , m_generation(0)
+{
+}
+
+FrameExporter::~FrameExporter()
+{
+    stop();
+    wait();
+}
+
+void FrameExporter::stop()
+{
+    m_stop.store(true);
+}
+
+void FrameExporter::run()
+{
+    while (!m_stop.load()) {
+        QSharedPointer<BusItem> item = m_subscription->pop(100);
+        if (item && item->kind == BusItem::Frame) {
+            exportFrame(item->frame, item->wallMs);
+        }
+    }
+    // 读者通过closed标志得知不再有新画面
+    m_ring.destroy();
+}
+
+bool FrameExporter::ensureRing(int bytes)
+{
+    if (m_ring.isOpen() && m_ring.slotBytes() >= bytes) {
+        return true;
+    }
+    // 名字只用字母数字，带上进程号和代数，避免与其他实例或旧的缓冲重名
+    QString id = m_streamId;
+    id.replace(QRegularExpression("[^A-Za-z0-9]"), "_");
+    QString name = QString("StreamHive_%1_%2_%3").arg(id.right(64)).arg(QCoreApplication::applicationPid())
+                       .arg(++m_generation);
+    if (!m_ring.create(name, m_slotCount, bytes)) {
+        return false;
+    }
+    qDebug() << "共享内存导出:" << m_streamId << name << "槽数:" << m_slotCount << "槽大小:" << m_ring.slotBytes();
+    return true;
+}
+
+void FrameExporter::exportFrame(const AVFrame *frame, qint64 wallMs)
+{
+    if (frame->width <= 0 || frame->height <= 0) {
+        return;
+    }
+    QSize size = FrameConverter::fitSize(frame, m_frameSize);
+    // YUV420P的色度平面要求偶数尺寸
+    size = QSize(qMax(2, size.width() & ~1), qMax(2, size.height() & ~1));
+    AVPixelFormat dstFormat = m_format == SharedFrameRing::RGB24 ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_YUV420P;
+
+    // 读者按紧密排列解析，行对齐为1
+    SharedFrameRing::FrameInfo info;
+    info.wallMs = wallMs;
+    info.pts = frame->best_effort_timestamp;
+    info.width = size.width();
+    info.height = size.height();
+    info.format = m_format;
+    info.dataBytes = av_image_get_buffer_size(dstFormat, size.width(), size.height(), 1);
+    if (info.dataBytes <= 0 || av_image_fill_linesizes(info.strides, dstFormat, size.width()) < 0) {
+        return;
+    }
+    if (!m_converter.prepare(frame, size, dstFormat) || !ensureRing(info.dataBytes)) {
+        return;
+    }
+
+    // 直接转换到共享内存的槽中
+    int slot = 0;
+    uchar *data = m_ring.beginWrite(&slot);
+    uint8_t *dst[4] = { nullptr, nullptr, nullptr, nullptr };
+    int dstLinesize[4] = { info.strides[0], info.strides[1], info.strides[2], info.strides[3] };
+    av_image_fill_pointers(dst, dstFormat, size.height(), data, dstLinesize);
+    m_converter.scale(frame, dst, dstLinesize);
+    quint64 frameNumber = m_ring.commit(slot, info);
+    m_exported.fetch_add(1, std::memory_order_relaxed);
+
+    QJsonObject notice;
+    notice.insert("stream", m_streamId);
+    notice.insert("shm", m_ring.name());
+    notice.insert("slots", m_ring.slotCount());
+    notice.insert("slot_bytes", m_ring.slotBytes());
+    notice.insert("slot", slot);
+    notice.insert("frame", double(frameNumber));
+    notice.insert("wall_ms", double(wallMs));
+    notice.insert("width", info.width);
+    notice.insert("height", info.height);
+    notice.insert("format", m_format == SharedFrameRing::RGB24 ? "rgb24" : "yuv420p");
+    QJsonArray strides;
+    for (int i = 0; i < 3 && info.strides[i] > 0; ++i) {
+        strides.append(info.strides[i]);
+    }
+    notice.insert("strides", strides);
+    m_manager->announce(m_streamId, QJsonDocument(notice).toJson(QJsonDocument::Compact));
+}
@@ -0,0 +1,59 @@
+#ifndef FRAMEEXPORTER_H
+#define FRAMEEXPORTER_H
+
+#include <QThread>
+#include <QSize>
+#include <QString>
+#include <atomic>
+#include "frameconverter.h"
+#include "sharedframering.h"
+
+class FrameSubscription;
+class FrameExportManager;
+struct AVFrame;
+
+// 把一路流解码后的画面导出到共享内存，供外部分析进程使用
+// 画面来自帧总线的订阅（只保留最新的少量画面，处理不过来时丢最旧的），在本线程上转换为
+// YUV420P或缩小后的RGB24并直接写入SharedFrameRing的槽，不额外拷贝；每写完一帧通过
+// FrameExportManager在ZMQ上发布通知。读者从不阻塞写者。分辨率变大时换用新的共享内存。
+class FrameExporter : public QThread
+{
+    Q_OBJECT
+public:
+    FrameExporter(const QString &streamId, FrameSubscription *subscription, FrameExportManager *manager,
+                  QObject *parent = nullptr);
+    ~FrameExporter();
+
+    // 以下设置需在start()之前调用
+    void setFormat(SharedFrameRing::PixelFormat format) { m_format = format; }
+    // 缩小到此尺寸以内，空尺寸表示保持原尺寸
+    void setFrameSize(const QSize &size) { m_frameSize = size; }
+    void setSlotCount(int count) { m_slotCount = qMax(2, count); }
+
+    QString streamId() const { return m_streamId; }
+    quint64 exported() const { return m_exported.load(std::memory_order_relaxed); }
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    void exportFrame(const AVFrame *frame, qint64 wallMs);
+    bool ensureRing(int bytes);
+
+    QString m_streamId;
+    FrameSubscription *m_subscription;
+    FrameExportManager *m_manager;
+    SharedFrameRing::PixelFormat m_format;
+    QSize m_frameSize;
+    int m_slotCount;
+    std::atomic<bool> m_stop;
+    std::atomic<quint64> m_exported;
+
+    // 只在导出线程中访问
+    SharedFrameRing m_ring;
+    int m_generation;
+    FrameConverter m_converter;
+};
+
+#endif // FRAMEEXPORTER_H
@@ -0,0 +1,118 @@
+#include "frameexportmanager.h"
+#include "frameexporter.h"
+#include "framebus.h"
+#include <QMutexLocker>
+#include <QDebug>
+#include <zmq.h>
+
+namespace {
+
+const char FRAMES_TOPIC_PREFIX[] = "frames/";
+
+}
+
+FrameExportManager::FrameExportManager(StreamHub *hub, QObject *parent)
+    : QObject(parent)
+    , m_bus(new FrameBus(hub))
+    , m_format("yuv")
+    , m_slotCount(4)
+    , m_context(nullptr)
+    , m_publisher(nullptr)
+{
+}
+
+FrameExportManager::~FrameExportManager()
+{
+    for (auto it = m_exports.begin(); it != m_exports.end(); ++it) {
+        // 先唤醒并停止导出线程，再退订；退订后解复用线程不会再回调
+        it->subscription->close();
+        it->exporter->stop();
+        it->exporter->wait();
+        m_bus->unsubscribe(it->subscription);
+        qDebug() << "停止共享内存导出:" << it->exporter->streamId() << "帧数:" << it->exporter->exported();
+        delete it->exporter;
+    }
+    delete m_bus;
+
+    if (m_publisher) {
+        zmq_close(m_publisher);
+    }
+    if (m_context) {
+        zmq_ctx_destroy(m_context);
+    }
+}
+
+void FrameExportManager::setFormat(const QString &format, const QSize &size)
+{
+    m_format = format;
+    m_frameSize = size;
+}
+
+void FrameExportManager::start()
+{
+    if (m_targets.isEmpty() || m_context) {
+        return;
+    }
+
+    m_context = zmq_ctx_new();
+    if (m_context && !m_endpoint.isEmpty()) {
+        m_publisher = zmq_socket(m_context, ZMQ_PUB);
+        // 读者不在或跟不上时直接丢弃通知，退出时不等待
+        int hwm = 16;
+        int linger = 0;
+        zmq_setsockopt(m_publisher, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+        zmq_setsockopt(m_publisher, ZMQ_LINGER, &linger, sizeof(linger));
+        if (zmq_bind(m_publisher, m_endpoint.toStdString().c_str()) != 0) {
+            qWarning() << "共享内存导出通知绑定失败:" << m_endpoint << zmq_strerror(zmq_errno());
+            zmq_close(m_publisher);
+            m_publisher = nullptr;
+        }
+    }
+
+    for (const QString &target : m_targets) {
+        if (target.contains("://")) {
+            startExport(target, target);
+        }
+    }
+}
+
+void FrameExportManager::onStreamAdded(const QString &id, const QString &name, const QString &url)
+{
+    Q_UNUSED(name);
+    if (m_context && !id.isEmpty() && m_targets.contains(id)) {
+        startExport(id, url);
+    }
+}
+
+void FrameExportManager::announce(const QString &streamId, const QByteArray &body)
+{
+    QMutexLocker locker(&m_announceMutex);
+    if (!m_publisher) {
+        return;
+    }
+    QByteArray topic = QByteArray(FRAMES_TOPIC_PREFIX) + streamId.toUtf8();
+    if (zmq_send(m_publisher, topic.constData(), topic.size(), ZMQ_SNDMORE | ZMQ_DONTWAIT) == -1) {
+        return;
+    }
+    zmq_send(m_publisher, body.constData(), body.size(), ZMQ_DONTWAIT);
+}
+
+void FrameExportManager::startExport(const QString &key, const QString &url)
+{
+    if (m_exports.contains(url)) {
+        return;
+    }
+
+    Export exported;
+    exported.subscription = m_bus->subscribe(url, key, FrameBus::Frames, FrameSubscription::DropOldest, QUEUE_FRAMES);
+    if (!exported.subscription) {
+        return;
+    }
+    exported.exporter = new FrameExporter(key, exported.subscription, this);
+    exported.exporter->setFormat(m_format == "rgb" ? SharedFrameRing::RGB24 : SharedFrameRing::YUV420P);
+    exported.exporter->setFrameSize(m_frameSize);
+    exported.exporter->setSlotCount(m_slotCount);
+    exported.exporter->start();
+    m_exports.insert(url, exported);
+    qDebug() << "开始共享内存导出:" << key << "格式:" << m_format;
+}
@@ -0,0 +1,70 @@
+#ifndef FRAMEEXPORTMANAGER_H
+#define FRAMEEXPORTMANAGER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QSize>
+#include <QStringList>
+
+class StreamHub;
+class FrameBus;
+class FrameExporter;
+class FrameSubscription;
+
+// 选定流的画面共享内存导出，供本机的外部分析进程使用，不必再各自拉流解码
+// 画面通过帧总线订阅，与观看共用同一次解码；每路流一个FrameExporter。每写完一帧在本机ZMQ PUB上
+// 发布一条通知，主题为frames/<流ID>，内容为JSON（共享内存名、槽号、帧号、尺寸、格式、行跨度）。
+// 目标可以是流ID或URL：URL在start()时直接开始，流ID等列表中出现该流时开始。只在GUI（主）线程中使用。
+class FrameExportManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    FrameExportManager(StreamHub *hub, QObject *parent = nullptr);
+    ~FrameExportManager();
+
+    // 以下设置需在start()之前调用
+    void setTargets(const QStringList &targets) { m_targets = targets; }
+    // format为yuv或rgb，size为空表示保持原尺寸
+    void setFormat(const QString &format, const QSize &size);
+    void setSlotCount(int count) { m_slotCount = count; }
+    // 为空表示不发布通知，读者轮询共享内存头部的frameCount
+    void setAnnounceEndpoint(const QString &endpoint) { m_endpoint = endpoint; }
+
+    void start();
+    int exporterCount() const { return m_exports.size(); }
+
+    // 线程安全，由各导出线程调用；非阻塞，发不出去就丢掉
+    void announce(const QString &streamId, const QByteArray &body);
+
+public slots:
+    void onStreamAdded(const QString &id, const QString &name, const QString &url);
+
+private:
+    struct Export
+    {
+        FrameSubscription *subscription = nullptr;
+        FrameExporter *exporter = nullptr;
+    };
+
+    void startExport(const QString &key, const QString &url);
+
+    FrameBus *m_bus;
+    QStringList m_targets;
+    QString m_format;
+    QSize m_frameSize;
+    int m_slotCount;
+    QString m_endpoint;
+    QHash<QString, Export> m_exports;           // URL -> 导出
+
+    QMutex m_announceMutex;
+    void *m_context;
+    void *m_publisher;
+
+    // 每路流只要最新的画面，处理不过来时丢最旧的
+    static const int QUEUE_FRAMES = 2;
+};
+
+#endif // FRAMEEXPORTMANAGER_H
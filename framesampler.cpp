@@ -0,0 +1,242 @@
+#include "framesampler.h"
+#include "snapshotwriter.h"
+#include <QMutexLocker>
+#include <QDebug>
+
+extern "C"
+{
+    #include "libavcodec/avcodec.h"
+}
+
+FrameSampler::FrameSampler(const QString &name, SnapshotWriter *writer, QObject *parent)
+    : QThread(parent)
+    , m_name(name)
+    , m_writer(writer)
+    , m_intervalMs(1000)
+    , m_queueLimit(8 * 1024 * 1024)
+    , m_pendingBytes(0)
+    , m_needKey(true)
+    , m_stop(false)
+    , m_lastKeyMs(0)
+    , m_keyIntervalMs(0)
+    , m_nextKeyDueMs(0)
+    , m_keyOnlyMode(true)
+    , m_codecCtx(nullptr)
+    , m_frame(nullptr)
+    , m_nextDueMs(0)
+    , m_samples(0)
+    , m_droppedSamples(0)
+    , m_droppedPackets(0)
+{
+}
+
+FrameSampler::~FrameSampler()
+{
+    stop();
+    wait();
+    for (Item &item : m_pending) {
+        freeItem(item);
+    }
+    av_frame_free(&m_frame);
+    avcodec_free_context(&m_codecCtx);
+}
+
+void FrameSampler::stop()
+{
+    QMutexLocker locker(&m_mutex);
+    m_stop = true;
+    m_cond.wakeOne();
+}
+
+void FrameSampler::freeItem(Item &item)
+{
+    av_packet_free(&item.packet);
+    avcodec_parameters_free(&item.codecpar);
+}
+
+void FrameSampler::enqueue(const Item &item, qint64 bytes)
+{
+    // 调用者持有m_mutex
+    m_pending.append(item);
+    m_pendingBytes += bytes;
+    m_cond.wakeOne();
+}
+
+void FrameSampler::streamOpened(const AVCodecParameters *codecpar, AVRational timeBase)
+{
+    Q_UNUSED(timeBase);
+    Item item;
+    item.codecpar = avcodec_parameters_alloc();
+    if (!item.codecpar || avcodec_parameters_copy(item.codecpar, codecpar) < 0) {
+        avcodec_parameters_free(&item.codecpar);
+        return;
+    }
+
+    // 重新连接后关键帧间隔可能变化，重新估计
+    m_lastKeyMs = 0;
+    m_keyIntervalMs = 0;
+    m_keyOnlyMode = true;
+
+    QMutexLocker locker(&m_mutex);
+    m_needKey = true;
+    enqueue(item, 0);
+}
+
+void FrameSampler::packetReceived(const AVPacket *packet, qint64 wallMs)
+{
+    bool key = packet->flags & AV_PKT_FLAG_KEY;
+    if (key) {
+        if (m_lastKeyMs > 0) {
+            m_keyIntervalMs = wallMs - m_lastKeyMs;
+        }
+        m_lastKeyMs = wallMs;
+
+        // 关键帧足够密时只解关键帧，否则整组解码再挑选；方式只在关键帧处切换
+        bool keyOnly = m_keyIntervalMs == 0 || m_keyIntervalMs <= m_intervalMs;
+        if (keyOnly != m_keyOnlyMode) {
+            qDebug() << "取样方式切换:" << m_name << (keyOnly ? "只解关键帧" : "整组解码")
+                     << "关键帧间隔(ms):" << m_keyIntervalMs;
+            m_keyOnlyMode = keyOnly;
+        }
+    }
+
+    Item item;
+    if (m_keyOnlyMode) {
+        // 只送到期的关键帧；下次到期时间留出半个关键帧间隔，避免因抖动隔一个取一个
+        if (!key || wallMs < m_nextKeyDueMs) {
+            return;
+        }
+        m_nextKeyDueMs = wallMs + m_intervalMs - m_keyIntervalMs / 2;
+        item.keyOnly = true;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (m_needKey && !key) {
+        m_droppedPackets++;
+        return;
+    }
+    if (m_pendingBytes + packet->size > m_queueLimit) {
+        if (!m_needKey) {
+            qWarning() << "取样解码跟不上，丢弃到下一个关键帧:" << m_name;
+        }
+        m_needKey = true;
+        m_droppedPackets++;
+        return;
+    }
+    item.packet = av_packet_clone(packet);
+    if (!item.packet) {
+        m_needKey = true;
+        m_droppedPackets++;
+        return;
+    }
+    item.wallMs = wallMs;
+    // 只解关键帧时解码器每次都重新开始，之后切换到整组解码也要从关键帧开始
+    m_needKey = item.keyOnly;
+    enqueue(item, packet->size);
+}
+
+void FrameSampler::streamClosed()
+{
+    QMutexLocker locker(&m_mutex);
+    m_needKey = true;
+    enqueue(Item(), 0);
+}
+
+void FrameSampler::run()
+{
+    m_frame = av_frame_alloc();
+    QVector<Item> batch;
+    forever {
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_pending.isEmpty() && !m_stop) {
+                m_cond.wait(&m_mutex, 1000);
+            }
+            if (m_stop) {
+                break;
+            }
+            batch.swap(m_pending);
+            m_pendingBytes = 0;
+        }
+
+        for (Item &item : batch) {
+            if (item.packet) {
+                decode(item);
+            } else {
+                // 流重新打开时按新参数重建解码器，关闭时释放
+                openDecoder(item.codecpar);
+            }
+            freeItem(item);
+        }
+        batch.clear();
+    }
+    avcodec_free_context(&m_codecCtx);
+}
+
+void FrameSampler::openDecoder(const AVCodecParameters *codecpar)
+{
+    avcodec_free_context(&m_codecCtx);
+    if (!codecpar) {
+        return;
+    }
+    const AVCodec *codec = avcodec_find_decoder(codecpar->codec_id);
+    if (!codec) {
+        qWarning() << "取样找不到解码器:" << m_name;
+        return;
+    }
+    m_codecCtx = avcodec_alloc_context3(codec);
+    if (!m_codecCtx) {
+        return;
+    }
+    // 每路流一个解码线程，几十路同时取样时内存和线程数都随路数线性增长
+    m_codecCtx->thread_count = 1;
+    if (avcodec_parameters_to_context(m_codecCtx, codecpar) < 0 || avcodec_open2(m_codecCtx, codec, nullptr) < 0) {
+        qWarning() << "取样打开解码器失败:" << m_name;
+        avcodec_free_context(&m_codecCtx);
+    }
+}
+
+void FrameSampler::decode(const Item &item)
+{
+    if (!m_codecCtx || !m_frame) {
+        return;
+    }
+
+    if (item.keyOnly) {
+        // 单个关键帧：送入后立即排空取出，再复位解码器
+        m_codecCtx->skip_frame = AVDISCARD_NONKEY;
+        if (avcodec_send_packet(m_codecCtx, item.packet) == 0 && avcodec_send_packet(m_codecCtx, nullptr) == 0) {
+            while (avcodec_receive_frame(m_codecCtx, m_frame) == 0) {
+                takeSample(m_frame, item.wallMs);
+                av_frame_unref(m_frame);
+            }
+        }
+        avcodec_flush_buffers(m_codecCtx);
+        m_nextDueMs = 0;
+        return;
+    }
+
+    // 整组解码时不被参考的帧不必解出
+    m_codecCtx->skip_frame = AVDISCARD_NONREF;
+    if (avcodec_send_packet(m_codecCtx, item.packet) != 0) {
+        return;
+    }
+    while (avcodec_receive_frame(m_codecCtx, m_frame) == 0) {
+        if (item.wallMs >= m_nextDueMs) {
+            takeSample(m_frame, item.wallMs);
+            // 按到期时间累加，落后太多时从当前时间重新计
+            m_nextDueMs = m_nextDueMs + m_intervalMs > item.wallMs ? m_nextDueMs + m_intervalMs
+                                                                   : item.wallMs + m_intervalMs;
+        }
+        av_frame_unref(m_frame);
+    }
+}
+
+void FrameSampler::takeSample(const AVFrame *frame, qint64 wallMs)
+{
+    if (m_writer && m_writer->captureFrame(m_name, frame, wallMs)) {
+        m_samples++;
+    } else {
+        m_droppedSamples++;
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef FRAMESAMPLER_H
+#define FRAMESAMPLER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include "packetsink.h"
+
+class SnapshotWriter;
+struct AVCodecContext;
+struct AVFrame;
+
+// 按固定间隔从流中取样保存为图片，用于采集训练数据
+// 作为PacketSink接收不解码的播放器分发的压缩包，在本线程上解码。关键帧间隔不超过取样间隔时
+// 只把到期的关键帧送入解码器（解出即取样），否则整组解码但跳过不被参考的帧，按到期时间挑选。
+// 取样帧只增加引用交给SnapshotWriter缩放、编码和写盘；写盘跟不上时丢弃样本，不阻塞解码。
+// 待解码队列按字节数限制，溢出时丢弃到下一个关键帧。
+class FrameSampler : public QThread, public PacketSink
+{
+    Q_OBJECT
+public:
+    FrameSampler(const QString &name, SnapshotWriter *writer, QObject *parent = nullptr);
+    ~FrameSampler();
+
+    // 以下设置需在start()之前调用
+    void setInterval(qint64 ms) { m_intervalMs = qMax<qint64>(40, ms); }
+    void setQueueLimit(qint64 bytes) { m_queueLimit = bytes; }
+
+    QString name() const { return m_name; }
+    quint64 samples() const { return m_samples; }
+    quint64 droppedSamples() const { return m_droppedSamples; }
+    quint64 droppedPackets() const { return m_droppedPackets; }
+    void stop();
+
+    // PacketSink，在解复用线程上调用
+    void streamOpened(const AVCodecParameters *codecpar, AVRational timeBase) override;
+    void packetReceived(const AVPacket *packet, qint64 wallMs) override;
+    void streamClosed() override;
+
+protected:
+    void run() override;
+
+private:
+    // packet和codecpar都为空表示流已关闭；keyOnly表示只解这一个关键帧并取样
+    struct Item
+    {
+        AVPacket *packet = nullptr;
+        AVCodecParameters *codecpar = nullptr;
+        qint64 wallMs = 0;
+        bool keyOnly = false;
+    };
+
+    void enqueue(const Item &item, qint64 bytes);
+    static void freeItem(Item &item);
+    void openDecoder(const AVCodecParameters *codecpar);
+    void decode(const Item &item);
+    void takeSample(const AVFrame *frame, qint64 wallMs);
+
+    QString m_name;
+    SnapshotWriter *m_writer;
+    qint64 m_intervalMs;
+    qint64 m_queueLimit;
+
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    QVector<Item> m_pending;
+    qint64 m_pendingBytes;
+    bool m_needKey;             // 队列溢出或切换方式后从下一个关键帧开始
+    bool m_stop;
+
+    // 只在解复用线程中访问
+    qint64 m_lastKeyMs;
+    qint64 m_keyIntervalMs;     // 最近两个关键帧的间隔，0表示还不知道
+    qint64 m_nextKeyDueMs;
+    bool m_keyOnlyMode;
+
+    // 只在取样线程中访问
+    AVCodecContext *m_codecCtx;
+    AVFrame *m_frame;
+    qint64 m_nextDueMs;
+
+    std::atomic<quint64> m_samples;
+    std::atomic<quint64> m_droppedSamples;
+    std::atomic<quint64> m_droppedPackets;
+};
+
+#endif // FRAMESAMPLER_H
@@ -0,0 +1,19 @@
+#ifndef FRAMESINK_H
+#define FRAMESINK_H
+
+#include <QtGlobal>
+
+struct AVFrame;
+
+// 解码后画面的旁路接收者
+// StreamPlayer在解复用线程上把每个解码出的画面（解码器原生格式，通常为YUV）交给已注册的接收者。
+// 回调中不得阻塞；需要保留画面时自行增加引用（av_frame_clone）。wallMs为画面解出时的本机时间。
+class FrameSink
+{
+public:
+    virtual ~FrameSink() {}
+
+    virtual void frameDecoded(const AVFrame *frame, qint64 wallMs) = 0;
+};
+
+#endif // FRAMESINK_H
@@ -0,0 +1,234 @@
+#include "gopcache.h"
+#include "frameconverter.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QDebug>
+
+extern "C"
+{
+    #include "libavcodec/avcodec.h"
+    #include "libavformat/avformat.h"
+}
+
+class GopPrefetchTask : public QRunnable
+{
+public:
+    GopPrefetchTask(GopCache *cache, const RecordingPosition &position)
+        : m_cache(cache), m_position(position) {}
+
+    void run() override
+    {
+        m_cache->fetch(m_position);
+    }
+
+private:
+    GopCache *m_cache;
+    RecordingPosition m_position;
+};
+
+GopCache::GopCache(const QString &streamDir, qint64 maxBytes)
+    : m_maxBytes(maxBytes)
+    , m_index(streamDir)
+    , m_bytes(0)
+{
+    // 前后各一个
+    m_pool.setMaxThreadCount(2);
+}
+
+GopCache::~GopCache()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+qint64 GopCache::bytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytes;
+}
+
+QSharedPointer<const DecodedGop> GopCache::gopAt(qint64 wallMs)
+{
+    RecordingPosition position;
+    {
+        QMutexLocker locker(&m_indexMutex);
+        if (!m_index.find(wallMs, &position)) {
+            return QSharedPointer<const DecodedGop>();
+        }
+    }
+    return fetch(position);
+}
+
+QSharedPointer<const DecodedGop> GopCache::previousGop(const DecodedGop &gop)
+{
+    return gopAt(gop.keyWallMs - 1);
+}
+
+QSharedPointer<const DecodedGop> GopCache::nextGop(const DecodedGop &gop)
+{
+    RecordingPosition position;
+    {
+        QMutexLocker locker(&m_indexMutex);
+        if (!m_index.findNext(gop.keyWallMs, &position)) {
+            return QSharedPointer<const DecodedGop>();
+        }
+    }
+    return fetch(position);
+}
+
+void GopCache::prefetchAround(const DecodedGop &gop)
+{
+    QVector<RecordingPosition> positions;
+    {
+        QMutexLocker locker(&m_indexMutex);
+        RecordingPosition position;
+        if (m_index.findNext(gop.keyWallMs, &position)) {
+            positions.append(position);
+        }
+        if (m_index.find(gop.keyWallMs - 1, &position)) {
+            positions.append(position);
+        }
+    }
+
+    QMutexLocker locker(&m_mutex);
+    for (const RecordingPosition &position : positions) {
+        if (!m_gops.contains(position.keyframeWallMs) && !m_loading.contains(position.keyframeWallMs)) {
+            m_pool.start(new GopPrefetchTask(this, position));
+        }
+    }
+}
+
+QSharedPointer<const DecodedGop> GopCache::fetch(const RecordingPosition &position)
+{
+    qint64 key = position.keyframeWallMs;
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_loading.contains(key)) {
+            m_loaded.wait(&m_mutex);
+        }
+        auto it = m_gops.constFind(key);
+        if (it != m_gops.constEnd()) {
+            m_lru.removeOne(key);
+            m_lru.append(key);
+            return it.value();
+        }
+        m_loading.insert(key);
+    }
+
+    QSharedPointer<DecodedGop> gop = decode(position);
+
+    QMutexLocker locker(&m_mutex);
+    m_loading.remove(key);
+    if (gop) {
+        insert(gop);
+    }
+    m_loaded.wakeAll();
+    return gop;
+}
+
+void GopCache::insert(const QSharedPointer<DecodedGop> &gop)
+{
+    // 调用者持有m_mutex
+    m_gops.insert(gop->keyWallMs, gop);
+    m_lru.append(gop->keyWallMs);
+    m_bytes += gop->bytes;
+
+    // 刚解码的GOP总是保留；已取走的GOP由使用者的引用保持有效
+    while (m_bytes > m_maxBytes && m_lru.size() > 1) {
+        QSharedPointer<DecodedGop> oldest = m_gops.take(m_lru.takeFirst());
+        if (oldest) {
+            m_bytes -= oldest->bytes;
+        }
+    }
+}
+
+QSharedPointer<DecodedGop> GopCache::decode(const RecordingPosition &position) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    RecordingInput input;
+    if (!input.open(position)) {
+        return QSharedPointer<DecodedGop>();
+    }
+    AVFormatContext *fmtCtx = input.context();
+    int streamIndex = av_find_best_stream(fmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (streamIndex < 0) {
+        return QSharedPointer<DecodedGop>();
+    }
+    AVStream *stream = fmtCtx->streams[streamIndex];
+    const AVCodec *codec = avcodec_find_decoder(stream->codecpar->codec_id);
+    if (!codec) {
+        qWarning() << "decoder not found";
+        return QSharedPointer<DecodedGop>();
+    }
+
+    AVCodecContext *codecCtx = avcodec_alloc_context3(codec);
+    AVPacket *pkt = av_packet_alloc();
+    AVFrame *frame = av_frame_alloc();
+    FrameConverter converter;
+    QSharedPointer<DecodedGop> gop(new DecodedGop());
+    gop->keyWallMs = position.keyframeWallMs;
+
+    // 帧的本机时间按与关键帧的pts差推算
+    qint64 keyPts = AV_NOPTS_VALUE;
+    auto receiveFrames = [&]() {
+        while (avcodec_receive_frame(codecCtx, frame) == 0) {
+            qint64 pts = frame->best_effort_timestamp;
+            // 开放GOP中关键帧之前显示的帧缺少参考，不保留
+            if (pts == AV_NOPTS_VALUE || keyPts == AV_NOPTS_VALUE || pts < keyPts) {
+                continue;
+            }
+            QImage img = converter.toImage(frame, m_frameSize);
+            if (img.isNull()) {
+                continue;
+            }
+
+            gop->frames.append(img);
+            gop->wallMs.append(position.keyframeWallMs
+                               + av_rescale_q(pts - keyPts, stream->time_base, AVRational{1, 1000}));
+            gop->bytes += img.sizeInBytes();
+        }
+    };
+
+    bool ok = codecCtx && pkt && frame
+              && avcodec_parameters_to_context(codecCtx, stream->codecpar) >= 0
+              && avcodec_open2(codecCtx, codec, nullptr) >= 0;
+    // 读到下一个关键帧为止，即一个分片
+    while (ok && av_read_frame(fmtCtx, pkt) >= 0) {
+        if (pkt->stream_index == streamIndex) {
+            bool key = pkt->flags & AV_PKT_FLAG_KEY;
+            if (key && keyPts != AV_NOPTS_VALUE) {
+                av_packet_unref(pkt);
+                break;
+            }
+            if (keyPts == AV_NOPTS_VALUE) {
+                keyPts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+            }
+            if (avcodec_send_packet(codecCtx, pkt) == 0) {
+                receiveFrames();
+            }
+        }
+        av_packet_unref(pkt);
+    }
+    if (ok) {
+        avcodec_send_packet(codecCtx, nullptr);
+        receiveFrames();
+    }
+
+    av_frame_free(&frame);
+    av_packet_free(&pkt);
+    avcodec_free_context(&codecCtx);
+
+    if (gop->frames.isEmpty()) {
+        return QSharedPointer<DecodedGop>();
+    }
+    // 解码器按显示顺序输出，时间戳异常时仍保证递增
+    for (int i = 1; i < gop->wallMs.size(); ++i) {
+        gop->wallMs[i] = qMax(gop->wallMs[i], gop->wallMs[i - 1] + 1);
+    }
+    qDebug() << "解码GOP:" << position.path << "帧数:" << gop->frames.size()
+             << "耗时(ms):" << timer.elapsed();
+    return gop;
+}
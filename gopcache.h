@@ -0,0 +1,71 @@
+#ifndef GOPCACHE_H
+#define GOPCACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QSize>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+#include "recordingindex.h"
+
+// 解码后的一个GOP，帧按显示顺序排列
+struct DecodedGop
+{
+    qint64 keyWallMs = 0;       // 关键帧的本机时间，即缓存键
+    QVector<QImage> frames;
+    QVector<qint64> wallMs;     // 每帧的本机时间，递增
+    qint64 bytes = 0;
+};
+
+// 录像回放的GOP缓存
+// 以GOP为单位解码并缓存整组画面，逐帧后退和倒放直接取缓存中的帧，不必每一步都从关键帧重新解码。
+// 按字节数上限淘汰最久未用的GOP；相邻的GOP在后台线程池上预先解码。线程安全。
+class GopCache
+{
+public:
+    GopCache(const QString &streamDir, qint64 maxBytes);
+    ~GopCache();
+
+    // 解码后缩放到此尺寸以内（保持宽高比），空表示原尺寸；需在第一次取帧之前设置
+    void setFrameSize(const QSize &size) { m_frameSize = size; }
+
+    // 取得包含wallMs的GOP，未缓存时在调用线程上解码；没有录像时返回空
+    QSharedPointer<const DecodedGop> gopAt(qint64 wallMs);
+    QSharedPointer<const DecodedGop> previousGop(const DecodedGop &gop);
+    QSharedPointer<const DecodedGop> nextGop(const DecodedGop &gop);
+
+    // 在后台预先解码前后相邻的GOP
+    void prefetchAround(const DecodedGop &gop);
+
+    qint64 bytes() const;
+
+private:
+    friend class GopPrefetchTask;
+
+    // 其他线程正在解码同一GOP时等待其结果
+    QSharedPointer<const DecodedGop> fetch(const RecordingPosition &position);
+    QSharedPointer<DecodedGop> decode(const RecordingPosition &position) const;
+    void insert(const QSharedPointer<DecodedGop> &gop);
+
+    QSize m_frameSize;
+    qint64 m_maxBytes;
+
+    QMutex m_indexMutex;
+    RecordingIndex m_index;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_loaded;
+    QHash<qint64, QSharedPointer<DecodedGop> > m_gops;
+    QList<qint64> m_lru;            // 由久到新
+    QSet<qint64> m_loading;
+    qint64 m_bytes;
+
+    QThreadPool m_pool;
+};
+
+#endif // GOPCACHE_H
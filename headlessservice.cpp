@@ -0,0 +1,178 @@
+#include "headlessservice.h"
+#include "msgClient.hpp"
+#include "alarmstore.h"
+#include "alarmrules.h"
+#include "streamhub.h"
+#include "recordingmanager.h"
+#include "samplingmanager.h"
+#include "restreamserver.h"
+#include "frameexportmanager.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSize>
+#include <QDebug>
+
+HeadlessService::HeadlessService(const AppConfig &config, QObject *parent)
+    : QObject(parent)
+    , m_config(config)
+    , m_msgClient(nullptr)
+    , m_alarmStore(nullptr)
+    , m_streamHub(nullptr)
+    , m_recordingManager(nullptr)
+    , m_samplingManager(nullptr)
+    , m_restreamServer(nullptr)
+    , m_frameExportManager(nullptr)
+{
+}
+
+HeadlessService::~HeadlessService()
+{
+    // 先停消息接收，再停录像和取样（保证分段正常收尾），最后关闭连接和报警存储
+    if (m_msgClient) {
+        m_msgClient->stop();
+    }
+    delete m_recordingManager;
+    delete m_samplingManager;
+    delete m_restreamServer;
+    delete m_frameExportManager;
+    delete m_streamHub;
+    delete m_msgClient;
+    if (m_alarmStore) {
+        m_alarmStore->stop();
+        delete m_alarmStore;
+    }
+}
+
+bool HeadlessService::start()
+{
+    setupAlarmStore();
+
+    // 没有人观看，不需要报警前缓冲
+    m_streamHub = new StreamHub();
+
+    if (!m_config.recordStreams.isEmpty()) {
+        m_recordingManager = new RecordingManager(m_streamHub, m_config.recordDir);
+        m_recordingManager->setTargets(m_config.recordStreams);
+        m_recordingManager->setSegmentSeconds(m_config.recordSegmentSeconds);
+        m_recordingManager->setPreallocBytes(qint64(qMax(0, m_config.recordPreallocMB)) * 1024 * 1024);
+        m_recordingManager->setQueueLimit(qint64(qMax(1, m_config.recordQueueMB)) * 1024 * 1024);
+        m_recordingManager->setQuotaBytes(qint64(qMax(0, m_config.recordQuotaGB)) * 1024 * 1024 * 1024);
+        m_recordingManager->start();
+    }
+    if (!m_config.sampleStreams.isEmpty()) {
+        m_samplingManager = new SamplingManager(m_streamHub, m_config.sampleDir);
+        m_samplingManager->setTargets(m_config.sampleStreams);
+        m_samplingManager->setInterval(m_config.sampleIntervalMs);
+        m_samplingManager->setFrameSize(QSize(m_config.sampleWidth, m_config.sampleHeight));
+        m_samplingManager->setOutput(m_config.sampleFormat, m_config.sampleQuality, m_config.sampleThreads,
+                                     m_config.samplePending);
+        m_samplingManager->setQueueLimit(qint64(qMax(1, m_config.sampleQueueMB)) * 1024 * 1024);
+        m_samplingManager->start();
+    }
+    if (!m_config.exportStreams.isEmpty()) {
+        m_frameExportManager = new FrameExportManager(m_streamHub);
+        m_frameExportManager->setTargets(m_config.exportStreams);
+        m_frameExportManager->setFormat(m_config.exportFormat, QSize(m_config.exportWidth, m_config.exportHeight));
+        m_frameExportManager->setSlotCount(m_config.exportSlots);
+        m_frameExportManager->setAnnounceEndpoint(m_config.exportAnnounce);
+        m_frameExportManager->start();
+    }
+    if (m_config.restreamPort > 0) {
+        m_restreamServer = new RestreamServer(m_streamHub);
+        m_restreamServer->setClientQueueLimit(qint64(qMax(64, m_config.restreamClientQueueKB)) * 1024);
+        if (!m_restreamServer->listen(quint16(m_config.restreamPort))) {
+            delete m_restreamServer;
+            m_restreamServer = nullptr;
+        }
+    }
+
+    // 没有界面按流订阅，报警全部接收后写入历史
+    m_msgClient = new msgClient(m_config.servers, false);
+    m_msgClient->setAlarmRateLimit(m_config.alarmRateLimit, m_config.alarmRateBurst,
+                                   m_config.alarmSuppressWindowMs);
+    loadAlarmRules();
+    m_msgClient->enableTelemetry(m_config.telemetryPort, m_config.telemetryIntervalMs,
+                                 m_config.telemetryClientId);
+    connect(m_msgClient, &msgClient::rtspUrlReceived, this, &HeadlessService::onRtspUrlReceived);
+    connect(m_msgClient, &msgClient::alarmReceived, this, &HeadlessService::onAlarmReceived);
+    connect(m_msgClient, &msgClient::errorOccurred, this, [](const QString &error_msg) {
+        qWarning() << "ZMQ Error:" << error_msg;
+    });
+    connect(m_msgClient, &msgClient::connectionStateChanged, this, [](const QString &channel, int connectedServers) {
+        qDebug() << channel << "通道连通的服务器数:" << connectedServers;
+    });
+    m_msgClient->start();
+
+    bool hasTargets = m_recordingManager || m_samplingManager || m_frameExportManager || m_restreamServer;
+    qDebug() << "无界面模式已启动，录像目标:" << m_config.recordStreams.size()
+             << "取样目标:" << m_config.sampleStreams.size()
+             << "导出目标:" << m_config.exportStreams.size() << "转发端口:" << m_config.restreamPort;
+    return hasTargets;
+}
+
+void HeadlessService::setupAlarmStore()
+{
+    m_alarmStore = new AlarmStore(m_config.alarmStoreDir, m_config.alarmSegmentBytes, m_config.alarmMaxSegments);
+    connect(m_alarmStore, &AlarmStore::errorOccurred, this, [](const QString &error_msg) {
+        qWarning() << "报警存储错误:" << error_msg;
+    });
+    if (!m_alarmStore->open()) {
+        qWarning() << "报警历史存储不可用:" << m_config.alarmStoreDir;
+        delete m_alarmStore;
+        m_alarmStore = nullptr;
+        return;
+    }
+    m_alarmStore->start();
+}
+
+void HeadlessService::loadAlarmRules()
+{
+    if (!QFileInfo::exists(m_config.alarmRulesFile)) {
+        return;
+    }
+    QString error;
+    QSharedPointer<AlarmRuleSet> rules = AlarmRuleSet::load(m_config.alarmRulesFile, &error);
+    if (!rules) {
+        qWarning() << "加载报警规则失败:" << error;
+        return;
+    }
+    m_msgClient->setAlarmRules(rules);
+}
+
+void HeadlessService::onRtspUrlReceived(const QString &msg)
+{
+    // 与流列表相同的去重规则：没有ID的流以URL作为ID
+    QString name, url, id;
+    if (!msgClient::parseStreamInfo(msg, name, url, id)) {
+        url = msg;
+        id = msg;
+    } else if (id.isEmpty()) {
+        id = url;
+    }
+    if (m_knownUrls.contains(url)) {
+        return;
+    }
+    m_knownUrls.insert(url);
+
+    if (m_recordingManager) {
+        m_recordingManager->onStreamAdded(id, name, url);
+    }
+    if (m_samplingManager) {
+        m_samplingManager->onStreamAdded(id, name, url);
+    }
+    if (m_frameExportManager) {
+        m_frameExportManager->onStreamAdded(id, name, url);
+    }
+    if (m_restreamServer) {
+        m_restreamServer->onStreamAdded(id, name, url);
+    }
+}
+
+void HeadlessService::onAlarmReceived(const AlarmEvent &alarm)
+{
+    // 规则为隐藏的报警仍然记入历史，与界面版一致
+    if (m_alarmStore) {
+        QByteArray payload = alarm.binary ? alarm.toJson() : alarm.raw;
+        m_alarmStore->append(QDateTime::currentMSecsSinceEpoch(), QString::fromUtf8(payload));
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef HEADLESSSERVICE_H
+#define HEADLESSSERVICE_H
+
+#include <QObject>
+#include <QSet>
+#include "appconfig.h"
+#include "alarmevent.h"
+
+class msgClient;
+class AlarmStore;
+class StreamHub;
+class RecordingManager;
+class SamplingManager;
+class RestreamServer;
+class FrameExportManager;
+
+// 无界面运行：接收流目录和报警、连续录像、取样、共享内存导出、本地转发和遥测，不创建任何窗口部件
+// 播放器只解复用不解码，也不转换QImage；报警订阅全部主题并写入报警历史。
+// 配置与界面版相同，来自StreamHive.ini（可用--config指定）。只在主线程中使用。
+class HeadlessService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HeadlessService(const AppConfig &config, QObject *parent = nullptr);
+    ~HeadlessService();
+
+    // 没有任何录像、取样、导出或转发目标时返回false，此时继续运行也只是收报警
+    bool start();
+
+private slots:
+    void onRtspUrlReceived(const QString &msg);
+    void onAlarmReceived(const AlarmEvent &alarm);
+
+private:
+    void setupAlarmStore();
+    void loadAlarmRules();
+
+    AppConfig m_config;
+    msgClient *m_msgClient;
+    AlarmStore *m_alarmStore;
+    StreamHub *m_streamHub;
+    RecordingManager *m_recordingManager;
+    SamplingManager *m_samplingManager;
+    RestreamServer *m_restreamServer;
+    FrameExportManager *m_frameExportManager;
+    QSet<QString> m_knownUrls;
+};
+
+#endif // HEADLESSSERVICE_H
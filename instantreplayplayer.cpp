@@ -0,0 +1,90 @@
+#include "instantreplayplayer.h"
+#include "frameconverter.h"
+#include "playbackpacing.h"
+#include <QElapsedTimer>
+#include <QDebug>
+
+extern "C"
+{
+    #include "libavcodec/avcodec.h"
+}
+
+InstantReplayPlayer::InstantReplayPlayer(const QSharedPointer<PacketClip> &clip, QObject *parent)
+    : QThread(parent)
+    , m_clip(clip)
+    , m_stop(false)
+{
+}
+
+InstantReplayPlayer::~InstantReplayPlayer()
+{
+    stop();
+    wait();
+}
+
+void InstantReplayPlayer::run()
+{
+    const AVCodec *codec = m_clip && m_clip->codecpar ? avcodec_find_decoder(m_clip->codecpar->codec_id) : nullptr;
+    if (!codec || m_clip->packets.isEmpty()) {
+        qWarning() << "即时回看: 没有可播放的片段";
+        emit replayFinished();
+        return;
+    }
+
+    AVCodecContext *codecCtx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    FrameConverter converter;
+    if (!codecCtx || !frame || avcodec_parameters_to_context(codecCtx, m_clip->codecpar) < 0
+        || avcodec_open2(codecCtx, codec, nullptr) < 0) {
+        av_frame_free(&frame);
+        avcodec_free_context(&codecCtx);
+        emit replayFinished();
+        return;
+    }
+
+    // 帧的本机时间按与首个关键帧的pts差推算，播放时钟从第一帧开始计
+    qint64 keyPts = m_clip->packets.first()->pts;
+    qint64 keyWallMs = m_clip->wallMs.first();
+    qint64 lastWallMs = keyWallMs;
+    qint64 clockMs = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    auto receiveFrames = [&]() {
+        while (!m_stop.load() && avcodec_receive_frame(codecCtx, frame) == 0) {
+            qint64 pts = frame->best_effort_timestamp;
+            qint64 wallMs = lastWallMs;
+            if (pts != AV_NOPTS_VALUE && keyPts != AV_NOPTS_VALUE) {
+                wallMs = keyWallMs + av_rescale_q(pts - keyPts, m_clip->timeBase, AVRational{1, 1000});
+            }
+            clockMs += qBound<qint64>(0, wallMs - lastWallMs, MAX_FRAME_DELAY_MS);
+            lastWallMs = wallMs;
+
+            QImage img = converter.toImage(frame, m_frameSize);
+            if (img.isNull()) {
+                continue;
+            }
+
+            // 分段睡眠，停止请求能及时生效
+            while (!m_stop.load() && timer.elapsed() < clockMs) {
+                msleep(qMin<qint64>(20, clockMs - timer.elapsed()));
+            }
+            if (!m_stop.load()) {
+                emit frameReady(img, wallMs);
+            }
+        }
+    };
+
+    for (int i = 0; i < m_clip->packets.size() && !m_stop.load(); ++i) {
+        if (avcodec_send_packet(codecCtx, m_clip->packets.at(i)) == 0) {
+            receiveFrames();
+        }
+    }
+    if (!m_stop.load() && avcodec_send_packet(codecCtx, nullptr) == 0) {
+        receiveFrames();
+    }
+
+    av_frame_free(&frame);
+    avcodec_free_context(&codecCtx);
+    emit replayFinished();
+}
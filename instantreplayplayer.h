@@ -0,0 +1,39 @@
+#ifndef INSTANTREPLAYPLAYER_H
+#define INSTANTREPLAYPLAYER_H
+
+#include <QThread>
+#include <QImage>
+#include <QSharedPointer>
+#include <QSize>
+#include <atomic>
+#include "packetring.h"
+
+// 即时回看
+// 用独立的解码器按原有节奏播放从环形缓冲取出的一段压缩包，直播连接和直播解码照常进行。
+// 片段持有包的引用，回看期间环形缓冲照常淘汰，不会多占内存以外的资源。
+class InstantReplayPlayer : public QThread
+{
+    Q_OBJECT
+public:
+    InstantReplayPlayer(const QSharedPointer<PacketClip> &clip, QObject *parent = nullptr);
+    ~InstantReplayPlayer();
+
+    // 解码后缩放到此尺寸以内，需在start()之前设置
+    void setFrameSize(const QSize &size) { m_frameSize = size; }
+    void stop() { m_stop.store(true); }
+
+signals:
+    void frameReady(const QImage &img, qint64 wallMs);
+    // 片段播放完毕或被停止
+    void replayFinished();
+
+protected:
+    void run() override;
+
+private:
+    QSharedPointer<PacketClip> m_clip;
+    QSize m_frameSize;
+    std::atomic<bool> m_stop;
+};
+
+#endif // INSTANTREPLAYPLAYER_H
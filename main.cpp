@@ -1,11 +1,111 @@
 #include "mainwindow.h"
+#include "headlessservice.h"
 
 #include <QApplication>
+#include <QCoreApplication>
+#include <QDebug>
 
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <QSocketNotifier>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef Q_OS_WIN
+
+BOOL WINAPI quitOnConsoleEvent(DWORD type)
+{
+    if (type != CTRL_C_EVENT && type != CTRL_BREAK_EVENT) {
+        return FALSE;
+    }
+    // 在系统创建的线程上调用，投递到主线程退出，析构在事件循环结束后进行
+    QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+    return TRUE;
+}
+
+void installQuitHandlers(QCoreApplication *app)
+{
+    Q_UNUSED(app);
+    SetConsoleCtrlHandler(quitOnConsoleEvent, TRUE);
+}
+
+#else
+
+// [0]由信号处理函数写，[1]由事件循环读
+int signalFds[2] = { -1, -1 };
+
+void writeSignalByte(int)
+{
+    // 信号处理函数中只能调用异步信号安全的函数，只写一个字节唤醒事件循环
+    char byte = 1;
+    ssize_t written = ::write(signalFds[0], &byte, 1);
+    Q_UNUSED(written);
+}
+
+void installQuitHandlers(QCoreApplication *app)
+{
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, signalFds) != 0) {
+        qWarning() << "无法创建信号通知socket，Ctrl+C将直接终止进程";
+        return;
+    }
+    QSocketNotifier *notifier = new QSocketNotifier(signalFds[1], QSocketNotifier::Read, app);
+    QObject::connect(notifier, SIGNAL(activated(int)), app, SLOT(quit()));
+
+    // 第二次Ctrl+C恢复默认处理，收尾卡住时仍能强制退出
+    struct sigaction action;
+    action.sa_handler = writeSignalByte;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART | SA_RESETHAND;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+
+#endif
+
+// 默认配置在程序目录下，需在创建应用对象之后取
+AppConfig loadConfig(const QString &configPath)
+{
+    return AppConfig::load(configPath.isEmpty() ? AppConfig::defaultPath() : configPath);
+}
+
+// --headless 无界面运行
+int runHeadless(int argc, char *argv[], const QString &configPath)
+{
+    QCoreApplication a(argc, argv);
+    HeadlessService service(loadConfig(configPath));
+    if (!service.start()) {
+        qWarning() << "未配置录像或取样目标，只接收报警";
+    }
+    installQuitHandlers(&a);
+    return a.exec();
+}
+
+}
+
+// --config <路径> 指定配置文件，有界面和无界面运行都适用
 int main(int argc, char *argv[])
 {
+    bool headless = false;
+    QString configPath;
+    for (int i = 1; i < argc; ++i) {
+        QString arg = QString::fromLocal8Bit(argv[i]);
+        if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--config" && i + 1 < argc) {
+            configPath = QString::fromLocal8Bit(argv[++i]);
+        }
+    }
+    if (headless) {
+        return runHeadless(argc, argv, configPath);
+    }
+
     QApplication a(argc, argv);
-    MainWindow w;
+    MainWindow w(loadConfig(configPath));
     w.show();
     return a.exec();
 }
@@ -1,17 +1,71 @@
 #include "mainwindow.h"
 #include "streamlistwidget.h"
 #include "videoplayerwidget.h"
+#include "alarmstore.h"
+#include "alarmsearchindex.h"
+#include "alarmsearchdialog.h"
+#include "alarmrules.h"
+#include "streamhub.h"
+#include "recordingmanager.h"
+#include "recordingplaybackdialog.h"
+#include "syncplaybackdialog.h"
+#include "snapshotwriter.h"
+#include "samplingmanager.h"
+#include "restreamserver.h"
+#include "frameexportmanager.h"
+#include "streamPlayer.h"
 #include <QApplication>
 #include <QScreen>
 #include <QDesktopWidget>
+#include <QDateTime>
+#include <QDebug>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QFileInfo>
+#include <QDir>
+#include <QSoundEffect>
+#include <QUrl>
 #include "msgClient.hpp"
 
-MainWindow::MainWindow(QWidget *parent)
+namespace {
+
+// 启动时在后台从报警历史重建全文索引
+class AlarmIndexRebuildTask : public QRunnable
+{
+public:
+    AlarmIndexRebuildTask(const AlarmStore *store, AlarmSearchIndex *index, quint64 untilId)
+        : m_store(store), m_index(index), m_untilId(untilId) {}
+
+    void run() override
+    {
+        m_index->rebuild(*m_store, m_untilId);
+    }
+
+private:
+    const AlarmStore *m_store;
+    AlarmSearchIndex *m_index;
+    quint64 m_untilId;
+};
+
+}
+
+MainWindow::MainWindow(const AppConfig &config, QWidget *parent)
     : QMainWindow(parent)
+    , m_config(config)
+    , m_msgClient(nullptr)
+    , m_alarmStore(nullptr)
+    , m_alarmSearchIndex(nullptr)
+    , m_streamHub(nullptr)
+    , m_recordingManager(nullptr)
+    , m_snapshotWriter(nullptr)
+    , m_samplingManager(nullptr)
+    , m_restreamServer(nullptr)
+    , m_frameExportManager(nullptr)
 {
     setupUI();
     setupStreamData();
     applyStyles();
+    setupAlarmStore();
     
     // 设置窗口大小和位置
     resize(WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -32,22 +86,53 @@ MainWindow::MainWindow(QWidget *parent)
             this, &MainWindow::onStreamSelected);
     connect(m_videoPlayerWidget, &VideoPlayerWidget::backToMain,
             this, &MainWindow::onBackToMain);
+    connect(m_streamListWidget, &StreamListWidget::alarmSearchRequested,
+            this, &MainWindow::onAlarmSearchRequested);
+    connect(m_videoPlayerWidget, &VideoPlayerWidget::playbackRequested,
+            this, &MainWindow::onPlaybackRequested);
+    connect(m_streamListWidget, &StreamListWidget::syncPlaybackRequested,
+            this, &MainWindow::onSyncPlaybackRequested);
+    connect(m_streamListWidget, &StreamListWidget::snapshotAllRequested,
+            this, &MainWindow::onSnapshotAllRequested);
+    setupRecording();
+    setupSampling();
+    setupRestream();
+    setupFrameExport();
     
     // 创建并启动ZMQ客户端
-    msgClient *client = new msgClient("192.168.10.107");
-    connect(client, &msgClient::msgReceived,
-            this, &MainWindow::onMsgReceived);
-    connect(client, &msgClient::rtspUrlReceived,
+    m_msgClient = new msgClient(m_config.servers, m_config.alarmTopicFilter);
+    m_msgClient->setAlarmRateLimit(m_config.alarmRateLimit, m_config.alarmRateBurst,
+                                   m_config.alarmSuppressWindowMs);
+    loadAlarmRules();
+    m_msgClient->enableTelemetry(m_config.telemetryPort, m_config.telemetryIntervalMs,
+                                 m_config.telemetryClientId);
+    connect(m_msgClient, &msgClient::alarmReceived,
+            this, &MainWindow::onAlarmReceived);
+    connect(m_msgClient, &msgClient::rtspUrlReceived,
             this, &MainWindow::onRtspUrlReceived);
-    connect(client, &msgClient::errorOccurred,
+    connect(m_msgClient, &msgClient::errorOccurred,
             this, &MainWindow::onZmqError);
+    connect(m_msgClient, &msgClient::connectionStateChanged,
+            this, &MainWindow::onConnectionStateChanged);
     
     // 启动客户端
-    client->start();
+    m_msgClient->start();
 }
 
 MainWindow::~MainWindow()
 {
+    // 录像先于StreamHub停止，保证分段正常收尾
+    delete m_recordingManager;
+    delete m_samplingManager;
+    delete m_restreamServer;
+    delete m_frameExportManager;
+    
+    if (m_alarmStore) {
+        // 等待索引重建结束后再停止存储
+        m_indexPool.waitForDone();
+        m_alarmStore->stop();
+    }
+    delete m_alarmSearchIndex;
 }
 
 void MainWindow::setupUI()
@@ -69,14 +154,98 @@ void MainWindow::setupUI()
     m_streamListWidget = new StreamListWidget(this);
     m_stackedWidget->addWidget(m_streamListWidget);
     
+    // 观看和录像共用的播放器，报警前缓冲对所有打开的流生效，同时用于即时回看
+    m_streamHub = new StreamHub(this);
+    m_streamHub->setPacketRing(qint64(qMax(m_config.clipPreSeconds, m_config.replaySeconds)) * 1000,
+                               qint64(qMax(1, m_config.clipBufferMB)) * 1024 * 1024);
+    
     // 创建视频播放器组件
     m_videoPlayerWidget = new VideoPlayerWidget(this);
     m_stackedWidget->addWidget(m_videoPlayerWidget);
     
+    m_videoPlayerWidget->setStreamHub(m_streamHub);
+    m_snapshotWriter = new SnapshotWriter(m_config.snapshotDir, m_config.snapshotFormat, m_config.snapshotQuality,
+                                          m_config.snapshotThreads, this);
+    connect(m_snapshotWriter, &SnapshotWriter::saved, this, [](const QString &path, bool ok) {
+        qDebug() << (ok ? "截图已保存:" : "截图保存失败:") << path;
+    });
+    m_videoPlayerWidget->setSnapshotWriter(m_snapshotWriter);
+    m_videoPlayerWidget->setAlarmHistoryLimit(m_config.alarmHistoryLimit);
+    m_videoPlayerWidget->setClipOptions(m_config.clipDir, m_config.clipPreSeconds, m_config.clipPostSeconds,
+                                        m_config.clipFormat);
+    m_videoPlayerWidget->setReplaySeconds(m_config.replaySeconds);
+    
     // 默认显示流列表
     m_stackedWidget->setCurrentWidget(m_streamListWidget);
 }
 
+void MainWindow::setupAlarmStore()
+{
+    m_alarmStore = new AlarmStore(m_config.alarmStoreDir, m_config.alarmSegmentBytes,
+                                  m_config.alarmMaxSegments, this);
+    connect(m_alarmStore, &AlarmStore::errorOccurred, this, [](const QString &error_msg) {
+        qWarning() << "报警存储错误:" << error_msg;
+    });
+    if (!m_alarmStore->open()) {
+        qWarning() << "报警历史存储不可用:" << m_config.alarmStoreDir;
+        delete m_alarmStore;
+        m_alarmStore = nullptr;
+        return;
+    }
+    
+    // 恢复上次运行时的报警记录，按由旧到新的顺序插入显示
+    // 记录是原始消息，与实时报警一样解析后显示文本，并计入所属流的统计；
+    // 启动时还没有在播放的流，属于某路流的报警带上流ID显示
+    QVector<AlarmRecord> history = m_alarmStore->query(0, QDateTime::currentMSecsSinceEpoch(),
+                                                       m_config.alarmHistoryLimit);
+    for (int i = history.size() - 1; i >= 0; --i) {
+        AlarmEvent alarm = AlarmEvent::fromMessage(history.at(i).payload);
+        alarm.timestamp = history.at(i).timestamp;
+        if (alarm.streamId.isEmpty()) {
+            m_videoPlayerWidget->addAlarmMessage(alarm.text, alarm.timestamp);
+            continue;
+        }
+        m_streamListWidget->routeAlarm(alarm);
+        m_videoPlayerWidget->addAlarmMessage(QString("[%1] %2").arg(alarm.streamId, alarm.text), alarm.timestamp);
+    }
+    
+    // 全文索引：已有记录在后台重建，新记录在写线程提交后直接增量加入
+    m_alarmSearchIndex = new AlarmSearchIndex();
+    m_alarmSearchIndex->beginRebuild();
+    quint64 untilId = m_alarmStore->nextId();
+    AlarmSearchIndex *index = m_alarmSearchIndex;
+    connect(m_alarmStore, &AlarmStore::recordsCommitted, m_alarmStore,
+            [index](const QVector<AlarmRecord> &records) {
+                index->addRecords(records);
+            }, Qt::DirectConnection);
+    connect(m_alarmStore, &AlarmStore::segmentsExpired, m_alarmStore,
+            [index](quint64 firstId) {
+                index->dropBefore(firstId);
+            }, Qt::DirectConnection);
+    
+    m_alarmStore->start();
+    m_indexPool.start(new AlarmIndexRebuildTask(m_alarmStore, m_alarmSearchIndex, untilId));
+}
+
+void MainWindow::setupRecording()
+{
+    if (m_config.recordStreams.isEmpty()) {
+        return;
+    }
+    
+    m_recordingManager = new RecordingManager(m_streamHub, m_config.recordDir);
+    m_recordingManager->setTargets(m_config.recordStreams);
+    m_recordingManager->setSegmentSeconds(m_config.recordSegmentSeconds);
+    m_recordingManager->setPreallocBytes(qint64(qMax(0, m_config.recordPreallocMB)) * 1024 * 1024);
+    m_recordingManager->setQueueLimit(qint64(qMax(1, m_config.recordQueueMB)) * 1024 * 1024);
+    m_recordingManager->setQuotaBytes(qint64(qMax(0, m_config.recordQuotaGB)) * 1024 * 1024 * 1024);
+    
+    // 以流ID指定的录像等目录中出现该流时开始
+    connect(m_streamListWidget, &StreamListWidget::streamAdded,
+            m_recordingManager, &RecordingManager::onStreamAdded);
+    m_recordingManager->start();
+}
+
 void MainWindow::setupStreamData()
 {
     // 这里可以添加实际的RTSP流数据
@@ -94,27 +263,61 @@ void MainWindow::applyStyles()
     )");
 }
 
-void MainWindow::onStreamSelected(const QString &streamName, const QString &streamUrl)
+void MainWindow::onStreamSelected(const QString &streamName, const QString &streamUrl, const QString &streamId)
 {
+    // 只接收正在观看的流的报警
+    m_msgClient->unwatchStream(m_videoPlayerWidget->currentStreamId());
+    m_msgClient->watchStream(streamId);
+    
     // 切换到视频播放界面
-    m_videoPlayerWidget->playStream(streamName, streamUrl);
+    m_videoPlayerWidget->playStream(streamName, streamUrl, streamId);
     m_stackedWidget->setCurrentWidget(m_videoPlayerWidget);
 }
 
 void MainWindow::onBackToMain()
 {
-    // 停止当前视频播放
+    // 停止当前视频播放并取消该流的报警订阅
+    m_msgClient->unwatchStream(m_videoPlayerWidget->currentStreamId());
     m_videoPlayerWidget->stopStream();
     
     // 返回主界面
     m_stackedWidget->setCurrentWidget(m_streamListWidget);
 }
 
-void MainWindow::onMsgReceived(const QString &msg)
+void MainWindow::onAlarmReceived(const AlarmEvent &alarm)
 {
-    qDebug() << "Received alarm message:" << msg;
-    // 将报警消息添加到视频播放器的报警信息框
-    m_videoPlayerWidget->addAlarmMessage(msg);
+    // 持久化到报警历史，只入队不落盘；索引按接收时间排序，不受服务端时钟影响
+    if (m_alarmStore) {
+        QByteArray payload = alarm.binary ? alarm.toJson() : alarm.raw;
+        m_alarmStore->append(QDateTime::currentMSecsSinceEpoch(), QString::fromUtf8(payload));
+    }
+    
+    // 规则已在接收线程上求值，这里只执行动作
+    if (alarm.actions & AlarmEvent::Hidden) {
+        return;
+    }
+    if (alarm.actions & AlarmEvent::Sound) {
+        playAlarmSound(alarm.sound);
+    }
+    bool highlight = alarm.actions & AlarmEvent::Highlight;
+    
+    // 不属于任何流的报警照旧显示在播放界面
+    if (alarm.streamId.isEmpty()) {
+        m_videoPlayerWidget->addAlarmMessage(alarm.text, alarm.timestamp, highlight, alarm.snapshot);
+        return;
+    }
+    
+    // 按流ID路由到列表项统计，只有当前正在播放的流才显示到报警框
+    if (!m_streamListWidget->routeAlarm(alarm)) {
+        qDebug() << "报警所属的流不在列表中:" << alarm.streamId;
+    }
+    if (alarm.streamId == m_videoPlayerWidget->currentStreamId()) {
+        m_videoPlayerWidget->addAlarmMessage(alarm.text, alarm.timestamp, highlight, alarm.snapshot);
+        // 片段按本机接收时间截取，与报警前缓冲使用同一时钟
+        if (m_config.clipOnAlarm) {
+            m_videoPlayerWidget->saveClip(QDateTime::currentMSecsSinceEpoch());
+        }
+    }
 }
 
 void MainWindow::onRtspUrlReceived(const QString &msg)
@@ -124,6 +327,169 @@ void MainWindow::onRtspUrlReceived(const QString &msg)
     m_streamListWidget->addRtspStream(msg);
 }
 
+void MainWindow::loadAlarmRules()
+{
+    if (!QFileInfo::exists(m_config.alarmRulesFile)) {
+        qDebug() << "未找到报警规则文件，显示全部报警:" << m_config.alarmRulesFile;
+        return;
+    }
+    
+    QString error;
+    QSharedPointer<AlarmRuleSet> rules = AlarmRuleSet::load(m_config.alarmRulesFile, &error);
+    if (!rules) {
+        qWarning() << "加载报警规则失败:" << error;
+        return;
+    }
+    m_msgClient->setAlarmRules(rules);
+}
+
+void MainWindow::playAlarmSound(const QString &sound)
+{
+    if (sound.isEmpty()) {
+        QApplication::beep();
+        return;
+    }
+    
+    // 相对路径相对于规则文件所在目录
+    QSoundEffect *effect = m_alarmSounds.value(sound);
+    if (!effect) {
+        QString path = QFileInfo(m_config.alarmRulesFile).dir().absoluteFilePath(sound);
+        effect = new QSoundEffect(this);
+        effect->setSource(QUrl::fromLocalFile(path));
+        m_alarmSounds.insert(sound, effect);
+    }
+    effect->play();
+}
+
+void MainWindow::onAlarmSearchRequested()
+{
+    if (!m_alarmStore || !m_alarmSearchIndex) {
+        qDebug() << "报警历史存储不可用，无法查询";
+        return;
+    }
+    
+    AlarmSearchDialog dialog(m_alarmStore, m_alarmSearchIndex, this);
+    dialog.exec();
+}
+
+void MainWindow::onPlaybackRequested(const QString &streamName, const QString &streamUrl, const QString &streamId)
+{
+    QString dir = m_recordingManager ? m_recordingManager->streamDir(streamId, streamUrl) : QString();
+    if (dir.isEmpty()) {
+        m_videoPlayerWidget->addAlarmMessage("该流未配置连续录像");
+        return;
+    }
+    
+    RecordingPlaybackDialog dialog(streamName, dir, qint64(qMax(16, m_config.playbackCacheMB)) * 1024 * 1024, this);
+    dialog.setTimelapseOptions(m_config.timelapseIntervalSeconds, m_config.timelapseThumbWidth,
+                               m_config.timelapseColumns, m_config.timelapseCpuBudget, m_config.timelapseFps);
+    dialog.exec();
+}
+
+void MainWindow::onSyncPlaybackRequested()
+{
+    QList<QPair<QString, QString> > streams;
+    if (m_recordingManager) {
+        streams = m_recordingManager->recordedStreams();
+    }
+    if (streams.isEmpty()) {
+        qDebug() << "未配置连续录像，无法多路回放";
+        return;
+    }
+    if (streams.size() > SyncPlaybackDialog::MAX_TILES) {
+        qDebug() << "录像路数超过" << SyncPlaybackDialog::MAX_TILES << "，只回放前" << SyncPlaybackDialog::MAX_TILES << "路";
+    }
+    
+    SyncPlaybackDialog dialog(streams, qint64(qMax(16, m_config.playbackCacheMB)) * 1024 * 1024, this);
+    dialog.exec();
+}
+
+void MainWindow::setupSampling()
+{
+    if (m_config.sampleStreams.isEmpty()) {
+        return;
+    }
+    
+    m_samplingManager = new SamplingManager(m_streamHub, m_config.sampleDir);
+    m_samplingManager->setTargets(m_config.sampleStreams);
+    m_samplingManager->setInterval(m_config.sampleIntervalMs);
+    m_samplingManager->setFrameSize(QSize(m_config.sampleWidth, m_config.sampleHeight));
+    m_samplingManager->setOutput(m_config.sampleFormat, m_config.sampleQuality, m_config.sampleThreads,
+                                 m_config.samplePending);
+    m_samplingManager->setQueueLimit(qint64(qMax(1, m_config.sampleQueueMB)) * 1024 * 1024);
+    
+    connect(m_streamListWidget, &StreamListWidget::streamAdded,
+            m_samplingManager, &SamplingManager::onStreamAdded);
+    m_samplingManager->start();
+}
+
+void MainWindow::setupRestream()
+{
+    if (m_config.restreamPort <= 0) {
+        return;
+    }
+    
+    m_restreamServer = new RestreamServer(m_streamHub);
+    m_restreamServer->setClientQueueLimit(qint64(qMax(64, m_config.restreamClientQueueKB)) * 1024);
+    connect(m_streamListWidget, &StreamListWidget::streamAdded,
+            m_restreamServer, &RestreamServer::onStreamAdded);
+    if (!m_restreamServer->listen(quint16(m_config.restreamPort))) {
+        delete m_restreamServer;
+        m_restreamServer = nullptr;
+    }
+}
+
+void MainWindow::setupFrameExport()
+{
+    if (m_config.exportStreams.isEmpty()) {
+        return;
+    }
+    
+    m_frameExportManager = new FrameExportManager(m_streamHub);
+    m_frameExportManager->setTargets(m_config.exportStreams);
+    m_frameExportManager->setFormat(m_config.exportFormat, QSize(m_config.exportWidth, m_config.exportHeight));
+    m_frameExportManager->setSlotCount(m_config.exportSlots);
+    m_frameExportManager->setAnnounceEndpoint(m_config.exportAnnounce);
+    
+    connect(m_streamListWidget, &StreamListWidget::streamAdded,
+            m_frameExportManager, &FrameExportManager::onStreamAdded);
+    m_frameExportManager->start();
+}
+
+void MainWindow::onSnapshotAllRequested()
+{
+    // 正在观看的流直接取当前画面，其余打开的流（录像等）取缓冲中最近的关键帧，各自在线程池上并行编码
+    StreamPlayer *watched = m_videoPlayerWidget->currentPlayer();
+    if (watched) {
+        m_videoPlayerWidget->snapshot();
+    }
+    int queued = 0;
+    const QList<QPair<QString, StreamPlayer *> > streams = m_streamHub->openStreams();
+    for (const QPair<QString, StreamPlayer *> &stream : streams) {
+        if (stream.second == watched || !stream.second->packetRing()) {
+            continue;
+        }
+        QSharedPointer<PacketClip> clip = stream.second->packetRing()->extract(QDateTime::currentMSecsSinceEpoch());
+        if (clip && m_snapshotWriter->captureKeyframe(stream.first, clip)) {
+            ++queued;
+        }
+    }
+    qDebug() << "全部截图: 观看中" << (watched ? 1 : 0) << "路，其余" << queued << "路";
+}
+
+void MainWindow::onConnectionStateChanged(const QString &channel, int connectedServers)
+{
+    MsgClientStats stats = m_msgClient->stats();
+    int total = m_msgClient->serverCount();
+    QString text = QString("目录 %1/%3  报警 %2/%3")
+                       .arg(stats.rtsp_servers).arg(stats.alarm_servers).arg(total);
+    m_streamListWidget->setConnectionStatus(text, stats.rtsp_servers > 0 && stats.alarm_servers > 0);
+    
+    if (connectedServers == 0) {
+        qWarning() << channel << "通道与所有消息服务器断开，累计断开次数:" << stats.disconnects;
+    }
+}
+
 void MainWindow::onZmqError(const QString &error_msg)
 {
     qDebug() << "ZMQ Error:" << error_msg;
@@ -15,31 +15,67 @@
 #include <QTimer>
 #include <QPropertyAnimation>
 #include <QGraphicsOpacityEffect>
+#include <QHash>
+#include <QThreadPool>
 #include "msgClient.hpp"
+#include "appconfig.h"
 
 class StreamListWidget;
 class VideoPlayerWidget;
+class AlarmStore;
+class AlarmSearchIndex;
+class StreamHub;
+class RecordingManager;
+class SnapshotWriter;
+class SamplingManager;
+class RestreamServer;
+class FrameExportManager;
+class QSoundEffect;
 
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
 public:
-    MainWindow(QWidget *parent = nullptr);
+    explicit MainWindow(const AppConfig &config, QWidget *parent = nullptr);
     ~MainWindow();
 
 private slots:
-    void onStreamSelected(const QString &streamName, const QString &streamUrl);
+    void onStreamSelected(const QString &streamName, const QString &streamUrl, const QString &streamId);
     void onBackToMain();
-    void onMsgReceived(const QString &msg);
+    void onAlarmReceived(const AlarmEvent &alarm);
     void onRtspUrlReceived(const QString &msg);
     void onZmqError(const QString &error_msg);
+    void onConnectionStateChanged(const QString &channel, int connectedServers);
+    void onAlarmSearchRequested();
+    void onSyncPlaybackRequested();
+    void onSnapshotAllRequested();
+    void onPlaybackRequested(const QString &streamName, const QString &streamUrl, const QString &streamId);
 
 private:
     void setupUI();
     void setupStreamData();
     void applyStyles();
+    void setupAlarmStore();
+    void setupRecording();
+    void setupSampling();
+    void setupRestream();
+    void setupFrameExport();
+    void loadAlarmRules();
+    void playAlarmSound(const QString &sound);
 
+    AppConfig m_config;
+    msgClient *m_msgClient;
+    AlarmStore *m_alarmStore;
+    AlarmSearchIndex *m_alarmSearchIndex;
+    QThreadPool m_indexPool;                // 全文索引重建，退出时只等待它
+    QHash<QString, QSoundEffect *> m_alarmSounds;
+    StreamHub *m_streamHub;
+    RecordingManager *m_recordingManager;
+    SnapshotWriter *m_snapshotWriter;
+    SamplingManager *m_samplingManager;
+    RestreamServer *m_restreamServer;
+    FrameExportManager *m_frameExportManager;
     QStackedWidget *m_stackedWidget;
     StreamListWidget *m_streamListWidget;
     VideoPlayerWidget *m_videoPlayerWidget;
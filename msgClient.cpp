@@ -1,11 +1,80 @@
 #include <msgClient.hpp>
+#include "alarmratelimiter.h"
+#include "alarmrules.h"
 #include <zmq.h>
 #include <iostream>
 #include <string>
 #include <QDebug>
 #include <QThread>
+#include <QMutexLocker>
+#include <QDateTime>
+#include <QTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <cstring>
 
-msgClient::msgClient(const QString &server_ip) {
+namespace {
+const char ALARM_TOPIC_PREFIX[] = "alarm/";
+const char ALARM_BROADCAST_TOPIC[] = "alarm/*/";
+const char TELEMETRY_TOPIC_PREFIX[] = "telemetry/";
+
+// ZMTP心跳：每秒发一次PING，3秒收不到回应即断开连接，随后由libzmq按重连间隔重连
+const int HEARTBEAT_IVL_MS = 1000;
+const int HEARTBEAT_TIMEOUT_MS = 3000;
+const int POLL_TIMEOUT_MS = 1000;
+
+void enableHeartbeat(void *socket) {
+#ifdef ZMQ_HEARTBEAT_IVL
+    int ivl = HEARTBEAT_IVL_MS;
+    int timeout = HEARTBEAT_TIMEOUT_MS;
+    zmq_setsockopt(socket, ZMQ_HEARTBEAT_IVL, &ivl, sizeof(ivl));
+    zmq_setsockopt(socket, ZMQ_HEARTBEAT_TIMEOUT, &timeout, sizeof(timeout));
+    zmq_setsockopt(socket, ZMQ_HEARTBEAT_TTL, &timeout, sizeof(timeout));
+#else
+    Q_UNUSED(socket);
+#endif
+}
+
+// 在connect之前创建监视器，保证不漏掉第一次连接成功的事件
+void *createMonitor(void *context, void *socket, const char *endpoint) {
+    if (zmq_socket_monitor(socket, endpoint, ZMQ_EVENT_CONNECTED | ZMQ_EVENT_DISCONNECTED) != 0) {
+        qDebug() << "Failed to monitor socket:" << zmq_strerror(zmq_errno());
+        return nullptr;
+    }
+    
+    void *monitor = zmq_socket(context, ZMQ_PAIR);
+    if (!monitor) {
+        return nullptr;
+    }
+    int linger = 0;
+    zmq_setsockopt(monitor, ZMQ_LINGER, &linger, sizeof(linger));
+    if (zmq_connect(monitor, endpoint) != 0) {
+        qDebug() << "Failed to connect socket monitor:" << zmq_strerror(zmq_errno());
+        zmq_close(monitor);
+        return nullptr;
+    }
+    return monitor;
+}
+}
+
+msgClient::msgClient(const QStringList &server_ips, bool topic_filter)
+    : context(nullptr)
+    , rtsp_subscriber(nullptr)
+    , alarm_subscriber(nullptr)
+    , rtsp_monitor(nullptr)
+    , alarm_monitor(nullptr)
+    , telemetry_publisher(nullptr)
+    , server_ips(server_ips)
+    , server_count(server_ips.size())
+    , topic_filter(topic_filter)
+    , rtsp_thread(nullptr)
+    , alarm_thread(nullptr)
+    , alarm_worker(nullptr)
+    , telemetry_timer(nullptr)
+{
+    qRegisterMetaType<AlarmEvent>("AlarmEvent");
+    
     // 初始化ZMQ上下文
     context = zmq_ctx_new();
     if (!context) {
@@ -20,6 +89,7 @@ msgClient::msgClient(const QString &server_ip) {
         qDebug() << "Failed to create RTSP subscriber socket";
         emit errorOccurred("Failed to create RTSP subscriber socket");
         zmq_ctx_destroy(context);
+        context = nullptr;
         return;
     }
     
@@ -30,6 +100,8 @@ msgClient::msgClient(const QString &server_ip) {
         emit errorOccurred("Failed to create alarm subscriber socket");
         zmq_close(rtsp_subscriber);
         zmq_ctx_destroy(context);
+        rtsp_subscriber = nullptr;
+        context = nullptr;
         return;
     }
     
@@ -38,42 +110,68 @@ msgClient::msgClient(const QString &server_ip) {
     zmq_setsockopt(rtsp_subscriber, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
     zmq_setsockopt(alarm_subscriber, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
     
-    // 连接到RTSP服务器
-    std::string rtsp_endpoint = "tcp://" + server_ip.toStdString() + ":5555";
-    int rc = zmq_connect(rtsp_subscriber, rtsp_endpoint.c_str());
-    if (rc != 0) {
-        qDebug() << "Failed to connect to RTSP server:" << zmq_strerror(zmq_errno());
-        emit errorOccurred(QString("Failed to connect to RTSP server: %1").arg(zmq_strerror(zmq_errno())));
-        zmq_close(alarm_subscriber);
-        zmq_close(rtsp_subscriber);
-        zmq_ctx_destroy(context);
-        return;
-    }
+    // 断线后快速重连，服务器重启后尽快恢复
+    int reconnect_ivl = 500;
+    int reconnect_ivl_max = 5000;
+    zmq_setsockopt(rtsp_subscriber, ZMQ_RECONNECT_IVL, &reconnect_ivl, sizeof(reconnect_ivl));
+    zmq_setsockopt(rtsp_subscriber, ZMQ_RECONNECT_IVL_MAX, &reconnect_ivl_max, sizeof(reconnect_ivl_max));
+    zmq_setsockopt(alarm_subscriber, ZMQ_RECONNECT_IVL, &reconnect_ivl, sizeof(reconnect_ivl));
+    zmq_setsockopt(alarm_subscriber, ZMQ_RECONNECT_IVL_MAX, &reconnect_ivl_max, sizeof(reconnect_ivl_max));
     
-    // 连接到报警服务器
-    std::string alarm_endpoint = "tcp://" + server_ip.toStdString() + ":5556";
-    rc = zmq_connect(alarm_subscriber, alarm_endpoint.c_str());
-    if (rc != 0) {
-        qDebug() << "Failed to connect to alarm server:" << zmq_strerror(zmq_errno());
-        emit errorOccurred(QString("Failed to connect to alarm server: %1").arg(zmq_strerror(zmq_errno())));
-        zmq_close(alarm_subscriber);
-        zmq_close(rtsp_subscriber);
-        zmq_ctx_destroy(context);
-        return;
+    // SUB socket分不清发布者是安静还是已经宕机，靠心跳及时断开死连接，
+    // 再由监视器把连接/断开事件交给工作线程
+    enableHeartbeat(rtsp_subscriber);
+    enableHeartbeat(alarm_subscriber);
+    rtsp_monitor = createMonitor(context, rtsp_subscriber, "inproc://monitor-rtsp");
+    alarm_monitor = createMonitor(context, alarm_subscriber, "inproc://monitor-alarm");
+    
+    // 同一个SUB socket同时连接所有服务器，各服务器的目录和报警在libzmq中合并，
+    // 任一服务器重启时其他服务器的消息不受影响，不需要切换连接
+    for (const QString &server_ip : server_ips) {
+        std::string rtsp_endpoint = "tcp://" + server_ip.trimmed().toStdString() + ":5555";
+        if (zmq_connect(rtsp_subscriber, rtsp_endpoint.c_str()) != 0) {
+            qDebug() << "Failed to connect to RTSP server:" << zmq_strerror(zmq_errno());
+            emit errorOccurred(QString("Failed to connect to RTSP server %1: %2")
+                               .arg(server_ip).arg(zmq_strerror(zmq_errno())));
+            continue;
+        }
+        
+        std::string alarm_endpoint = "tcp://" + server_ip.trimmed().toStdString() + ":5556";
+        if (zmq_connect(alarm_subscriber, alarm_endpoint.c_str()) != 0) {
+            qDebug() << "Failed to connect to alarm server:" << zmq_strerror(zmq_errno());
+            emit errorOccurred(QString("Failed to connect to alarm server %1: %2")
+                               .arg(server_ip).arg(zmq_strerror(zmq_errno())));
+            zmq_disconnect(rtsp_subscriber, rtsp_endpoint.c_str());
+            continue;
+        }
+        
+        qDebug() << "连接到RTSP服务器:" << QString::fromStdString(rtsp_endpoint);
+        qDebug() << "连接到报警服务器:" << QString::fromStdString(alarm_endpoint);
     }
     
-    // 订阅所有消息
+    // RTSP地址订阅所有消息；报警只订阅广播主题，各流的主题在打开流时再订阅
     zmq_setsockopt(rtsp_subscriber, ZMQ_SUBSCRIBE, "", 0);
-    zmq_setsockopt(alarm_subscriber, ZMQ_SUBSCRIBE, "", 0);
+    if (topic_filter) {
+        zmq_setsockopt(alarm_subscriber, ZMQ_SUBSCRIBE, ALARM_BROADCAST_TOPIC, strlen(ALARM_BROADCAST_TOPIC));
+    } else {
+        zmq_setsockopt(alarm_subscriber, ZMQ_SUBSCRIBE, "", 0);
+    }
     
-    qDebug() << "ZMQ客户端初始化成功";
-    qDebug() << "连接到RTSP服务器:" << QString::fromStdString(rtsp_endpoint);
-    qDebug() << "连接到报警服务器:" << QString::fromStdString(alarm_endpoint);
+    qDebug() << "ZMQ客户端初始化成功，服务器数:" << server_ips.size();
 }
 
 msgClient::~msgClient() {
     stop();
     
+    if (alarm_monitor) {
+        zmq_socket_monitor(alarm_subscriber, nullptr, 0);
+        zmq_close(alarm_monitor);
+    }
+    if (rtsp_monitor) {
+        zmq_socket_monitor(rtsp_subscriber, nullptr, 0);
+        zmq_close(rtsp_monitor);
+    }
+    if (telemetry_publisher) zmq_close(telemetry_publisher);
     if (alarm_subscriber) zmq_close(alarm_subscriber);
     if (rtsp_subscriber) zmq_close(rtsp_subscriber);
     if (context) zmq_ctx_destroy(context);
@@ -91,25 +189,37 @@ void msgClient::start() {
     
     // 创建RTSP工作线程
     rtsp_thread = new QThread();
-    ZmqWorker *rtsp_worker = new ZmqWorker(rtsp_subscriber, "RTSP", running);
+    ZmqWorker *rtsp_worker = new ZmqWorker(rtsp_subscriber, "RTSP", running, false, &counters);
+    rtsp_worker->setMonitor(rtsp_monitor, &counters.rtsp_servers);
     rtsp_worker->moveToThread(rtsp_thread);
     
     // 连接RTSP工作线程信号
     connect(rtsp_thread, &QThread::started, rtsp_worker, &ZmqWorker::run);
     connect(rtsp_worker, &ZmqWorker::messageReceived, this, &msgClient::rtspUrlReceived);
     connect(rtsp_worker, &ZmqWorker::errorOccurred, this, &msgClient::errorOccurred);
+    connect(rtsp_worker, &ZmqWorker::connectionStateChanged, this, [this](int connected_servers) {
+        emit connectionStateChanged("RTSP", connected_servers);
+    });
     connect(rtsp_thread, &QThread::finished, rtsp_worker, &ZmqWorker::deleteLater);
     connect(rtsp_thread, &QThread::finished, rtsp_thread, &QThread::deleteLater);
     
     // 创建报警工作线程
     alarm_thread = new QThread();
-    ZmqWorker *alarm_worker = new ZmqWorker(alarm_subscriber, "ALARM", running);
+    alarm_worker = new ZmqWorker(alarm_subscriber, "ALARM", running, true, &counters);
+    if (alarm_rate > 0.0) {
+        alarm_worker->setRateLimiter(new AlarmRateLimiter(alarm_rate, alarm_burst, alarm_suppress_window_ms));
+    }
+    alarm_worker->setAlarmRules(alarm_rules);
+    alarm_worker->setMonitor(alarm_monitor, &counters.alarm_servers);
     alarm_worker->moveToThread(alarm_thread);
     
     // 连接报警工作线程信号
     connect(alarm_thread, &QThread::started, alarm_worker, &ZmqWorker::run);
-    connect(alarm_worker, &ZmqWorker::messageReceived, this, &msgClient::msgReceived);
+    connect(alarm_worker, &ZmqWorker::alarmReceived, this, &msgClient::alarmReceived);
     connect(alarm_worker, &ZmqWorker::errorOccurred, this, &msgClient::errorOccurred);
+    connect(alarm_worker, &ZmqWorker::connectionStateChanged, this, [this](int connected_servers) {
+        emit connectionStateChanged("ALARM", connected_servers);
+    });
     connect(alarm_thread, &QThread::finished, alarm_worker, &ZmqWorker::deleteLater);
     connect(alarm_thread, &QThread::finished, alarm_thread, &QThread::deleteLater);
     
@@ -138,11 +248,213 @@ void msgClient::stop() {
         alarm_thread->quit();
         alarm_thread->wait();
         alarm_thread = nullptr;
+        alarm_worker = nullptr;
     }
     
     qDebug() << "ZMQ客户端已停止";
 }
 
+bool msgClient::parseStreamInfo(const QString &jsonData, QString &name, QString &url, QString &id) {
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(jsonData.toUtf8(), &error);
+    
+    if (error.error != QJsonParseError::NoError) {
+        qDebug() << "JSON解析错误:" << error.errorString();
+        return false;
+    }
+    
+    if (!doc.isObject()) {
+        qDebug() << "JSON数据不是对象格式";
+        return false;
+    }
+    
+    QJsonObject obj = doc.object();
+    
+    // 检查必需的字段
+    if (!obj.contains("name") || !obj.contains("url")) {
+        qDebug() << "JSON缺少必需字段 (name 或 url)";
+        return false;
+    }
+    
+    // 提取字段值
+    name = obj["name"].toString();
+    url = obj["url"].toString();
+    id = obj["id"].toString(); // id是可选的
+    
+    // 验证数据有效性
+    if (name.isEmpty() || url.isEmpty()) {
+        qDebug() << "JSON字段值为空";
+        return false;
+    }
+    
+    qDebug() << "JSON解析成功 - 名称:" << name << "URL:" << url << "ID:" << id;
+    return true;
+}
+
+QByteArray msgClient::alarmTopic(const QString &stream_id) {
+    return QByteArray(ALARM_TOPIC_PREFIX) + stream_id.toUtf8() + '/';
+}
+
+void msgClient::setAlarmRateLimit(double rate, int burst, int window_ms) {
+    alarm_rate = rate;
+    alarm_burst = burst;
+    alarm_suppress_window_ms = window_ms;
+}
+
+MsgClientStats msgClient::stats() const {
+    MsgClientStats snapshot;
+    snapshot.alarms_received = counters.alarms_received.load();
+    snapshot.alarms_suppressed = counters.alarms_suppressed.load();
+    snapshot.alarms_duplicated = counters.alarms_duplicated.load();
+    snapshot.rtsp_servers = counters.rtsp_servers.load();
+    snapshot.alarm_servers = counters.alarm_servers.load();
+    snapshot.disconnects = counters.disconnects.load();
+    return snapshot;
+}
+
+void msgClient::setAlarmRules(const QSharedPointer<const AlarmRuleSet> &rules) {
+    alarm_rules = rules;
+    if (alarm_worker) {
+        alarm_worker->setAlarmRules(rules);
+    }
+}
+
+bool msgClient::enableTelemetry(int port, int interval_ms, const QString &client_id) {
+    if (!context || telemetry_publisher || interval_ms <= 0) {
+        return false;
+    }
+    
+    telemetry_publisher = zmq_socket(context, ZMQ_PUB);
+    if (!telemetry_publisher) {
+        emit errorOccurred("Failed to create telemetry publisher socket");
+        return false;
+    }
+    
+    // 只保留少量未发出的消息，服务器不在时直接丢弃，退出时不等待
+    int hwm = 4;
+    int linger = 0;
+    zmq_setsockopt(telemetry_publisher, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(telemetry_publisher, ZMQ_LINGER, &linger, sizeof(linger));
+    
+    for (const QString &server_ip : server_ips) {
+        std::string endpoint = "tcp://" + server_ip.trimmed().toStdString() + ":" + std::to_string(port);
+        if (zmq_connect(telemetry_publisher, endpoint.c_str()) != 0) {
+            emit errorOccurred(QString("Failed to connect telemetry to %1: %2")
+                               .arg(server_ip).arg(zmq_strerror(zmq_errno())));
+        }
+    }
+    
+    telemetry_topic = QByteArray(TELEMETRY_TOPIC_PREFIX) + client_id.toUtf8() + '/';
+    telemetry_last_ms = QDateTime::currentMSecsSinceEpoch();
+    telemetry_timer = new QTimer(this);
+    connect(telemetry_timer, &QTimer::timeout, this, &msgClient::publishTelemetry);
+    telemetry_timer->start(interval_ms);
+    
+    qDebug() << "客户端遥测已启用，主题:" << telemetry_topic << "周期(ms):" << interval_ms;
+    return true;
+}
+
+// 消息为两帧：[telemetry/<client_id>/][紧凑JSON]
+// {"ts":..., "interval_ms":..., "cpu":12.5, "rss_kb":..., "alarms":{...}, "servers":{...},
+//  "streams":[{"id":..., "fps":..., "decode_ms":..., "drops":..., "reconnects":..., "ring_kb":...}]}
+// 除cpu、rss_kb外各项都是本周期内的值：decode_ms为每帧平均的纯解码耗时，reconnects为自动重连次数
+// streams只包含本周期内有解码、丢包或重连的流
+void msgClient::publishTelemetry() {
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 elapsed = qMax<qint64>(1, now - telemetry_last_ms);
+    telemetry_last_ms = now;
+    
+    QJsonArray streams;
+    const QHash<QString, QSharedPointer<StreamCounters> > all = StreamStatsRegistry::instance().streams();
+    for (auto it = all.constBegin(); it != all.constEnd(); ++it) {
+        StreamSample current;
+        current.frames = it.value()->frames.load(std::memory_order_relaxed);
+        current.decode_us = it.value()->decodeUs.load(std::memory_order_relaxed);
+        current.drops = it.value()->drops.load(std::memory_order_relaxed);
+        current.reconnects = it.value()->reconnects.load(std::memory_order_relaxed);
+        StreamSample &last = telemetry_last[it.key()];
+        
+        quint64 frames = current.frames - last.frames;
+        quint64 drops = current.drops - last.drops;
+        quint64 decode_us = current.decode_us - last.decode_us;
+        quint64 reconnects = current.reconnects - last.reconnects;
+        last = current;
+        if (frames == 0 && drops == 0 && reconnects == 0) {
+            continue;
+        }
+        
+        QJsonObject stream;
+        stream["id"] = it.key();
+        stream["fps"] = qRound(double(frames) * 10000.0 / double(elapsed)) / 10.0;
+        stream["decode_ms"] = frames ? qRound(double(decode_us) / double(frames) / 100.0) / 10.0 : 0.0;
+        stream["drops"] = double(drops);
+        stream["reconnects"] = double(reconnects);
+        stream["ring_kb"] = double(it.value()->ringBytes.load(std::memory_order_relaxed) / 1024);
+        streams.append(stream);
+    }
+    
+    MsgClientStats snapshot = stats();
+    QJsonObject alarms;
+    alarms["received"] = double(snapshot.alarms_received);
+    alarms["suppressed"] = double(snapshot.alarms_suppressed);
+    alarms["duplicated"] = double(snapshot.alarms_duplicated);
+    QJsonObject servers;
+    servers["rtsp"] = snapshot.rtsp_servers;
+    servers["alarm"] = snapshot.alarm_servers;
+    servers["disconnects"] = double(snapshot.disconnects);
+    
+    QJsonObject root;
+    root["ts"] = double(now);
+    root["interval_ms"] = double(elapsed);
+    root["cpu"] = qRound(process_usage.cpuPercent() * 10.0) / 10.0;
+    root["rss_kb"] = double(process_usage.residentKb());
+    root["alarms"] = alarms;
+    root["servers"] = servers;
+    root["streams"] = streams;
+    QByteArray body = QJsonDocument(root).toJson(QJsonDocument::Compact);
+    
+    // 非阻塞发送，发不出去就丢掉这一周期
+    if (zmq_send(telemetry_publisher, telemetry_topic.constData(), telemetry_topic.size(),
+                 ZMQ_SNDMORE | ZMQ_DONTWAIT) == -1) {
+        return;
+    }
+    zmq_send(telemetry_publisher, body.constData(), body.size(), ZMQ_DONTWAIT);
+}
+
+void msgClient::updateSubscription(const QByteArray &topic, bool subscribe) {
+    if (alarm_worker) {
+        // socket归工作线程所有，交给它去改
+        alarm_worker->queueSubscription(topic, subscribe);
+    } else {
+        zmq_setsockopt(alarm_subscriber, subscribe ? ZMQ_SUBSCRIBE : ZMQ_UNSUBSCRIBE,
+                       topic.constData(), topic.size());
+    }
+}
+
+void msgClient::watchStream(const QString &stream_id) {
+    if (!topic_filter || stream_id.isEmpty()) {
+        return;
+    }
+    
+    if (watched_streams[stream_id]++ == 0) {
+        updateSubscription(alarmTopic(stream_id), true);
+        qDebug() << "订阅报警主题:" << alarmTopic(stream_id);
+    }
+}
+
+void msgClient::unwatchStream(const QString &stream_id) {
+    auto it = watched_streams.find(stream_id);
+    if (it == watched_streams.end()) {
+        return;
+    }
+    
+    if (--it.value() == 0) {
+        watched_streams.erase(it);
+        updateSubscription(alarmTopic(stream_id), false);
+        qDebug() << "取消订阅报警主题:" << alarmTopic(stream_id);
+    }
+}
+
 QString msgClient::receiveMessage(void *socket, const QString &socket_name) {
     char buffer[1024];
     int size = zmq_recv(socket, buffer, sizeof(buffer) - 1, 0);
@@ -204,43 +516,285 @@ void msgClient::receiveAlarmMessages() {
 }
 
 // ZmqWorker 实现
-ZmqWorker::ZmqWorker(void *socket, const QString &socket_name, std::atomic<bool> &running_flag)
+ZmqWorker::ZmqWorker(void *socket, const QString &socket_name, std::atomic<bool> &running_flag,
+                     bool parse_alarms, ZmqCounters *counters)
     : m_socket(socket)
     , m_socket_name(socket_name)
     , m_running(running_flag)
+    , m_parse_alarms(parse_alarms)
+    , m_counters(counters)
+    , m_rate_limiter(nullptr)
+    , m_monitor(nullptr)
+    , m_connected_servers(nullptr)
 {
 }
 
+ZmqWorker::~ZmqWorker() {
+    delete m_rate_limiter;
+    for (zmq_msg_t *frame : m_frames) {
+        zmq_msg_close(frame);
+        delete frame;
+    }
+}
+
+void ZmqWorker::setRateLimiter(AlarmRateLimiter *limiter) {
+    delete m_rate_limiter;
+    m_rate_limiter = limiter;
+}
+
+void ZmqWorker::setAlarmRules(const QSharedPointer<const AlarmRuleSet> &rules) {
+    QMutexLocker locker(&m_rules_mutex);
+    m_rules = rules;
+}
+
+void ZmqWorker::setMonitor(void *monitor_socket, std::atomic<int> *connected_servers) {
+    m_monitor = monitor_socket;
+    m_connected_servers = connected_servers;
+}
+
+// 同时等待数据和连接事件，数据socket可读时返回true
+bool ZmqWorker::waitForMessage() {
+    if (!m_monitor) {
+        // 没有监视器时直接阻塞在接收超时上
+        return true;
+    }
+    
+    zmq_pollitem_t items[] = {
+        { m_socket, 0, ZMQ_POLLIN, 0 },
+        { m_monitor, 0, ZMQ_POLLIN, 0 }
+    };
+    int rc = zmq_poll(items, 2, POLL_TIMEOUT_MS);
+    if (rc < 0) {
+        // 交给接收函数报告错误
+        return zmq_errno() != EINTR;
+    }
+    if (items[1].revents & ZMQ_POLLIN) {
+        handleMonitorEvents();
+    }
+    return items[0].revents & ZMQ_POLLIN;
+}
+
+void ZmqWorker::handleMonitorEvents() {
+    int before = m_connected_endpoints.size();
+    
+    // 每个事件两帧：[16位事件号 + 32位值][对端地址]
+    for (;;) {
+        zmq_msg_t frame;
+        zmq_msg_init(&frame);
+        if (zmq_msg_recv(&frame, m_monitor, ZMQ_DONTWAIT) == -1) {
+            zmq_msg_close(&frame);
+            break;
+        }
+        quint16 event = 0;
+        if (zmq_msg_size(&frame) >= sizeof(event)) {
+            memcpy(&event, zmq_msg_data(&frame), sizeof(event));
+        }
+        bool more = zmq_msg_more(&frame);
+        zmq_msg_close(&frame);
+        
+        QString endpoint;
+        if (more) {
+            zmq_msg_init(&frame);
+            if (zmq_msg_recv(&frame, m_monitor, 0) != -1) {
+                endpoint = QString::fromUtf8(static_cast<const char *>(zmq_msg_data(&frame)),
+                                             int(zmq_msg_size(&frame)));
+            }
+            zmq_msg_close(&frame);
+        }
+        
+        if (event == ZMQ_EVENT_CONNECTED) {
+            m_connected_endpoints.insert(endpoint);
+            qDebug() << QString("%1通道已连接: %2").arg(m_socket_name, endpoint);
+        } else if (event == ZMQ_EVENT_DISCONNECTED && m_connected_endpoints.remove(endpoint)) {
+            if (m_counters) {
+                m_counters->disconnects.fetch_add(1);
+            }
+            qDebug() << QString("%1通道已断开: %2").arg(m_socket_name, endpoint);
+        }
+    }
+    
+    int after = m_connected_endpoints.size();
+    if (after != before) {
+        if (m_connected_servers) {
+            m_connected_servers->store(after);
+        }
+        emit connectionStateChanged(after);
+    }
+}
+
+void ZmqWorker::queueSubscription(const QByteArray &topic, bool subscribe) {
+    QMutexLocker locker(&m_subscription_mutex);
+    m_pending_subscriptions.append(qMakePair(topic, subscribe));
+}
+
+void ZmqWorker::applyPendingSubscriptions() {
+    QVector<QPair<QByteArray, bool> > pending;
+    {
+        QMutexLocker locker(&m_subscription_mutex);
+        pending.swap(m_pending_subscriptions);
+    }
+    
+    for (const auto &op : pending) {
+        zmq_setsockopt(m_socket, op.second ? ZMQ_SUBSCRIBE : ZMQ_UNSUBSCRIBE,
+                       op.first.constData(), op.first.size());
+    }
+}
+
+// 接收一条完整的（可能是多帧的）消息，返回帧数；超时返回0，出错返回-1
+// 帧不拷贝，parts通过fromRawData引用m_frames中的缓冲区，需要保留的数据由调用者自行拷贝
+int ZmqWorker::receiveParts(QVector<QByteArray> &parts) {
+    parts.clear();
+    
+    int more = 0;
+    do {
+        if (parts.size() == m_frames.size()) {
+            zmq_msg_t *frame = new zmq_msg_t;
+            zmq_msg_init(frame);
+            m_frames.append(frame);
+        }
+        
+        // zmq_msg_recv会先释放帧中上一次的内容
+        zmq_msg_t *frame = m_frames.at(parts.size());
+        int size = zmq_msg_recv(frame, m_socket, 0);
+        if (size == -1) {
+            int err = zmq_errno();
+            if (err == EAGAIN || err == EINTR) {
+                return 0;
+            }
+            qDebug() << QString("接收%1消息失败: %2").arg(m_socket_name).arg(zmq_strerror(err));
+            emit errorOccurred(QString("接收%1消息失败: %2").arg(m_socket_name).arg(zmq_strerror(err)));
+            return -1;
+        }
+        
+        parts.append(QByteArray::fromRawData(static_cast<const char *>(zmq_msg_data(frame)), size));
+        more = zmq_msg_more(frame);
+    } while (more);
+    
+    return parts.size();
+}
+
+void ZmqWorker::handleAlarm(const QVector<QByteArray> &parts, int count) {
+    // 消息为[主题][内容][抓拍JPEG]，主题和抓拍都可省略，单帧为不带主题的旧格式
+    int content_index = parts.size() > 1 && parts.first().startsWith(ALARM_TOPIC_PREFIX) ? 1 : 0;
+    QByteArray topic = content_index > 0 ? parts.first() : QByteArray();
+    if (parts.at(content_index).isEmpty()) {
+        return;
+    }
+    AlarmEvent alarm = AlarmEvent::fromMessage(parts.at(content_index));
+    
+    // 内容里没有流ID时从主题alarm/<流ID>/中取
+    if (alarm.streamId.isEmpty() && topic.startsWith(ALARM_TOPIC_PREFIX) && topic.endsWith('/')) {
+        int prefix_len = int(strlen(ALARM_TOPIC_PREFIX));
+        QString stream_id = QString::fromUtf8(topic.mid(prefix_len, topic.size() - prefix_len - 1));
+        if (stream_id != "*") {
+            alarm.streamId = stream_id;
+        }
+    }
+    
+    if (m_counters) {
+        m_counters->alarms_received.fetch_add(1);
+    }
+    
+    // 多台服务器可能发布同一条报警，按报警ID去重
+    if (isDuplicateAlarm(alarm.id)) {
+        if (m_counters) {
+            m_counters->alarms_duplicated.fetch_add(1);
+        }
+        return;
+    }
+    
+    // 超出速率的报警在这里丢弃，不再打印日志也不再发往GUI线程
+    if (m_rate_limiter && !m_rate_limiter->admit(alarm, QDateTime::currentMSecsSinceEpoch())) {
+        if (m_counters) {
+            m_counters->alarms_suppressed.fetch_add(1);
+        }
+        return;
+    }
+    
+    // 规则求值，结果随报警一起交给GUI线程
+    QSharedPointer<const AlarmRuleSet> rules;
+    {
+        QMutexLocker locker(&m_rules_mutex);
+        rules = m_rules;
+    }
+    if (rules) {
+        rules->evaluate(alarm);
+    }
+    
+    // 抓拍图引用的是接收缓冲区，只有确实要交给GUI时才拷贝
+    if (content_index + 1 < parts.size() && !(alarm.actions & AlarmEvent::Hidden)) {
+        const QByteArray &jpeg = parts.at(content_index + 1);
+        alarm.snapshot = QByteArray(jpeg.constData(), jpeg.size());
+    }
+    
+    qDebug() << QString("[%1 #%2] 流: %3 类型: %4").arg(m_socket_name).arg(count)
+                .arg(alarm.streamId, alarm.type);
+    emit alarmReceived(alarm);
+}
+
+bool ZmqWorker::isDuplicateAlarm(const QString &alarm_id) {
+    if (alarm_id.isEmpty()) {
+        return false;
+    }
+    if (m_recent_alarm_ids.contains(alarm_id)) {
+        return true;
+    }
+    
+    // 只记住最近的一批ID，先进先出淘汰
+    m_recent_alarm_ids.insert(alarm_id);
+    m_recent_alarm_order.enqueue(alarm_id);
+    if (m_recent_alarm_order.size() > RECENT_ALARM_IDS) {
+        m_recent_alarm_ids.remove(m_recent_alarm_order.dequeue());
+    }
+    return false;
+}
+
+void ZmqWorker::flushSuppressionSummaries() {
+    if (!m_rate_limiter) {
+        return;
+    }
+    
+    // 每个结束的抑制窗口发出一条汇总报警
+    const QVector<AlarmEvent> summaries = m_rate_limiter->takeSummaries(QDateTime::currentMSecsSinceEpoch());
+    for (const AlarmEvent &summary : summaries) {
+        emit alarmReceived(summary);
+    }
+}
+
 void ZmqWorker::run() {
     qDebug() << QString("%1工作线程已启动").arg(m_socket_name);
     
     int count = 0;
+    QVector<QByteArray> parts;
     while (m_running.load()) {
-        char buffer[1024];
-        int size = zmq_recv(m_socket, buffer, sizeof(buffer) - 1, 0);
+        applyPendingSubscriptions();
         
-        if (size == -1) {
-            if (zmq_errno() == EAGAIN) {
-                // 超时，没有消息
-                QThread::msleep(100);
-                continue;
-            } else {
-                qDebug() << QString("接收%1消息失败: %2").arg(m_socket_name).arg(zmq_strerror(zmq_errno()));
-                emit errorOccurred(QString("接收%1消息失败: %2").arg(m_socket_name).arg(zmq_strerror(zmq_errno())));
+        // 接收超时即返回，不再额外休眠
+        int rc = 0;
+        if (waitForMessage()) {
+            rc = receiveParts(parts);
+            if (rc < 0) {
                 break;
             }
         }
+        flushSuppressionSummaries();
+        if (rc == 0 || parts.last().isEmpty()) {
+            continue;
+        }
         
-        if (size > 0) {
-            buffer[size] = '\0';
-            count++;
-            QString msg = QString::fromUtf8(buffer, size);
+        count++;
+        if (m_parse_alarms) {
+            // 在接收线程上解析，GUI线程只处理结构化结果
+            handleAlarm(parts, count);
+        } else {
+            QString msg = QString::fromUtf8(parts.last());
             qDebug() << QString("[%1 #%2] 接收到: %3").arg(m_socket_name).arg(count).arg(msg);
             emit messageReceived(msg);
         }
-        
-        QThread::msleep(100); // 短暂延时
     }
     
+    // 退出前把尚未生效的订阅变更应用到socket上，下次启动时仍然有效
+    applyPendingSubscriptions();
+    
     qDebug() << QString("%1工作线程已停止，共接收 %2 条消息").arg(m_socket_name).arg(count);
 }
@@ -4,26 +4,118 @@
 #include <QThread>
 #include <QObject>
 #include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QPair>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QSet>
+#include <QQueue>
 #include <atomic>
+#include "alarmevent.h"
+#include "clienttelemetry.h"
 
+class ZmqWorker;
+class QTimer;
+struct zmq_msg_t;
+class AlarmRateLimiter;
+class AlarmRuleSet;
+
+// 客户端运行统计快照
+struct MsgClientStats {
+    quint64 alarms_received = 0;     // 收到的报警总数
+    quint64 alarms_suppressed = 0;   // 被风暴抑制丢弃的报警数
+    quint64 alarms_duplicated = 0;   // 多台服务器重复发布而被丢弃的报警数
+    int rtsp_servers = 0;            // RTSP通道当前连通的服务器数
+    int alarm_servers = 0;           // 报警通道当前连通的服务器数
+    quint64 disconnects = 0;         // 连接断开（含心跳超时）的累计次数
+};
+
+// 工作线程与客户端共享的计数器
+struct ZmqCounters {
+    std::atomic<quint64> alarms_received{0};
+    std::atomic<quint64> alarms_suppressed{0};
+    std::atomic<quint64> alarms_duplicated{0};
+    std::atomic<int> rtsp_servers{0};
+    std::atomic<int> alarm_servers{0};
+    std::atomic<quint64> disconnects{0};
+};
+
+// 报警按流ID分主题发布，消息为两帧：[alarm/<流ID>/][报警内容]
+// 不属于任何流的全站消息使用广播主题alarm/*/
 class msgClient : public QObject {
     Q_OBJECT
 private:
     void *context;
     void *rtsp_subscriber;    // 订阅5555端口的RTSP地址
     void *alarm_subscriber;   // 订阅5556端口的报警信息
+    void *rtsp_monitor;       // 两个订阅socket的连接事件监视器
+    void *alarm_monitor;
+    void *telemetry_publisher; // 向服务器回报客户端状态
+    QStringList server_ips;
+    int server_count;
     std::atomic<bool> running{false};
+    bool topic_filter;        // 为false时订阅全部报警（兼容不带主题的旧服务端）
     
     QThread *rtsp_thread;
     QThread *alarm_thread;
+    ZmqWorker *alarm_worker;
+    
+    // 正在观看的流及其引用计数
+    QHash<QString, int> watched_streams;
+    
+    // 报警风暴抑制参数，rate为0表示不限速
+    double alarm_rate = 0.0;
+    int alarm_burst = 10;
+    int alarm_suppress_window_ms = 10000;
+    ZmqCounters counters;
+    QSharedPointer<const AlarmRuleSet> alarm_rules;
+    
+    // 遥测：每个周期汇总为一条消息，速率按与上一周期的差值计算
+    struct StreamSample {
+        quint64 frames = 0;
+        quint64 decode_us = 0;
+        quint64 drops = 0;
+        quint64 reconnects = 0;
+    };
+    QTimer *telemetry_timer;
+    QByteArray telemetry_topic;
+    QHash<QString, StreamSample> telemetry_last;
+    qint64 telemetry_last_ms = 0;
+    ProcessUsage process_usage;
+    
+    void updateSubscription(const QByteArray &topic, bool subscribe);
+    void publishTelemetry();
 
 public:
-    msgClient(const QString &server_ip = "192.168.10.107");
+    // 同时连接列表中的所有服务器，合并它们的流目录和报警
+    msgClient(const QStringList &server_ips = QStringList() << "192.168.10.107", bool topic_filter = false);
     ~msgClient();
     
     void start();
     void stop();
     
+    // 打开/关闭流时调用，订阅过滤由libzmq完成
+    void watchStream(const QString &stream_id);
+    void unwatchStream(const QString &stream_id);
+    
+    static QByteArray alarmTopic(const QString &stream_id);
+    // 解析流目录消息{"name":..., "url":..., "id":...}，id可选；不是这种格式时返回false
+    static bool parseStreamInfo(const QString &jsonData, QString &name, QString &url, QString &id);
+    
+    // 每个(流, 报警类型)每秒最多放行rate条，可突发burst条，需在start()之前调用
+    void setAlarmRateLimit(double rate, int burst, int window_ms);
+    MsgClientStats stats() const;
+    int serverCount() const { return server_count; }
+    
+    // 报警规则在接收线程上求值，可随时替换，传空指针表示不使用规则
+    void setAlarmRules(const QSharedPointer<const AlarmRuleSet> &rules);
+    
+    // 每interval_ms向所有服务器的port端口发布一条状态汇总，主题为telemetry/<client_id>/
+    bool enableTelemetry(int port, int interval_ms, const QString &client_id);
+    
     // 接收消息的通用函数
     QString receiveMessage(void *socket, const QString &socket_name);
     
@@ -33,27 +125,75 @@ public:
 
 signals:
     void msgReceived(const QString &msg);
+    void alarmReceived(const AlarmEvent &alarm);
     void rtspUrlReceived(const QString &msg);
     void errorOccurred(const QString &error_msg);
+    // channel为"RTSP"或"ALARM"，connected_servers为0表示该通道已与所有服务器断开
+    void connectionStateChanged(const QString &channel, int connected_servers);
 };
 
 // 工作线程类
 class ZmqWorker : public QObject {
     Q_OBJECT
 public:
-    ZmqWorker(void *socket, const QString &socket_name, std::atomic<bool> &running_flag);
+    // parse_alarms为true时在本线程解析报警，发出alarmReceived而不是messageReceived
+    ZmqWorker(void *socket, const QString &socket_name, std::atomic<bool> &running_flag,
+              bool parse_alarms = false, ZmqCounters *counters = nullptr);
+    ~ZmqWorker();
+    
+    // 接管限速器，需在线程启动前设置
+    void setRateLimiter(AlarmRateLimiter *limiter);
+    // 线程安全
+    void setAlarmRules(const QSharedPointer<const AlarmRuleSet> &rules);
+    
+    // 线程安全，订阅变更在工作线程下一次接收前生效
+    void queueSubscription(const QByteArray &topic, bool subscribe);
+    
+    // 接收socket的监视器（PAIR），由工作线程读取连接事件并维护连通服务器数，需在线程启动前设置
+    void setMonitor(void *monitor_socket, std::atomic<int> *connected_servers);
     
 public slots:
     void run();
 
 signals:
     void messageReceived(const QString &msg);
+    void alarmReceived(const AlarmEvent &alarm);
     void errorOccurred(const QString &error_msg);
+    void connectionStateChanged(int connected_servers);
 
 private:
+    // 返回的各帧直接引用zmq的接收缓冲区，在下一次接收前有效
+    bool waitForMessage();
+    void handleMonitorEvents();
+    int receiveParts(QVector<QByteArray> &parts);
+    void applyPendingSubscriptions();
+    void handleAlarm(const QVector<QByteArray> &parts, int count);
+    void flushSuppressionSummaries();
+    bool isDuplicateAlarm(const QString &alarm_id);
+    
     void *m_socket;
     QString m_socket_name;
     std::atomic<bool> &m_running;
+    bool m_parse_alarms;
+    ZmqCounters *m_counters;
+    AlarmRateLimiter *m_rate_limiter;
+    
+    QVector<zmq_msg_t *> m_frames;   // 复用的接收帧
+    
+    void *m_monitor;
+    std::atomic<int> *m_connected_servers;
+    QSet<QString> m_connected_endpoints;
+    
+    QMutex m_subscription_mutex;
+    QVector<QPair<QByteArray, bool> > m_pending_subscriptions;
+    
+    QMutex m_rules_mutex;
+    QSharedPointer<const AlarmRuleSet> m_rules;
+    
+    // 最近处理过的报警ID，用于多服务器去重
+    QSet<QString> m_recent_alarm_ids;
+    QQueue<QString> m_recent_alarm_order;
+    static const int RECENT_ALARM_IDS = 8192;
 };
 
 #endif // MSGCLIENT_H
@@ -0,0 +1,156 @@
+#include "packetring.h"
+#include <QMutexLocker>
+
+extern "C"
+{
+    #include "libavcodec/avcodec.h"
+}
+
+PacketClip::~PacketClip()
+{
+    for (AVPacket *packet : packets) {
+        av_packet_free(&packet);
+    }
+    avcodec_parameters_free(&codecpar);
+}
+
+PacketRing::PacketRing(qint64 durationMs, qint64 maxBytes)
+    : m_codecpar(nullptr)
+    , m_timeBase({1, 90000})
+    , m_bytes(0)
+    , m_durationMs(durationMs)
+    , m_maxBytes(maxBytes)
+{
+}
+
+PacketRing::~PacketRing()
+{
+    clearLocked();
+    avcodec_parameters_free(&m_codecpar);
+}
+
+void PacketRing::streamOpened(const AVCodecParameters *codecpar, AVRational timeBase)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // 重新打开的流参数可能不同，旧包不能再和新包拼在一起
+    clearLocked();
+    if (!m_codecpar) {
+        m_codecpar = avcodec_parameters_alloc();
+    }
+    avcodec_parameters_copy(m_codecpar, codecpar);
+    m_timeBase = timeBase;
+}
+
+void PacketRing::packetReceived(const AVPacket *packet, qint64 wallMs)
+{
+    bool key = packet->flags & AV_PKT_FLAG_KEY;
+
+    QMutexLocker locker(&m_mutex);
+
+    // 缓冲区必须从关键帧开始
+    if (m_entries.isEmpty() && !key) {
+        return;
+    }
+
+    AVPacket *ref = av_packet_clone(packet);
+    if (!ref) {
+        return;
+    }
+    m_entries.enqueue({ref, wallMs, key});
+    m_bytes += ref->size;
+
+    // 第二个GOP的起点已经早于保留时长时，第一个GOP整体不再需要
+    forever {
+        int second = nextKeyIndex(1);
+        if (second < 0) {
+            break;
+        }
+        bool expired = m_entries.at(second).wallMs <= wallMs - m_durationMs;
+        if (!expired && m_bytes <= m_maxBytes) {
+            break;
+        }
+        dropFrontGop();
+    }
+}
+
+int PacketRing::nextKeyIndex(int from) const
+{
+    for (int i = from; i < m_entries.size(); ++i) {
+        if (m_entries.at(i).key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void PacketRing::dropFrontGop()
+{
+    do {
+        Entry entry = m_entries.dequeue();
+        m_bytes -= entry.packet->size;
+        av_packet_free(&entry.packet);
+    } while (!m_entries.isEmpty() && !m_entries.head().key);
+}
+
+QSharedPointer<PacketClip> PacketRing::extract(qint64 fromWallMs) const
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_entries.isEmpty() || !m_codecpar) {
+        return QSharedPointer<PacketClip>();
+    }
+
+    // 找到fromWallMs之前最近的关键帧，不够早时从最旧的关键帧开始
+    int start = 0;
+    for (int i = 0; i < m_entries.size(); ++i) {
+        const Entry &entry = m_entries.at(i);
+        if (entry.wallMs > fromWallMs) {
+            break;
+        }
+        if (entry.key) {
+            start = i;
+        }
+    }
+
+    QSharedPointer<PacketClip> clip(new PacketClip());
+    clip->codecpar = avcodec_parameters_alloc();
+    avcodec_parameters_copy(clip->codecpar, m_codecpar);
+    clip->timeBase = m_timeBase;
+    clip->packets.reserve(m_entries.size() - start);
+    clip->wallMs.reserve(m_entries.size() - start);
+    for (int i = start; i < m_entries.size(); ++i) {
+        AVPacket *ref = av_packet_clone(m_entries.at(i).packet);
+        if (ref) {
+            clip->packets.append(ref);
+            clip->wallMs.append(m_entries.at(i).wallMs);
+        }
+    }
+    return clip;
+}
+
+qint64 PacketRing::bytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytes;
+}
+
+qint64 PacketRing::bufferedMs() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.isEmpty() ? 0 : m_entries.last().wallMs - m_entries.head().wallMs;
+}
+
+void PacketRing::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    clearLocked();
+}
+
+void PacketRing::clearLocked()
+{
+    while (!m_entries.isEmpty()) {
+        Entry entry = m_entries.dequeue();
+        av_packet_free(&entry.packet);
+    }
+    m_bytes = 0;
+}
@@ -0,0 +1,65 @@
+#ifndef PACKETRING_H
+#define PACKETRING_H
+
+#include <QMutex>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QVector>
+#include "packetsink.h"
+
+// 从环形缓冲中取出的一段包，持有各包的引用，析构时释放
+struct PacketClip
+{
+    PacketClip() {}
+    ~PacketClip();
+
+    AVCodecParameters *codecpar = nullptr;
+    AVRational timeBase = {1, 90000};
+    QVector<AVPacket *> packets;    // 第一个包总是关键帧
+    QVector<qint64> wallMs;
+
+private:
+    Q_DISABLE_COPY(PacketClip)
+};
+
+// 报警前的压缩包环形缓冲
+// 只保存包的引用，按GOP整体淘汰，缓冲区总是从关键帧开始，取出的片段可以直接转封装。
+// 保留时长至少为durationMs，总字节数超过maxBytes时提前淘汰最旧的GOP（至少保留当前GOP）。
+class PacketRing : public PacketSink
+{
+public:
+    PacketRing(qint64 durationMs, qint64 maxBytes);
+    ~PacketRing();
+
+    void streamOpened(const AVCodecParameters *codecpar, AVRational timeBase) override;
+    void packetReceived(const AVPacket *packet, qint64 wallMs) override;
+
+    // 取出从fromWallMs之前最近的关键帧开始的全部包，缓冲区为空时返回空指针
+    QSharedPointer<PacketClip> extract(qint64 fromWallMs) const;
+
+    qint64 bytes() const;
+    qint64 bufferedMs() const;
+    void clear();
+
+private:
+    struct Entry
+    {
+        AVPacket *packet;
+        qint64 wallMs;
+        bool key;
+    };
+
+    void clearLocked();
+    void dropFrontGop();
+    int nextKeyIndex(int from) const;
+
+    mutable QMutex m_mutex;
+    QQueue<Entry> m_entries;
+    AVCodecParameters *m_codecpar;
+    AVRational m_timeBase;
+    qint64 m_bytes;
+    qint64 m_durationMs;
+    qint64 m_maxBytes;
+};
+
+#endif // PACKETRING_H
@@ -0,0 +1,27 @@
+#ifndef PACKETSINK_H
+#define PACKETSINK_H
+
+#include <QtGlobal>
+
+extern "C"
+{
+    #include "libavutil/rational.h"
+}
+
+struct AVPacket;
+struct AVCodecParameters;
+
+// 压缩包的旁路接收者
+// StreamPlayer在解复用线程上把视频流的每个包交给已注册的接收者，不解码也不拷贝数据。
+// 回调中不得阻塞；需要保留包时自行增加引用（av_packet_clone）。wallMs为包到达时的本机时间。
+class PacketSink
+{
+public:
+    virtual ~PacketSink() {}
+
+    virtual void streamOpened(const AVCodecParameters *codecpar, AVRational timeBase) = 0;
+    virtual void packetReceived(const AVPacket *packet, qint64 wallMs) = 0;
+    virtual void streamClosed() {}
+};
+
+#endif // PACKETSINK_H
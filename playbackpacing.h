@@ -0,0 +1,8 @@
+#ifndef PLAYBACKPACING_H
+#define PLAYBACKPACING_H
+
+// 录像回放和即时回看的播放节奏
+// 相邻两帧按本机时间差等待，断流或录像中断处的时间跳跃最多只等这么久
+const int MAX_FRAME_DELAY_MS = 200;
+
+#endif // PLAYBACKPACING_H
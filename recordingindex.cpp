@@ -0,0 +1,327 @@
+#include "recordingindex.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QDebug>
+#include <algorithm>
+
+extern "C"
+{
+    #include "libavformat/avformat.h"
+    #include "libavutil/mem.h"
+}
+
+namespace {
+
+const int IO_BUFFER_SIZE = 64 * 1024;
+
+}
+
+RecordingIndex::RecordingIndex(const QString &streamDir)
+    : m_streamDir(streamDir)
+    , m_entries(nullptr)
+    , m_count(0)
+{
+}
+
+RecordingIndex::~RecordingIndex()
+{
+    close();
+    unmap();
+}
+
+QString RecordingIndex::segmentPath(const QString &streamDir, qint64 segmentStartMs, int suffix)
+{
+    QString name = QDateTime::fromMSecsSinceEpoch(segmentStartMs).toString("yyyyMMdd/hhmmss");
+    if (suffix > 0) {
+        name += QString("_%1").arg(suffix);
+    }
+    return QDir(streamDir).filePath(name + ".mp4");
+}
+
+QString RecordingIndex::indexPath(const QString &streamDir, qint64 wallMs)
+{
+    return QDir(streamDir).filePath(QDateTime::fromMSecsSinceEpoch(wallMs).toString("yyyyMMdd") + "/index.idx");
+}
+
+bool RecordingIndex::append(const RecordingIndexEntry &entry)
+{
+    // 按关键帧时间归入当天的索引，跨零点的分段在两天的索引中都有项
+    QString path = indexPath(m_streamDir, entry.wallMs);
+    if (m_writeFile.fileName() != path || !m_writeFile.isOpen()) {
+        m_writeFile.close();
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        m_writeFile.setFileName(path);
+        if (!m_writeFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            qWarning() << "无法打开录像索引:" << path << m_writeFile.errorString();
+            return false;
+        }
+        // 异常退出时可能留下半项，对齐到整项再追加
+        qint64 aligned = m_writeFile.size() / qint64(sizeof(RecordingIndexEntry)) * qint64(sizeof(RecordingIndexEntry));
+        if (aligned != m_writeFile.size()) {
+            m_writeFile.resize(aligned);
+            m_writeFile.seek(aligned);
+        }
+    }
+
+    qint64 written = m_writeFile.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+    // 每个GOP一项，直接交给系统缓存，查询方即可看到
+    m_writeFile.flush();
+    return written == qint64(sizeof(entry));
+}
+
+void RecordingIndex::close()
+{
+    m_writeFile.close();
+}
+
+bool RecordingIndex::mapDay(qint64 wallMs)
+{
+    QString path = indexPath(m_streamDir, wallMs);
+    qint64 count = QFileInfo(path).size() / qint64(sizeof(RecordingIndexEntry));
+    if (m_mapFile.fileName() == path && m_mapFile.isOpen() && count == m_count) {
+        return m_count > 0;
+    }
+
+    unmap();
+    m_mapFile.setFileName(path);
+    if (count == 0 || !m_mapFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    uchar *data = m_mapFile.map(0, count * qint64(sizeof(RecordingIndexEntry)));
+    if (!data) {
+        qWarning() << "无法映射录像索引:" << path;
+        unmap();
+        return false;
+    }
+    m_entries = reinterpret_cast<const RecordingIndexEntry *>(data);
+    m_count = count;
+    return true;
+}
+
+void RecordingIndex::unmap()
+{
+    if (m_mapFile.isOpen()) {
+        m_mapFile.close(); // close会同时解除映射
+    }
+    m_entries = nullptr;
+    m_count = 0;
+}
+
+bool RecordingIndex::segmentExists(qint64 i) const
+{
+    return QFile::exists(segmentPath(m_streamDir, m_entries[i].segmentStartMs, m_entries[i].suffix));
+}
+
+qint64 RecordingIndex::segmentBegin(qint64 i) const
+{
+    const RecordingIndexEntry &entry = m_entries[i];
+    while (i > 0 && m_entries[i - 1].segmentStartMs == entry.segmentStartMs
+           && m_entries[i - 1].suffix == entry.suffix) {
+        --i;
+    }
+    return i;
+}
+
+qint64 RecordingIndex::segmentEnd(qint64 i) const
+{
+    const RecordingIndexEntry &entry = m_entries[i];
+    while (i < m_count && m_entries[i].segmentStartMs == entry.segmentStartMs
+           && m_entries[i].suffix == entry.suffix) {
+        ++i;
+    }
+    return i;
+}
+
+qint64 RecordingIndex::existingBefore(qint64 i) const
+{
+    while (i >= 0 && !segmentExists(i)) {
+        i = segmentBegin(i) - 1;
+    }
+    return i;
+}
+
+qint64 RecordingIndex::existingFrom(qint64 i) const
+{
+    while (i < m_count && !segmentExists(i)) {
+        i = segmentEnd(i);
+    }
+    return i;
+}
+
+bool RecordingIndex::find(qint64 wallMs, RecordingPosition *position)
+{
+    qint64 i = -1;
+    if (mapDay(wallMs)) {
+        const RecordingIndexEntry *end = m_entries + m_count;
+        const RecordingIndexEntry *it = std::upper_bound(m_entries, end, wallMs,
+            [](qint64 value, const RecordingIndexEntry &e) { return value < e.wallMs; });
+        i = existingBefore(qint64(it - m_entries) - 1);
+    }
+    // 当天第一个关键帧之前，取前一天的最后一项；分段已删除时继续往前，直到某天没有索引
+    QDate day = QDateTime::fromMSecsSinceEpoch(wallMs).date();
+    while (i < 0) {
+        qint64 dayStart = day.startOfDay().toMSecsSinceEpoch();
+        if (!mapDay(dayStart - 1)) {
+            return false;
+        }
+        i = existingBefore(m_count - 1);
+        day = day.addDays(-1);
+    }
+
+    fillPosition(m_entries + i, position);
+    return true;
+}
+
+bool RecordingIndex::findNext(qint64 wallMs, RecordingPosition *position)
+{
+    qint64 i = -1;
+    if (mapDay(wallMs)) {
+        const RecordingIndexEntry *end = m_entries + m_count;
+        const RecordingIndexEntry *it = std::upper_bound(m_entries, end, wallMs,
+            [](qint64 value, const RecordingIndexEntry &e) { return value < e.wallMs; });
+        i = existingFrom(qint64(it - m_entries));
+        if (i == m_count) {
+            i = -1;
+        }
+    }
+    // 当天最后一个关键帧之后，取后一天的第一项；分段已删除时继续往后，直到某天没有索引
+    QDate day = QDateTime::fromMSecsSinceEpoch(wallMs).date();
+    while (i < 0) {
+        day = day.addDays(1);
+        if (!mapDay(day.startOfDay().toMSecsSinceEpoch())) {
+            return false;
+        }
+        i = existingFrom(0);
+        if (i == m_count) {
+            i = -1;
+        }
+    }
+
+    fillPosition(m_entries + i, position);
+    return true;
+}
+
+QVector<RecordingPosition> RecordingIndex::keyframes(qint64 fromMs, qint64 toMs, qint64 minIntervalMs)
+{
+    QVector<RecordingPosition> positions;
+    qint64 lastMs = 0;
+    QDate day = QDateTime::fromMSecsSinceEpoch(fromMs).date();
+    QDate lastDay = QDateTime::fromMSecsSinceEpoch(toMs).date();
+    for (; day <= lastDay; day = day.addDays(1)) {
+        if (!mapDay(day.startOfDay().toMSecsSinceEpoch())) {
+            continue;
+        }
+        const RecordingIndexEntry *begin = std::lower_bound(m_entries, m_entries + m_count, fromMs,
+            [](const RecordingIndexEntry &e, qint64 value) { return e.wallMs < value; });
+        qint64 i = existingFrom(qint64(begin - m_entries));
+        while (i < m_count && m_entries[i].wallMs <= toMs) {
+            qint64 segmentLast = segmentEnd(i);
+            for (; i < segmentLast && m_entries[i].wallMs <= toMs; ++i) {
+                if (!positions.isEmpty() && m_entries[i].wallMs - lastMs < minIntervalMs) {
+                    continue;
+                }
+                RecordingPosition position;
+                fillPosition(m_entries + i, &position);
+                positions.append(position);
+                lastMs = m_entries[i].wallMs;
+            }
+            i = existingFrom(i);
+        }
+    }
+    return positions;
+}
+
+void RecordingIndex::fillPosition(const RecordingIndexEntry *entry, RecordingPosition *position) const
+{
+    position->path = segmentPath(m_streamDir, entry->segmentStartMs, entry->suffix);
+    position->offset = entry->offset;
+    position->initBytes = entry->initBytes;
+    position->keyframeWallMs = entry->wallMs;
+    position->ptsMs = entry->ptsMs;
+}
+
+RecordingInput::RecordingInput()
+    : m_input(nullptr)
+    , m_io(nullptr)
+    , m_initBytes(0)
+    , m_offset(0)
+    , m_pos(0)
+{
+}
+
+RecordingInput::~RecordingInput()
+{
+    close();
+}
+
+int RecordingInput::readCallback(void *opaque, uint8_t *buf, int size)
+{
+    RecordingInput *input = static_cast<RecordingInput *>(opaque);
+    qint64 filePos;
+    qint64 limit = size;
+    if (input->m_pos < input->m_initBytes) {
+        filePos = input->m_pos;
+        limit = qMin(limit, input->m_initBytes - input->m_pos);
+    } else {
+        filePos = input->m_offset + (input->m_pos - input->m_initBytes);
+    }
+    if (!input->m_file.seek(filePos)) {
+        return AVERROR_EOF;
+    }
+    qint64 n = input->m_file.read(reinterpret_cast<char *>(buf), limit);
+    if (n <= 0) {
+        return AVERROR_EOF;
+    }
+    input->m_pos += n;
+    return int(n);
+}
+
+bool RecordingInput::open(const RecordingPosition &position)
+{
+    close();
+
+    m_file.setFileName(position.path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "无法打开录像分段:" << position.path;
+        return false;
+    }
+    m_initBytes = position.initBytes;
+    m_offset = position.offset;
+    m_pos = 0;
+
+    // 拼接后的输入不可随机访问，解复用器按顺序读取，也不会去找文件末尾的mfra
+    uint8_t *buffer = static_cast<uint8_t *>(av_malloc(IO_BUFFER_SIZE));
+    m_io = avio_alloc_context(buffer, IO_BUFFER_SIZE, 0, this, &RecordingInput::readCallback, nullptr, nullptr);
+    m_input = avformat_alloc_context();
+    if (!m_io || !m_input) {
+        if (!m_io) {
+            av_free(buffer);
+        }
+        close();
+        return false;
+    }
+    m_input->pb = m_io;
+    m_input->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+    // 失败时avformat_open_input会释放m_input
+    if (avformat_open_input(&m_input, nullptr, av_find_input_format("mp4"), nullptr) < 0
+        || avformat_find_stream_info(m_input, nullptr) < 0) {
+        qWarning() << "无法解析录像分段:" << position.path << "偏移:" << position.offset;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void RecordingInput::close()
+{
+    if (m_input) {
+        avformat_close_input(&m_input);
+    }
+    if (m_io) {
+        av_freep(&m_io->buffer);
+        avio_context_free(&m_io);
+    }
+    m_file.close();
+}
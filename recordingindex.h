@@ -0,0 +1,106 @@
+#ifndef RECORDINGINDEX_H
+#define RECORDINGINDEX_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+struct AVFormatContext;
+struct AVIOContext;
+
+// 录像索引项，按本机字节序直接映射
+// 每个关键帧一项，关键帧即分片的开头；只有分片完整写入后才追加对应的项。
+struct RecordingIndexEntry
+{
+    qint64 wallMs;          // 关键帧到达的本机时间
+    qint64 segmentStartMs;  // 所在分段的开始时间，决定分段文件名
+    qint64 offset;          // 该分片在分段文件中的字节偏移
+    qint64 ptsMs;           // 关键帧在分段内的时间
+    quint32 initBytes;      // 分段开头ftyp+moov的长度
+    quint16 suffix;         // 同一秒内的第几个分段，0表示没有后缀
+    quint16 reserved;
+};
+
+// 定位结果
+struct RecordingPosition
+{
+    QString path;           // 分段文件
+    qint64 offset = 0;
+    qint64 initBytes = 0;
+    qint64 keyframeWallMs = 0;
+    qint64 ptsMs = 0;
+};
+
+// 录像的按日索引：<流目录>/yyyyMMdd/index.idx
+// 由SegmentRecorder在录像线程上追加，查询时内存映射后按时间二分查找，不打开分段文件。
+class RecordingIndex
+{
+public:
+    explicit RecordingIndex(const QString &streamDir);
+    ~RecordingIndex();
+
+    static QString segmentPath(const QString &streamDir, qint64 segmentStartMs, int suffix);
+    static QString indexPath(const QString &streamDir, qint64 wallMs);
+
+    // 追加一项，写入当天的索引文件
+    bool append(const RecordingIndexEntry &entry);
+    void close();
+
+    // 查询都跳过分段文件已不存在（被录像配额删除）的项
+    // 取wallMs之前（含）最近的关键帧，当天没有时往前一天找
+    bool find(qint64 wallMs, RecordingPosition *position);
+    // 取wallMs之后最近的关键帧，当天没有时往后一天找
+    bool findNext(qint64 wallMs, RecordingPosition *position);
+    // [fromMs, toMs]内的关键帧，相邻两个至少间隔minIntervalMs
+    QVector<RecordingPosition> keyframes(qint64 fromMs, qint64 toMs, qint64 minIntervalMs);
+
+private:
+    bool mapDay(qint64 wallMs);
+    void fillPosition(const RecordingIndexEntry *entry, RecordingPosition *position) const;
+    // 以下在当前映射中按下标查找，同一分段的项相邻，每个分段只检查一次文件
+    bool segmentExists(qint64 i) const;
+    qint64 segmentBegin(qint64 i) const;
+    qint64 segmentEnd(qint64 i) const;
+    // i之前（含）第一个分段仍存在的项，没有时返回-1
+    qint64 existingBefore(qint64 i) const;
+    // i之后（含）第一个分段仍存在的项，没有时返回m_count
+    qint64 existingFrom(qint64 i) const;
+    void unmap();
+
+    QString m_streamDir;
+
+    // 写入的索引文件
+    QFile m_writeFile;
+
+    // 查询映射的索引文件，文件增长后重新映射
+    QFile m_mapFile;
+    const RecordingIndexEntry *m_entries;
+    qint64 m_count;
+};
+
+// 从索引定位的关键帧打开分段
+// 把分段开头的ftyp+moov与关键帧所在分片之后的内容拼成一路顺序输入交给解复用器，
+// 第一个读出的包就是该关键帧，不需要从分段开头读起。
+class RecordingInput
+{
+public:
+    RecordingInput();
+    ~RecordingInput();
+
+    bool open(const RecordingPosition &position);
+    void close();
+
+    AVFormatContext *context() const { return m_input; }
+
+private:
+    static int readCallback(void *opaque, uint8_t *buf, int size);
+
+    QFile m_file;
+    AVFormatContext *m_input;
+    AVIOContext *m_io;
+    qint64 m_initBytes;
+    qint64 m_offset;
+    qint64 m_pos;           // 拼接后的逻辑位置
+};
+
+#endif // RECORDINGINDEX_H
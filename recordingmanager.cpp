@@ -0,0 +1,106 @@
+#include "recordingmanager.h"
+#include "segmentrecorder.h"
+#include "streamhub.h"
+#include "streamPlayer.h"
+#include <QDir>
+#include <QRegExp>
+#include <QDebug>
+
+RecordingManager::RecordingManager(StreamHub *hub, const QString &rootDir, QObject *parent)
+    : QObject(parent)
+    , m_hub(hub)
+    , m_rootDir(rootDir)
+    , m_segmentSeconds(300)
+    , m_preallocBytes(0)
+    , m_queueLimit(32 * 1024 * 1024)
+    , m_quotaBytes(0)
+{
+}
+
+RecordingManager::~RecordingManager()
+{
+    for (auto it = m_recordings.begin(); it != m_recordings.end(); ++it) {
+        // 先摘下再停止，停止后不会再有回调
+        if (m_hub) {
+            it->player->removePacketSink(it->recorder);
+        }
+        it->recorder->stop();
+        it->recorder->wait();
+        if (m_hub) {
+            m_hub->release(it->player, false);
+        }
+        delete it->recorder;
+    }
+}
+
+void RecordingManager::start()
+{
+    if (m_targets.isEmpty()) {
+        return;
+    }
+    m_quota.reset(new RecordingQuota(m_rootDir, m_quotaBytes));
+    for (const QString &target : m_targets) {
+        if (target.contains("://")) {
+            startRecording(target, target);
+        }
+    }
+}
+
+void RecordingManager::onStreamAdded(const QString &id, const QString &name, const QString &url)
+{
+    Q_UNUSED(name);
+    if (m_quota && !id.isEmpty() && m_targets.contains(id)) {
+        startRecording(id, url);
+    }
+}
+
+QString RecordingManager::dirForKey(const QString &key) const
+{
+    // 流ID或URL作为子目录名
+    QString dirName = key;
+    dirName.replace(QRegExp("[\\\\/:*?\"<>|\\s@]+"), "_");
+    return QDir(m_rootDir).filePath(dirName);
+}
+
+QString RecordingManager::streamDir(const QString &id, const QString &url) const
+{
+    if (!id.isEmpty() && m_targets.contains(id)) {
+        return dirForKey(id);
+    }
+    if (m_targets.contains(url)) {
+        return dirForKey(url);
+    }
+    return QString();
+}
+
+QList<QPair<QString, QString> > RecordingManager::recordedStreams() const
+{
+    QList<QPair<QString, QString> > streams;
+    for (const QString &target : m_targets) {
+        streams.append(qMakePair(target, dirForKey(target)));
+    }
+    return streams;
+}
+
+void RecordingManager::startRecording(const QString &key, const QString &url)
+{
+    if (!m_hub || m_recordings.contains(url)) {
+        return;
+    }
+
+    Recording recording;
+    recording.recorder = new SegmentRecorder(dirForKey(key));
+    recording.recorder->setSegmentSeconds(m_segmentSeconds);
+    recording.recorder->setPreallocBytes(m_preallocBytes);
+    recording.recorder->setQueueLimit(m_queueLimit);
+    recording.recorder->setQuota(m_quota.data());
+    connect(recording.recorder, &SegmentRecorder::errorOccurred, this, [](const QString &error_msg) {
+        qWarning() << "录像错误:" << error_msg;
+    });
+    recording.recorder->start();
+
+    recording.player = m_hub->acquire(url, key, false);
+    recording.player->addPacketSink(recording.recorder);
+    m_recordings.insert(url, recording);
+    qDebug() << "开始录像:" << key << "目录:" << recording.recorder->dir();
+}
@@ -0,0 +1,66 @@
+#ifndef RECORDINGMANAGER_H
+#define RECORDINGMANAGER_H
+
+#include <QObject>
+#include <QHash>
+#include <QPair>
+#include <QPointer>
+#include <QScopedPointer>
+#include <QStringList>
+
+class StreamHub;
+class StreamPlayer;
+class SegmentRecorder;
+class RecordingQuota;
+
+// 选定流的连续录像
+// 录像的播放器从StreamHub取得且不解码，与观看共用同一路连接；每路流一个SegmentRecorder。
+// 录像目标可以是流ID或URL：URL在start()时直接开始，流ID等列表中出现该流时开始。只在GUI线程中使用。
+class RecordingManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    RecordingManager(StreamHub *hub, const QString &rootDir, QObject *parent = nullptr);
+    ~RecordingManager();
+
+    // 以下设置需在start()之前调用
+    void setTargets(const QStringList &targets) { m_targets = targets; }
+    void setSegmentSeconds(int seconds) { m_segmentSeconds = seconds; }
+    void setPreallocBytes(qint64 bytes) { m_preallocBytes = bytes; }
+    void setQueueLimit(qint64 bytes) { m_queueLimit = bytes; }
+    void setQuotaBytes(qint64 bytes) { m_quotaBytes = bytes; }
+
+    void start();
+    int recordingCount() const { return m_recordings.size(); }
+    
+    // 流在录像目标中时返回其录像目录，否则返回空
+    QString streamDir(const QString &id, const QString &url) const;
+    // 全部录像目标的(流ID或URL, 录像目录)
+    QList<QPair<QString, QString> > recordedStreams() const;
+
+public slots:
+    void onStreamAdded(const QString &id, const QString &name, const QString &url);
+
+private:
+    struct Recording
+    {
+        StreamPlayer *player = nullptr;
+        SegmentRecorder *recorder = nullptr;
+    };
+
+    void startRecording(const QString &key, const QString &url);
+    QString dirForKey(const QString &key) const;
+
+    QPointer<StreamHub> m_hub;
+    QString m_rootDir;
+    QStringList m_targets;
+    int m_segmentSeconds;
+    qint64 m_preallocBytes;
+    qint64 m_queueLimit;
+    qint64 m_quotaBytes;
+    QScopedPointer<RecordingQuota> m_quota;
+    QHash<QString, Recording> m_recordings;     // URL -> 录像
+};
+
+#endif // RECORDINGMANAGER_H
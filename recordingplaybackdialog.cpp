@@ -0,0 +1,224 @@
+#include "recordingplaybackdialog.h"
+#include "recordingplayer.h"
+#include "timelapsejob.h"
+#include <QDateTime>
+#include <QDir>
+#include <QPixmap>
+#include <QDebug>
+
+RecordingPlaybackDialog::RecordingPlaybackDialog(const QString &title, const QString &streamDir, qint64 cacheBytes,
+                                                 QWidget *parent)
+    : QDialog(parent)
+    , m_player(new RecordingPlayer(streamDir, cacheBytes, this))
+    , m_streamDir(streamDir)
+    , m_timelapseJob(nullptr)
+    , m_timelapseIntervalSeconds(60)
+    , m_timelapseThumbWidth(160)
+    , m_timelapseColumns(20)
+    , m_timelapseCpuBudget(1.0)
+    , m_timelapseFps(25)
+{
+    setupUI();
+    applyStyles();
+
+    // 缓存按显示尺寸保存画面
+    m_player->setFrameSize(QSize(VIDEO_WIDTH, VIDEO_HEIGHT));
+    connect(m_player, &RecordingPlayer::frameReady, this, &RecordingPlaybackDialog::onFrameReady);
+    connect(m_player, &RecordingPlayer::positionUnavailable, this, &RecordingPlaybackDialog::onPositionUnavailable);
+    connect(m_player, &RecordingPlayer::reachedEnd, this, [this]() {
+        m_statusLabel->setText("已到录像尽头");
+    });
+    m_player->start();
+
+    setWindowTitle(QString("录像回放 - %1").arg(title));
+    resize(VIDEO_WIDTH + 40, VIDEO_HEIGHT + 160);
+}
+
+RecordingPlaybackDialog::~RecordingPlaybackDialog()
+{
+    if (m_timelapseJob) {
+        m_timelapseJob->cancel();
+        m_timelapseJob->wait();
+    }
+    m_player->stop();
+    m_player->wait();
+}
+
+void RecordingPlaybackDialog::setupUI()
+{
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(20, 20, 20, 20);
+    mainLayout->setSpacing(10);
+
+    // 定位时间，默认一分钟前
+    QHBoxLayout *seekLayout = new QHBoxLayout();
+    seekLayout->setSpacing(10);
+    m_timeEdit = new QDateTimeEdit(QDateTime::currentDateTime().addSecs(-60), this);
+    m_timeEdit->setDisplayFormat("yyyy-MM-dd hh:mm:ss");
+    m_timeEdit->setCalendarPopup(true);
+    m_seekButton = new QPushButton("定位", this);
+    m_seekButton->setFixedSize(80, 32);
+    connect(m_seekButton, &QPushButton::clicked, this, &RecordingPlaybackDialog::onSeekClicked);
+    m_timelapseButton = new QPushButton("生成缩略图/延时", this);
+    m_timelapseButton->setFixedHeight(32);
+    connect(m_timelapseButton, &QPushButton::clicked, this, &RecordingPlaybackDialog::onTimelapseClicked);
+    seekLayout->addWidget(m_timeEdit, 1);
+    seekLayout->addWidget(m_seekButton);
+    seekLayout->addWidget(m_timelapseButton);
+    mainLayout->addLayout(seekLayout);
+
+    m_videoLabel = new QLabel(this);
+    m_videoLabel->setFixedSize(VIDEO_WIDTH, VIDEO_HEIGHT);
+    m_videoLabel->setAlignment(Qt::AlignCenter);
+    m_videoLabel->setText("选择时间后点击定位");
+    mainLayout->addWidget(m_videoLabel, 0, Qt::AlignHCenter);
+
+    // 播放控制
+    QHBoxLayout *controlLayout = new QHBoxLayout();
+    controlLayout->setSpacing(10);
+    m_reverseButton = new QPushButton("◀◀ 倒放", this);
+    m_stepBackButton = new QPushButton("◀| 上一帧", this);
+    m_pauseButton = new QPushButton("暂停", this);
+    m_stepForwardButton = new QPushButton("|▶ 下一帧", this);
+    m_playButton = new QPushButton("▶ 播放", this);
+    m_speedCombo = new QComboBox(this);
+    m_speedCombo->addItem("0.25x", 0.25);
+    m_speedCombo->addItem("0.5x", 0.5);
+    m_speedCombo->addItem("1x", 1.0);
+    m_speedCombo->addItem("2x", 2.0);
+    m_speedCombo->addItem("4x", 4.0);
+    m_speedCombo->setCurrentIndex(2);
+
+    for (QPushButton *button : {m_reverseButton, m_stepBackButton, m_pauseButton, m_stepForwardButton, m_playButton}) {
+        button->setFixedHeight(32);
+        controlLayout->addWidget(button);
+    }
+    controlLayout->addWidget(m_speedCombo);
+
+    connect(m_reverseButton, &QPushButton::clicked, this, [this]() {
+        m_player->play(-selectedSpeed());
+    });
+    connect(m_stepBackButton, &QPushButton::clicked, this, [this]() {
+        m_player->step(-1);
+    });
+    connect(m_pauseButton, &QPushButton::clicked, this, [this]() {
+        m_player->pause();
+    });
+    connect(m_stepForwardButton, &QPushButton::clicked, this, [this]() {
+        m_player->step(1);
+    });
+    connect(m_playButton, &QPushButton::clicked, this, [this]() {
+        m_player->play(selectedSpeed());
+    });
+    mainLayout->addLayout(controlLayout);
+
+    m_statusLabel = new QLabel(this);
+    mainLayout->addWidget(m_statusLabel);
+}
+
+void RecordingPlaybackDialog::applyStyles()
+{
+    setStyleSheet(R"(
+        QDialog {
+            background-color: #1e1e1e;
+            color: #ffffff;
+        }
+        QLabel {
+            color: #ffffff;
+        }
+        QDateTimeEdit, QComboBox {
+            background-color: #2d2d2d;
+            border: 1px solid #3d3d3d;
+            border-radius: 4px;
+            color: #ffffff;
+            padding: 4px;
+        }
+        QPushButton {
+            background-color: #3d3d3d;
+            border: 1px solid #4d4d4d;
+            border-radius: 6px;
+            color: #ffffff;
+            font-weight: bold;
+            padding: 4px 12px;
+        }
+        QPushButton:hover {
+            background-color: #4d4d4d;
+        }
+    )");
+    m_videoLabel->setStyleSheet(R"(
+        QLabel {
+            background-color: #000000;
+            border: 2px solid #3d3d3d;
+            border-radius: 8px;
+        }
+    )");
+}
+
+double RecordingPlaybackDialog::selectedSpeed() const
+{
+    return m_speedCombo->currentData().toDouble();
+}
+
+void RecordingPlaybackDialog::setTimelapseOptions(int intervalSeconds, int thumbWidth, int columns, double cpuBudget,
+                                                  int fps)
+{
+    m_timelapseIntervalSeconds = intervalSeconds;
+    m_timelapseThumbWidth = thumbWidth;
+    m_timelapseColumns = columns;
+    m_timelapseCpuBudget = cpuBudget;
+    m_timelapseFps = fps;
+}
+
+void RecordingPlaybackDialog::onTimelapseClicked()
+{
+    if (m_timelapseJob) {
+        return;
+    }
+    
+    // 所选时间当天的全部录像，输出放在当天的录像目录下
+    QDate day = m_timeEdit->dateTime().date();
+    qint64 fromMs = day.startOfDay().toMSecsSinceEpoch();
+    qint64 toMs = qMin(day.addDays(1).startOfDay().toMSecsSinceEpoch() - 1, QDateTime::currentMSecsSinceEpoch());
+    QString dayDir = QDir(m_streamDir).filePath(day.toString("yyyyMMdd"));
+    
+    m_timelapseJob = new TimelapseJob(m_streamDir, fromMs, toMs, this);
+    m_timelapseJob->setInterval(qint64(m_timelapseIntervalSeconds) * 1000);
+    m_timelapseJob->setThumbnailWidth(m_timelapseThumbWidth);
+    m_timelapseJob->setColumns(m_timelapseColumns);
+    m_timelapseJob->setCpuBudget(m_timelapseCpuBudget);
+    m_timelapseJob->setFps(m_timelapseFps);
+    m_timelapseJob->setOutputs(dayDir + "/sprite.jpg", dayDir + "/timelapse.mp4");
+    connect(m_timelapseJob, &TimelapseJob::progress, this, [this](int done, int total) {
+        m_statusLabel->setText(QString("生成缩略图/延时: %1/%2").arg(done).arg(total));
+    });
+    connect(m_timelapseJob, &TimelapseJob::jobFinished, this, [this](bool ok, const QString &message) {
+        m_statusLabel->setText(ok ? QString("已生成: %1").arg(message) : message);
+    });
+    connect(m_timelapseJob, &QThread::finished, this, [this]() {
+        m_timelapseJob->deleteLater();
+        m_timelapseJob = nullptr;
+        m_timelapseButton->setEnabled(true);
+    });
+    m_timelapseButton->setEnabled(false);
+    m_timelapseJob->start();
+}
+
+void RecordingPlaybackDialog::onSeekClicked()
+{
+    m_player->seek(m_timeEdit->dateTime().toMSecsSinceEpoch());
+}
+
+void RecordingPlaybackDialog::onFrameReady(const QImage &img, qint64 wallMs)
+{
+    m_videoLabel->setPixmap(QPixmap::fromImage(img).scaled(m_videoLabel->size(), Qt::KeepAspectRatio,
+                                                           Qt::FastTransformation));
+    m_statusLabel->setText(QString("%1  缓存 %2 MB")
+                               .arg(QDateTime::fromMSecsSinceEpoch(wallMs).toString("yyyy-MM-dd hh:mm:ss.zzz"))
+                               .arg(m_player->cacheBytes() / (1024 * 1024)));
+}
+
+void RecordingPlaybackDialog::onPositionUnavailable(qint64 wallMs)
+{
+    m_statusLabel->setText(QString("%1 没有录像")
+                               .arg(QDateTime::fromMSecsSinceEpoch(wallMs).toString("yyyy-MM-dd hh:mm:ss")));
+}
@@ -0,0 +1,65 @@
+#ifndef RECORDINGPLAYBACKDIALOG_H
+#define RECORDINGPLAYBACKDIALOG_H
+
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QDateTimeEdit>
+#include <QComboBox>
+#include <QImage>
+
+class RecordingPlayer;
+class TimelapseJob;
+
+// 录像回放对话框：按时间定位，逐帧前进后退，正放和倒放
+class RecordingPlaybackDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    RecordingPlaybackDialog(const QString &title, const QString &streamDir, qint64 cacheBytes,
+                            QWidget *parent = nullptr);
+    ~RecordingPlaybackDialog();
+    
+    // 缩略图条和延时视频的生成参数
+    void setTimelapseOptions(int intervalSeconds, int thumbWidth, int columns, double cpuBudget, int fps);
+
+private slots:
+    void onSeekClicked();
+    void onFrameReady(const QImage &img, qint64 wallMs);
+    void onPositionUnavailable(qint64 wallMs);
+    void onTimelapseClicked();
+
+private:
+    void setupUI();
+    void applyStyles();
+    double selectedSpeed() const;
+
+    RecordingPlayer *m_player;
+    QString m_streamDir;
+    TimelapseJob *m_timelapseJob;
+    int m_timelapseIntervalSeconds;
+    int m_timelapseThumbWidth;
+    int m_timelapseColumns;
+    double m_timelapseCpuBudget;
+    int m_timelapseFps;
+
+    QDateTimeEdit *m_timeEdit;
+    QPushButton *m_seekButton;
+    QLabel *m_videoLabel;
+    QPushButton *m_reverseButton;
+    QPushButton *m_stepBackButton;
+    QPushButton *m_pauseButton;
+    QPushButton *m_stepForwardButton;
+    QPushButton *m_playButton;
+    QComboBox *m_speedCombo;
+    QPushButton *m_timelapseButton;
+    QLabel *m_statusLabel;
+
+    static const int VIDEO_WIDTH = 800;
+    static const int VIDEO_HEIGHT = 450;
+};
+
+#endif // RECORDINGPLAYBACKDIALOG_H
@@ -0,0 +1,229 @@
+#include "recordingplayer.h"
+#include "playbackpacing.h"
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QDebug>
+#include <cmath>
+
+RecordingPlayer::RecordingPlayer(const QString &streamDir, qint64 cacheBytes, QObject *parent)
+    : QThread(parent)
+    , m_cache(streamDir, cacheBytes)
+    , m_seekTarget(0)
+    , m_hasSeek(false)
+    , m_prepareTarget(0)
+    , m_hasPrepare(false)
+    , m_steps(0)
+    , m_speed(0)
+    , m_stop(false)
+    , m_frameIndex(0)
+    , m_unavailable(false)
+{
+}
+
+RecordingPlayer::~RecordingPlayer()
+{
+    stop();
+    wait();
+}
+
+void RecordingPlayer::setFrameSize(const QSize &size)
+{
+    m_cache.setFrameSize(size);
+}
+
+void RecordingPlayer::seek(qint64 wallMs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_seekTarget = wallMs;
+    m_hasSeek = true;
+    m_steps = 0;
+    m_cond.wakeOne();
+}
+
+void RecordingPlayer::prepare(qint64 wallMs)
+{
+    QMutexLocker locker(&m_mutex);
+    m_prepareTarget = wallMs;
+    m_hasPrepare = true;
+    m_cond.wakeOne();
+}
+
+void RecordingPlayer::step(int frames)
+{
+    QMutexLocker locker(&m_mutex);
+    m_steps += frames;
+    m_speed = 0;
+    m_cond.wakeOne();
+}
+
+void RecordingPlayer::play(double speed)
+{
+    QMutexLocker locker(&m_mutex);
+    m_speed = speed;
+    m_cond.wakeOne();
+}
+
+void RecordingPlayer::stop()
+{
+    QMutexLocker locker(&m_mutex);
+    m_stop = true;
+    m_cond.wakeOne();
+}
+
+void RecordingPlayer::run()
+{
+    QElapsedTimer sinceShown;
+    sinceShown.start();
+
+    forever {
+        bool hasSeek = false;
+        qint64 seekTarget = 0;
+        bool hasPrepare = false;
+        qint64 prepareTarget = 0;
+        int steps = 0;
+        double speed = 0;
+        {
+            QMutexLocker locker(&m_mutex);
+            // 正在播放时等到下一帧该显示的时刻
+            qint64 waitMs = 1000;
+            if (m_speed != 0 && m_gop) {
+                waitMs = qMax<qint64>(0, frameDelayMs(m_speed) - sinceShown.elapsed());
+            }
+            if (!m_stop && !m_hasSeek && !m_hasPrepare && m_steps == 0 && waitMs > 0) {
+                m_cond.wait(&m_mutex, ulong(waitMs));
+            }
+            if (m_stop) {
+                break;
+            }
+            hasSeek = m_hasSeek;
+            seekTarget = m_seekTarget;
+            hasPrepare = m_hasPrepare;
+            prepareTarget = m_prepareTarget;
+            m_hasPrepare = false;
+            steps = m_steps;
+            speed = m_speed;
+            m_hasSeek = false;
+            m_steps = 0;
+        }
+
+        if (hasPrepare) {
+            QSharedPointer<const DecodedGop> gop = m_cache.gopAt(prepareTarget);
+            if (gop) {
+                m_cache.prefetchAround(*gop);
+            }
+            emit prepared(prepareTarget, !gop.isNull());
+        }
+
+        if (hasSeek) {
+            // 目标仍在当前GOP内时不必查索引
+            QSharedPointer<const DecodedGop> gop = m_gop;
+            if (!gop || seekTarget < gop->wallMs.first() || seekTarget > gop->wallMs.last()) {
+                gop = m_cache.gopAt(seekTarget);
+            }
+            // 索引总能找到之前的关键帧，目标落在录像中断处时视为没有录像
+            if (gop && seekTarget > gop->wallMs.last() + MAX_GAP_MS) {
+                gop.clear();
+            }
+            if (!gop) {
+                if (!m_unavailable) {
+                    m_unavailable = true;
+                    emit positionUnavailable(seekTarget);
+                }
+                continue;
+            }
+            // 取目标时间之前（含）的最后一帧
+            int index = 0;
+            while (index + 1 < gop->wallMs.size() && gop->wallMs.at(index + 1) <= seekTarget) {
+                ++index;
+            }
+            if (gop == m_gop && index == m_frameIndex && !m_unavailable) {
+                continue;
+            }
+            if (gop != m_gop) {
+                m_cache.prefetchAround(*gop);
+            }
+            m_gop = gop;
+            m_frameIndex = index;
+            m_unavailable = false;
+            showFrame();
+            sinceShown.restart();
+            continue;
+        }
+        if (!m_gop) {
+            continue;
+        }
+
+        if (steps != 0) {
+            move(steps);
+            showFrame();
+            sinceShown.restart();
+            continue;
+        }
+
+        // 等待被新命令打断时重新计算
+        if (speed == 0) {
+            continue;
+        }
+        if (sinceShown.elapsed() < frameDelayMs(speed)) {
+            continue;
+        }
+
+        if (!move(speed > 0 ? 1 : -1)) {
+            {
+                QMutexLocker locker(&m_mutex);
+                m_speed = 0;
+            }
+            emit reachedEnd();
+            continue;
+        }
+        showFrame();
+        sinceShown.restart();
+    }
+
+    m_gop.clear();
+}
+
+qint64 RecordingPlayer::frameDelayMs(double speed) const
+{
+    // 按相邻两帧的时间差播放，GOP边界处没有下一帧时按25fps
+    qint64 intervalMs = 40;
+    int next = m_frameIndex + (speed > 0 ? 1 : -1);
+    if (next >= 0 && next < m_gop->wallMs.size()) {
+        intervalMs = qAbs(m_gop->wallMs.at(next) - m_gop->wallMs.at(m_frameIndex));
+    }
+    intervalMs = qMin<qint64>(intervalMs, MAX_FRAME_DELAY_MS);
+    return qint64(intervalMs / std::fabs(speed));
+}
+
+bool RecordingPlayer::move(int delta)
+{
+    int index = m_frameIndex + delta;
+    // 跨GOP时取相邻的GOP，倒放时前一个GOP通常已在后台解码好
+    while (index < 0 || index >= m_gop->frames.size()) {
+        QSharedPointer<const DecodedGop> gop;
+        if (index < 0) {
+            gop = m_cache.previousGop(*m_gop);
+            if (!gop || gop->keyWallMs >= m_gop->keyWallMs) {
+                m_frameIndex = 0;
+                return false;
+            }
+            index += gop->frames.size();
+        } else {
+            gop = m_cache.nextGop(*m_gop);
+            if (!gop || gop->keyWallMs <= m_gop->keyWallMs) {
+                m_frameIndex = m_gop->frames.size() - 1;
+                return false;
+            }
+            index -= m_gop->frames.size();
+        }
+        m_gop = gop;
+        m_cache.prefetchAround(*m_gop);
+    }
+    m_frameIndex = index;
+    return true;
+}
+
+void RecordingPlayer::showFrame()
+{
+    emit frameReady(m_gop->frames.at(m_frameIndex), m_gop->wallMs.at(m_frameIndex));
+}
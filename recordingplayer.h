@@ -0,0 +1,75 @@
+#ifndef RECORDINGPLAYER_H
+#define RECORDINGPLAYER_H
+
+#include <QThread>
+#include <QImage>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSize>
+#include <QString>
+#include "gopcache.h"
+
+// 录像回放
+// 通过RecordingIndex定位、GopCache解码，支持按时间定位、逐帧前进后退、正放和倒放。
+// 控制接口线程安全，命令在回放线程上执行；连续的定位请求只执行最后一个。
+class RecordingPlayer : public QThread
+{
+    Q_OBJECT
+public:
+    RecordingPlayer(const QString &streamDir, qint64 cacheBytes, QObject *parent = nullptr);
+    ~RecordingPlayer();
+
+    // 解码后缩放到此尺寸以内，需在start()之前设置
+    void setFrameSize(const QSize &size);
+
+    // 定位到wallMs之前（含）的最后一帧，画面没有变化时不重复发出
+    void seek(qint64 wallMs);
+    // 只解码wallMs所在的GOP及其相邻GOP而不显示，完成后发出prepared
+    void prepare(qint64 wallMs);
+    // 正数向前，负数向后，同时暂停
+    void step(int frames);
+    // speed为倍速，负数表示倒放，0表示暂停
+    void play(double speed);
+    void pause() { play(0); }
+    void stop();
+
+    qint64 cacheBytes() const { return m_cache.bytes(); }
+
+signals:
+    void frameReady(const QImage &img, qint64 wallMs);
+    // 该时间没有录像，连续定位到没有录像的时间时只发出一次
+    void positionUnavailable(qint64 wallMs);
+    void prepared(qint64 wallMs, bool ok);
+    // 正放或倒放到了录像的尽头，已暂停
+    void reachedEnd();
+
+protected:
+    void run() override;
+
+private:
+    qint64 frameDelayMs(double speed) const;
+    bool move(int delta);
+    void showFrame();
+
+    GopCache m_cache;
+
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    qint64 m_seekTarget;
+    bool m_hasSeek;
+    qint64 m_prepareTarget;
+    bool m_hasPrepare;
+    int m_steps;
+    double m_speed;
+    bool m_stop;
+
+    // 只在回放线程中访问
+    QSharedPointer<const DecodedGop> m_gop;
+    int m_frameIndex;
+    bool m_unavailable;
+
+    // 目标时间超过GOP最后一帧这么久即认为录像在此中断
+    static const int MAX_GAP_MS = 1000;
+};
+
+#endif // RECORDINGPLAYER_H
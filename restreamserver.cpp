@@ -0,0 +1,373 @@
+#include "restreamserver.h"
+#include "streamhub.h"
+#include "streamPlayer.h"
+#include <QMutexLocker>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+#include <QDebug>
+
+extern "C"
+{
+    #include "libavcodec/avcodec.h"
+    #include "libavformat/avformat.h"
+    #include "libavutil/mem.h"
+    #include "libavutil/opt.h"
+}
+
+namespace {
+
+// TS包为188字节，缓冲取其整数倍
+const int IO_BUFFER_SIZE = 188 * 64;
+
+}
+
+RestreamChannel::RestreamChannel(quint64 id, QObject *parent)
+    : QObject(parent)
+    , m_id(id)
+    , m_pendingBytes(0)
+    , m_pendingWaitKey(false)
+    , m_dropped(0)
+    , m_output(nullptr)
+    , m_io(nullptr)
+    , m_stream(nullptr)
+    , m_inTimeBase({1, 90000})
+    , m_lastDts(AV_NOPTS_VALUE)
+    , m_waitKey(true)
+{
+}
+
+RestreamChannel::~RestreamChannel()
+{
+    closeMuxer();
+}
+
+QVector<RestreamChannel::Chunk> RestreamChannel::takeChunks()
+{
+    QMutexLocker locker(&m_mutex);
+    QVector<Chunk> chunks;
+    chunks.swap(m_pending);
+    m_pendingBytes = 0;
+    return chunks;
+}
+
+quint64 RestreamChannel::droppedChunks() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_dropped;
+}
+
+void RestreamChannel::enqueue(const QByteArray &data, bool keyframe)
+{
+    bool notify = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_pendingWaitKey && !keyframe) {
+            m_dropped++;
+            return;
+        }
+        if (m_pendingBytes + data.size() > MAX_PENDING_BYTES) {
+            // 接收线程处理不过来，已排队的块作废，从下一个关键帧重新开始
+            if (!m_pendingWaitKey) {
+                qWarning() << "转发队列溢出，丢弃到下一个关键帧";
+            }
+            m_dropped += quint64(m_pending.size()) + 1;
+            m_pending.clear();
+            m_pendingBytes = 0;
+            m_pendingWaitKey = true;
+            return;
+        }
+        m_pendingWaitKey = false;
+        notify = m_pending.isEmpty();
+        Chunk chunk;
+        chunk.data = data;
+        chunk.keyframe = keyframe;
+        m_pending.append(chunk);
+        m_pendingBytes += data.size();
+    }
+    // 同一批只通知一次，接收线程的事件队列不随块数增长
+    if (notify) {
+        emit chunksAvailable(m_id);
+    }
+}
+
+int RestreamChannel::writeCallback(void *opaque, const uint8_t *buf, int size)
+{
+    RestreamChannel *channel = static_cast<RestreamChannel *>(opaque);
+    channel->m_chunk.append(reinterpret_cast<const char *>(buf), size);
+    return size;
+}
+
+void RestreamChannel::streamOpened(const AVCodecParameters *codecpar, AVRational timeBase)
+{
+    // 重新连接后参数可能变化，重建封装器；客户端连接不断，从新流的关键帧继续
+    closeMuxer();
+
+    if (avformat_alloc_output_context2(&m_output, nullptr, "mpegts", nullptr) < 0 || !m_output) {
+        qWarning() << "无法创建TS封装器";
+        return;
+    }
+    m_stream = avformat_new_stream(m_output, nullptr);
+    if (!m_stream || avcodec_parameters_copy(m_stream->codecpar, codecpar) < 0) {
+        closeMuxer();
+        return;
+    }
+    m_stream->codecpar->codec_tag = 0;
+    m_stream->time_base = timeBase;
+    m_inTimeBase = timeBase;
+
+    uint8_t *buffer = static_cast<uint8_t *>(av_malloc(IO_BUFFER_SIZE));
+    m_io = avio_alloc_context(buffer, IO_BUFFER_SIZE, 1, this, nullptr, &RestreamChannel::writeCallback, nullptr);
+    if (!m_io) {
+        av_free(buffer);
+        closeMuxer();
+        return;
+    }
+    m_output->pb = m_io;
+    m_output->flags |= AVFMT_FLAG_CUSTOM_IO;
+    if (avformat_write_header(m_output, nullptr) < 0) {
+        qWarning() << "写入TS头失败";
+        closeMuxer();
+        return;
+    }
+    // 头部（PAT/PMT）会在每个关键帧前重发，这里不单独发出
+    avio_flush(m_io);
+    m_chunk.clear();
+    m_lastDts = AV_NOPTS_VALUE;
+    m_waitKey = true;
+}
+
+void RestreamChannel::packetReceived(const AVPacket *packet, qint64 wallMs)
+{
+    Q_UNUSED(wallMs);
+    bool key = packet->flags & AV_PKT_FLAG_KEY;
+    if (!m_output || (m_waitKey && !key)) {
+        return;
+    }
+
+    AVPacket *out = av_packet_clone(packet);
+    if (!out) {
+        return;
+    }
+    if (out->dts == AV_NOPTS_VALUE) {
+        out->dts = out->pts;
+    }
+    if (out->pts == AV_NOPTS_VALUE) {
+        out->pts = out->dts;
+    }
+    // 封装器要求dts严格递增，乱序或重复的包直接丢弃
+    if (out->dts == AV_NOPTS_VALUE || (m_lastDts != AV_NOPTS_VALUE && out->dts <= m_lastDts)) {
+        av_packet_free(&out);
+        return;
+    }
+    m_lastDts = out->dts;
+    m_waitKey = false;
+
+    if (key) {
+        // 每个关键帧块都带PAT/PMT，新客户端从这里开始即可解码
+        av_opt_set(m_output->priv_data, "mpegts_flags", "+resend_headers", 0);
+    }
+    av_packet_rescale_ts(out, m_inTimeBase, m_stream->time_base);
+    out->stream_index = m_stream->index;
+    out->pos = -1;
+    int ret = av_write_frame(m_output, out);
+    av_packet_free(&out);
+    if (ret < 0) {
+        return;
+    }
+
+    avio_flush(m_io);
+    if (!m_chunk.isEmpty()) {
+        enqueue(m_chunk, key);
+        m_chunk.clear();
+    }
+}
+
+void RestreamChannel::streamClosed()
+{
+    closeMuxer();
+}
+
+void RestreamChannel::closeMuxer()
+{
+    if (m_io) {
+        av_freep(&m_io->buffer);
+        avio_context_free(&m_io);
+    }
+    if (m_output) {
+        m_output->pb = nullptr;
+        avformat_free_context(m_output);
+        m_output = nullptr;
+    }
+    m_stream = nullptr;
+    m_chunk.clear();
+    m_waitKey = true;
+}
+
+RestreamServer::RestreamServer(StreamHub *hub, QObject *parent)
+    : QObject(parent)
+    , m_hub(hub)
+    , m_server(new QTcpServer(this))
+    , m_clientQueueLimit(2 * 1024 * 1024)
+    , m_nextChannelId(0)
+{
+    connect(m_server, &QTcpServer::newConnection, this, &RestreamServer::onNewConnection);
+}
+
+RestreamServer::~RestreamServer()
+{
+    m_server->close();
+    const QList<QString> streamIds = m_channels.keys();
+    for (const QString &streamId : streamIds) {
+        releaseChannel(streamId);
+    }
+}
+
+bool RestreamServer::listen(quint16 port)
+{
+    if (!m_server->listen(QHostAddress::Any, port)) {
+        qWarning() << "转发服务监听失败:" << port << m_server->errorString();
+        return false;
+    }
+    qDebug() << "转发服务已启动，端口:" << port;
+    return true;
+}
+
+void RestreamServer::onStreamAdded(const QString &id, const QString &name, const QString &url)
+{
+    Q_UNUSED(name);
+    m_urls.insert(id.isEmpty() ? url : id, url);
+}
+
+void RestreamServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        m_clients.insert(socket, Client());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() {
+            handleRequest(socket);
+        });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            removeClient(socket);
+        });
+    }
+}
+
+void RestreamServer::handleRequest(QTcpSocket *socket)
+{
+    auto it = m_clients.find(socket);
+    if (it == m_clients.end() || it->requested) {
+        // 请求之后客户端发来的数据一概忽略
+        socket->readAll();
+        return;
+    }
+    if (!socket->canReadLine()) {
+        if (socket->bytesAvailable() > MAX_REQUEST_BYTES) {
+            socket->abort();
+        }
+        return;
+    }
+
+    // 只看请求行：GET /<流ID> HTTP/1.x，其余请求头不需要
+    QList<QByteArray> parts = socket->readLine().trimmed().split(' ');
+    QString streamId = parts.size() >= 2 ? QUrl::fromPercentEncoding(parts.at(1).mid(1)) : QString();
+    if (parts.size() < 2 || parts.at(0) != "GET" || !m_urls.contains(streamId) || !m_hub) {
+        socket->write("HTTP/1.0 404 Not Found\r\nConnection: close\r\n\r\n");
+        socket->disconnectFromHost();
+        return;
+    }
+    it->requested = true;
+    it->streamId = streamId;
+
+    Channel &channel = m_channels[streamId];
+    if (!channel.channel) {
+        channel.channel = new RestreamChannel(++m_nextChannelId);
+        connect(channel.channel, &RestreamChannel::chunksAvailable, this, &RestreamServer::onChunksAvailable,
+                Qt::QueuedConnection);
+        channel.player = m_hub->acquire(m_urls.value(streamId), streamId, false);
+        channel.player->addPacketSink(channel.channel);
+        qDebug() << "开始转发:" << streamId;
+    }
+    channel.clients++;
+
+    socket->write("HTTP/1.0 200 OK\r\nContent-Type: video/mp2t\r\nCache-Control: no-cache\r\n"
+                  "Connection: close\r\n\r\n");
+    qDebug() << "转发客户端加入:" << socket->peerAddress().toString() << streamId << "人数:" << channel.clients;
+}
+
+void RestreamServer::onChunksAvailable(quint64 channelId)
+{
+    // 通道释放后仍可能有排队的通知，按编号查找，找不到即已释放
+    QString streamId;
+    RestreamChannel *source = nullptr;
+    for (auto it = m_channels.constBegin(); it != m_channels.constEnd(); ++it) {
+        if (it->channel && it->channel->id() == channelId) {
+            streamId = it.key();
+            source = it->channel;
+            break;
+        }
+    }
+    if (!source) {
+        return;
+    }
+    const QVector<RestreamChannel::Chunk> chunks = source->takeChunks();
+    for (const RestreamChannel::Chunk &chunk : chunks) {
+        sendChunk(streamId, chunk);
+    }
+}
+
+void RestreamServer::sendChunk(const QString &streamId, const RestreamChannel::Chunk &chunk)
+{
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+        Client &client = it.value();
+        if (!client.requested || client.streamId != streamId) {
+            continue;
+        }
+        if (client.waitKey && !chunk.keyframe) {
+            continue;
+        }
+        // 慢客户端：待发数据超过上限时丢到下一个关键帧，已发出的部分仍是完整的TS包
+        QTcpSocket *socket = it.key();
+        if (socket->bytesToWrite() + chunk.data.size() > m_clientQueueLimit) {
+            if (!client.waitKey) {
+                qWarning() << "转发客户端跟不上，丢弃到下一个关键帧:" << socket->peerAddress().toString();
+            }
+            client.waitKey = true;
+            client.droppedChunks++;
+            continue;
+        }
+        client.waitKey = false;
+        socket->write(chunk.data);
+    }
+}
+
+void RestreamServer::removeClient(QTcpSocket *socket)
+{
+    Client client = m_clients.take(socket);
+    socket->deleteLater();
+    if (!client.requested) {
+        return;
+    }
+    qDebug() << "转发客户端离开:" << client.streamId << "丢弃块数:" << client.droppedChunks;
+    auto it = m_channels.find(client.streamId);
+    if (it != m_channels.end() && --it->clients <= 0) {
+        releaseChannel(client.streamId);
+    }
+}
+
+void RestreamServer::releaseChannel(const QString &streamId)
+{
+    Channel channel = m_channels.take(streamId);
+    if (!channel.channel) {
+        return;
+    }
+    // 先摘下再释放，之后不会再有回调；已排队的通知按编号找不到通道，直接忽略
+    if (m_hub) {
+        channel.player->removePacketSink(channel.channel);
+        m_hub->release(channel.player, false);
+    }
+    if (channel.channel->droppedChunks() > 0) {
+        qDebug() << "转发队列丢弃块数:" << channel.channel->droppedChunks();
+    }
+    delete channel.channel;
+    qDebug() << "停止转发:" << streamId;
+}
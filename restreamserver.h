@@ -0,0 +1,133 @@
+#ifndef RESTREAMSERVER_H
+#define RESTREAMSERVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+#include "packetsink.h"
+
+class QTcpServer;
+class QTcpSocket;
+class StreamHub;
+class StreamPlayer;
+struct AVFormatContext;
+struct AVIOContext;
+struct AVStream;
+
+// 一路流的MPEG-TS封装
+// 作为PacketSink在解复用线程上把压缩包按流拷贝封装为TS，每个包封装后的字节作为一块放入待发队列，
+// 关键帧块之前重发PAT/PMT，客户端从任意关键帧块开始都能直接解码。封装只在内存中进行，不阻塞。
+// 待发队列按字节数限制：接收线程跟不上时清空队列，丢弃到下一个关键帧。
+class RestreamChannel : public QObject, public PacketSink
+{
+    Q_OBJECT
+public:
+    struct Chunk
+    {
+        QByteArray data;
+        bool keyframe = false;
+    };
+
+    // id由使用者分配，用于在通知中区分通道，不会因对象地址复用而混淆
+    explicit RestreamChannel(quint64 id, QObject *parent = nullptr);
+    ~RestreamChannel();
+
+    quint64 id() const { return m_id; }
+    // 取走全部待发块，线程安全
+    QVector<Chunk> takeChunks();
+    quint64 droppedChunks() const;
+
+    // PacketSink，在解复用线程上调用
+    void streamOpened(const AVCodecParameters *codecpar, AVRational timeBase) override;
+    void packetReceived(const AVPacket *packet, qint64 wallMs) override;
+    void streamClosed() override;
+
+signals:
+    // 在解复用线程上、待发队列由空变为非空时发出一次，接收者在自己的线程中用takeChunks取走
+    void chunksAvailable(quint64 channelId);
+
+private:
+    static int writeCallback(void *opaque, const uint8_t *buf, int size);
+    void closeMuxer();
+    void enqueue(const QByteArray &data, bool keyframe);
+
+    const quint64 m_id;
+
+    mutable QMutex m_mutex;
+    QVector<Chunk> m_pending;
+    qint64 m_pendingBytes;
+    bool m_pendingWaitKey;      // 队列溢出后丢弃到下一个关键帧
+    quint64 m_dropped;
+
+    // 以下只在解复用线程中访问
+    AVFormatContext *m_output;
+    AVIOContext *m_io;
+    AVStream *m_stream;
+    AVRational m_inTimeBase;
+    qint64 m_lastDts;
+    bool m_waitKey;
+    QByteArray m_chunk;
+
+    static const int MAX_PENDING_BYTES = 8 * 1024 * 1024;
+};
+
+// 本地转发服务
+// 以HTTP提供MPEG-TS流：GET /<流ID> 。每路摄像机只通过StreamHub打开一次且不解码，
+// 所有客户端共用同一份封装结果。每个客户端有自己的发送队列（socket待发字节），
+// 超过上限的慢客户端丢弃到下一个关键帧，不影响其他客户端和录像。只在主线程中使用。
+class RestreamServer : public QObject
+{
+    Q_OBJECT
+public:
+    RestreamServer(StreamHub *hub, QObject *parent = nullptr);
+    ~RestreamServer();
+
+    void setClientQueueLimit(qint64 bytes) { m_clientQueueLimit = bytes; }
+    bool listen(quint16 port);
+    int clientCount() const { return m_clients.size(); }
+
+public slots:
+    // 只转发流目录中出现过的流
+    void onStreamAdded(const QString &id, const QString &name, const QString &url);
+
+private slots:
+    void onNewConnection();
+    void onChunksAvailable(quint64 channelId);
+
+private:
+    struct Client
+    {
+        QString streamId;
+        bool requested = false;     // 已读到请求头
+        bool waitKey = true;        // 刚加入或刚丢弃过，从下一个关键帧块开始发
+        quint64 droppedChunks = 0;
+    };
+
+    struct Channel
+    {
+        StreamPlayer *player = nullptr;
+        RestreamChannel *channel = nullptr;
+        int clients = 0;
+    };
+
+    void handleRequest(QTcpSocket *socket);
+    void removeClient(QTcpSocket *socket);
+    void releaseChannel(const QString &streamId);
+    void sendChunk(const QString &streamId, const RestreamChannel::Chunk &chunk);
+
+    QPointer<StreamHub> m_hub;
+    QTcpServer *m_server;
+    qint64 m_clientQueueLimit;
+    QHash<QString, QString> m_urls;             // 流ID -> URL
+    QHash<QString, Channel> m_channels;         // 流ID -> 转发通道
+    QHash<QTcpSocket *, Client> m_clients;
+    quint64 m_nextChannelId;
+
+    static const int MAX_REQUEST_BYTES = 8192;
+};
+
+#endif // RESTREAMSERVER_H
@@ -0,0 +1,90 @@
+#include "samplingmanager.h"
+#include "framesampler.h"
+#include "snapshotwriter.h"
+#include "streamhub.h"
+#include "streamPlayer.h"
+#include <QDebug>
+
+SamplingManager::SamplingManager(StreamHub *hub, const QString &rootDir, QObject *parent)
+    : QObject(parent)
+    , m_hub(hub)
+    , m_rootDir(rootDir)
+    , m_intervalMs(1000)
+    , m_format("jpg")
+    , m_quality(90)
+    , m_threads(2)
+    , m_maxPending(64)
+    , m_queueLimit(8 * 1024 * 1024)
+    , m_writer(nullptr)
+{
+}
+
+SamplingManager::~SamplingManager()
+{
+    for (auto it = m_samplers.begin(); it != m_samplers.end(); ++it) {
+        // 先摘下再停止，停止后不会再有回调
+        if (m_hub) {
+            it->player->removePacketSink(it->sampler);
+        }
+        it->sampler->stop();
+        it->sampler->wait();
+        if (m_hub) {
+            m_hub->release(it->player, false);
+        }
+        qDebug() << "停止取样:" << it->sampler->name() << "样本:" << it->sampler->samples()
+                 << "丢弃样本:" << it->sampler->droppedSamples();
+        delete it->sampler;
+    }
+    // 取样线程都已停止，等待已排队的样本写完
+    delete m_writer;
+}
+
+void SamplingManager::setOutput(const QString &format, int quality, int threads, int maxPending)
+{
+    m_format = format;
+    m_quality = quality;
+    m_threads = threads;
+    m_maxPending = maxPending;
+}
+
+void SamplingManager::start()
+{
+    if (m_targets.isEmpty() || m_writer) {
+        return;
+    }
+    m_writer = new SnapshotWriter(m_rootDir, m_format, m_quality, m_threads);
+    m_writer->setScaledSize(m_frameSize);
+    m_writer->setGroupByName(true);
+    m_writer->setMaxPending(m_maxPending);
+    for (const QString &target : m_targets) {
+        if (target.contains("://")) {
+            startSampling(target, target);
+        }
+    }
+}
+
+void SamplingManager::onStreamAdded(const QString &id, const QString &name, const QString &url)
+{
+    Q_UNUSED(name);
+    if (m_writer && !id.isEmpty() && m_targets.contains(id)) {
+        startSampling(id, url);
+    }
+}
+
+void SamplingManager::startSampling(const QString &key, const QString &url)
+{
+    if (!m_hub || m_samplers.contains(url)) {
+        return;
+    }
+
+    Sampling sampling;
+    sampling.sampler = new FrameSampler(key, m_writer);
+    sampling.sampler->setInterval(m_intervalMs);
+    sampling.sampler->setQueueLimit(m_queueLimit);
+    sampling.sampler->start();
+
+    sampling.player = m_hub->acquire(url, key, false);
+    sampling.player->addPacketSink(sampling.sampler);
+    m_samplers.insert(url, sampling);
+    qDebug() << "开始取样:" << key << "间隔(ms):" << m_intervalMs;
+}
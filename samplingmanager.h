@@ -0,0 +1,64 @@
+#ifndef SAMPLINGMANAGER_H
+#define SAMPLINGMANAGER_H
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QSize>
+#include <QStringList>
+
+class StreamHub;
+class StreamPlayer;
+class FrameSampler;
+class SnapshotWriter;
+
+// 选定流的连续取样，用于采集训练数据
+// 取样的播放器从StreamHub取得且不解码，与观看、录像共用同一路连接；每路流一个FrameSampler，
+// 所有流共用一个SnapshotWriter，写盘积压时整体丢弃样本。
+// 目标可以是流ID或URL：URL在start()时直接开始，流ID等列表中出现该流时开始。只在GUI（主）线程中使用。
+class SamplingManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    SamplingManager(StreamHub *hub, const QString &rootDir, QObject *parent = nullptr);
+    ~SamplingManager();
+
+    // 以下设置需在start()之前调用
+    void setTargets(const QStringList &targets) { m_targets = targets; }
+    void setInterval(qint64 ms) { m_intervalMs = ms; }
+    void setFrameSize(const QSize &size) { m_frameSize = size; }
+    // format为jpg或png，threads为编码线程数，maxPending为等待编码写盘的样本上限
+    void setOutput(const QString &format, int quality, int threads, int maxPending);
+    void setQueueLimit(qint64 bytes) { m_queueLimit = bytes; }
+
+    void start();
+    int samplerCount() const { return m_samplers.size(); }
+
+public slots:
+    void onStreamAdded(const QString &id, const QString &name, const QString &url);
+
+private:
+    struct Sampling
+    {
+        StreamPlayer *player = nullptr;
+        FrameSampler *sampler = nullptr;
+    };
+
+    void startSampling(const QString &key, const QString &url);
+
+    QPointer<StreamHub> m_hub;
+    QString m_rootDir;
+    QStringList m_targets;
+    qint64 m_intervalMs;
+    QSize m_frameSize;
+    QString m_format;
+    int m_quality;
+    int m_threads;
+    int m_maxPending;
+    qint64 m_queueLimit;
+    SnapshotWriter *m_writer;
+    QHash<QString, Sampling> m_samplers;        // URL -> 取样
+};
+
+#endif // SAMPLINGMANAGER_H
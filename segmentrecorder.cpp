@@ -0,0 +1,389 @@
+#include "segmentrecorder.h"
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QDebug>
+#include <iterator>
+
+extern "C"
+{
+    #include "libavcodec/avcodec.h"
+}
+
+class RecordingQuotaScanTask : public QRunnable
+{
+public:
+    explicit RecordingQuotaScanTask(RecordingQuota *quota) : m_quota(quota) {}
+
+    void run() override
+    {
+        m_quota->scan();
+    }
+
+private:
+    RecordingQuota *m_quota;
+};
+
+RecordingQuota::RecordingQuota(const QString &rootDir, qint64 maxBytes)
+    : m_rootDir(rootDir)
+    , m_maxBytes(maxBytes)
+    , m_scanned(false)
+    , m_abortScan(false)
+    , m_usedBytes(0)
+{
+    m_scanPool.setMaxThreadCount(1);
+    m_scanPool.start(new RecordingQuotaScanTask(this));
+}
+
+RecordingQuota::~RecordingQuota()
+{
+    m_abortScan = true;
+    m_scanPool.waitForDone();
+}
+
+void RecordingQuota::scan()
+{
+    // 遍历目录不持锁，录像线程照常登记
+    struct Found
+    {
+        QString path;
+        qint64 bytes;
+        qint64 modifiedMs;
+    };
+    QVector<Found> found;
+    QDirIterator it(m_rootDir, QStringList() << "*.mp4", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext() && !m_abortScan) {
+        it.next();
+        QFileInfo info = it.fileInfo();
+        found.append(Found{info.absoluteFilePath(), info.size(), info.lastModified().toMSecsSinceEpoch()});
+    }
+    if (m_abortScan) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    for (const Found &segment : found) {
+        // 其他录像线程正在写的分段已预分配，大小不准，等关闭时再登记
+        if (!m_openPaths.contains(segment.path)) {
+            addSegment(segment.path, segment.bytes, segment.modifiedMs);
+        }
+    }
+    m_scanned = true;
+    qDebug() << "录像目录:" << m_rootDir << "已有分段:" << m_segments.size() << "字节数:" << m_usedBytes;
+    enforce();
+}
+
+void RecordingQuota::addSegment(const QString &path, qint64 bytes, qint64 modifiedMs)
+{
+    auto it = m_segments.find(path);
+    if (it != m_segments.end()) {
+        // 已登记过，只更新大小
+        m_usedBytes += bytes - it->bytes;
+        it->bytes = bytes;
+        return;
+    }
+    Segment segment;
+    segment.bytes = bytes;
+    segment.modifiedMs = modifiedMs;
+    m_segments.insert(path, segment);
+    m_byAge.insert(modifiedMs, path);
+    m_usedBytes += bytes;
+}
+
+void RecordingQuota::segmentOpened(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    m_openPaths.insert(QFileInfo(path).absoluteFilePath());
+}
+
+void RecordingQuota::segmentAbandoned(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    m_openPaths.remove(QFileInfo(path).absoluteFilePath());
+}
+
+void RecordingQuota::segmentClosed(const QString &path, qint64 bytes)
+{
+    QString absolutePath = QFileInfo(path).absoluteFilePath();
+    QMutexLocker locker(&m_mutex);
+    m_openPaths.remove(absolutePath);
+    addSegment(absolutePath, bytes, QDateTime::currentMSecsSinceEpoch());
+    if (m_scanned) {
+        enforce();
+    }
+}
+
+void RecordingQuota::enforce()
+{
+    if (m_maxBytes <= 0) {
+        return;
+    }
+    // 最新的分段总是保留；删除失败的留在表中，下次再试
+    auto it = m_byAge.begin();
+    while (m_usedBytes > m_maxBytes && it != m_byAge.end() && std::next(it) != m_byAge.end()) {
+        QString path = it.value();
+        if (!QFile::remove(path) && QFile::exists(path)) {
+            qWarning() << "无法删除录像分段:" << path;
+            ++it;
+            continue;
+        }
+        qDebug() << "超出录像配额，删除分段:" << path;
+        it = m_byAge.erase(it);
+        m_usedBytes -= m_segments.take(path).bytes;
+        // 当天的分段删完后，索引和日期目录一并删除
+        QDir day = QFileInfo(path).absoluteDir();
+        if (day.entryList(QStringList() << "*.mp4", QDir::Files).isEmpty()) {
+            day.remove("index.idx");
+            QDir().rmdir(day.absolutePath());
+        }
+    }
+}
+
+qint64 RecordingQuota::usedBytes()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_usedBytes;
+}
+
+SegmentRecorder::SegmentRecorder(const QString &dir, QObject *parent)
+    : QThread(parent)
+    , m_dir(dir)
+    , m_segmentMs(300 * 1000)
+    , m_preallocBytes(0)
+    , m_queueLimit(32 * 1024 * 1024)
+    , m_quota(nullptr)
+    , m_pendingBytes(0)
+    , m_dropping(false)
+    , m_stop(false)
+    , m_dropped(0)
+    , m_codecpar(nullptr)
+    , m_timeBase({1, 90000})
+    , m_segmentStartMs(0)
+    , m_segmentSuffix(0)
+    , m_initBytes(0)
+    , m_index(dir)
+    , m_hasPendingEntry(false)
+{
+}
+
+SegmentRecorder::~SegmentRecorder()
+{
+    stop();
+    wait();
+    for (Item &item : m_pending) {
+        freeItem(item);
+    }
+    avcodec_parameters_free(&m_codecpar);
+}
+
+void SegmentRecorder::setSegmentSeconds(int seconds)
+{
+    m_segmentMs = qint64(qMax(10, seconds)) * 1000;
+}
+
+void SegmentRecorder::stop()
+{
+    QMutexLocker locker(&m_mutex);
+    m_stop = true;
+    m_cond.wakeOne();
+}
+
+void SegmentRecorder::freeItem(Item &item)
+{
+    av_packet_free(&item.packet);
+    avcodec_parameters_free(&item.codecpar);
+}
+
+void SegmentRecorder::enqueue(const Item &item, qint64 bytes)
+{
+    // 调用者持有m_mutex
+    m_pending.append(item);
+    m_pendingBytes += bytes;
+    m_cond.wakeOne();
+}
+
+void SegmentRecorder::streamOpened(const AVCodecParameters *codecpar, AVRational timeBase)
+{
+    Item item;
+    item.codecpar = avcodec_parameters_alloc();
+    if (!item.codecpar || avcodec_parameters_copy(item.codecpar, codecpar) < 0) {
+        avcodec_parameters_free(&item.codecpar);
+        return;
+    }
+    item.timeBase = timeBase;
+
+    QMutexLocker locker(&m_mutex);
+    // 新流的第一个包之前的都无法接上，重新等关键帧
+    m_dropping = true;
+    enqueue(item, 0);
+}
+
+void SegmentRecorder::packetReceived(const AVPacket *packet, qint64 wallMs)
+{
+    bool key = packet->flags & AV_PKT_FLAG_KEY;
+
+    QMutexLocker locker(&m_mutex);
+    if (m_dropping && !key) {
+        m_dropped++;
+        return;
+    }
+    if (m_pendingBytes + packet->size > m_queueLimit) {
+        if (!m_dropping) {
+            qWarning() << "录像写盘跟不上，丢弃到下一个关键帧:" << m_dir;
+        }
+        m_dropping = true;
+        m_dropped++;
+        return;
+    }
+
+    Item item;
+    item.packet = av_packet_clone(packet);
+    if (!item.packet) {
+        m_dropping = true;
+        m_dropped++;
+        return;
+    }
+    item.wallMs = wallMs;
+    m_dropping = false;
+    enqueue(item, packet->size);
+}
+
+void SegmentRecorder::streamClosed()
+{
+    QMutexLocker locker(&m_mutex);
+    m_dropping = true;
+    enqueue(Item(), 0);
+}
+
+void SegmentRecorder::run()
+{
+    QVector<Item> batch;
+    forever {
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_pending.isEmpty() && !m_stop) {
+                m_cond.wait(&m_mutex, 1000);
+            }
+            // 停止时丢弃未写的包，已写入的分片仍可播放
+            if (m_stop) {
+                break;
+            }
+            batch.swap(m_pending);
+            m_pendingBytes = 0;
+        }
+
+        for (Item &item : batch) {
+            if (item.packet) {
+                writePacket(item.packet, item.wallMs);
+            } else {
+                // 流重新打开或关闭，当前分段到此为止
+                closeSegment();
+                if (item.codecpar) {
+                    avcodec_parameters_free(&m_codecpar);
+                    m_codecpar = item.codecpar;
+                    item.codecpar = nullptr;
+                    m_timeBase = item.timeBase;
+                }
+            }
+            freeItem(item);
+        }
+        batch.clear();
+    }
+
+    closeSegment();
+    m_index.close();
+}
+
+void SegmentRecorder::writePacket(const AVPacket *packet, qint64 wallMs)
+{
+    bool key = packet->flags & AV_PKT_FLAG_KEY;
+    if (m_muxer.isOpen() && key && wallMs - m_segmentStartMs >= m_segmentMs) {
+        closeSegment();
+    }
+    if (!m_muxer.isOpen()) {
+        if (!key || !m_codecpar || !openSegment(wallMs)) {
+            return;
+        }
+    }
+    if (!m_muxer.write(packet)) {
+        QString path = m_muxer.path();
+        closeSegment();
+        emit errorOccurred(QString("写入录像失败: %1").arg(path));
+        return;
+    }
+    if (!key) {
+        return;
+    }
+
+    // 写入关键帧时封装器先写出前一个分片，当前位置就是本分片的开头
+    m_muxer.flush();
+    commitIndexEntry();
+
+    qint64 pts = packet->pts != AV_NOPTS_VALUE ? packet->pts : packet->dts;
+    RecordingIndexEntry &entry = m_pendingEntry;
+    entry.wallMs = wallMs;
+    entry.segmentStartMs = m_segmentStartMs;
+    entry.offset = m_muxer.position();
+    entry.ptsMs = av_rescale_q(pts - m_muxer.firstDts(), m_timeBase, AVRational{1, 1000});
+    entry.initBytes = quint32(m_initBytes);
+    entry.suffix = quint16(m_segmentSuffix);
+    entry.reserved = 0;
+    m_hasPendingEntry = true;
+}
+
+void SegmentRecorder::commitIndexEntry()
+{
+    if (m_hasPendingEntry) {
+        m_index.append(m_pendingEntry);
+        m_hasPendingEntry = false;
+    }
+}
+
+bool SegmentRecorder::openSegment(qint64 wallMs)
+{
+    // 重连过快时同一秒内可能再开一段
+    int suffix = 0;
+    QString path = RecordingIndex::segmentPath(m_dir, wallMs, suffix);
+    while (QFile::exists(path)) {
+        path = RecordingIndex::segmentPath(m_dir, wallMs, ++suffix);
+    }
+
+    // 创建文件之前先登记，否则后台扫描可能按预分配的大小把它计入配额并删除
+    if (m_quota) {
+        m_quota->segmentOpened(path);
+    }
+    if (!m_muxer.open(path, m_codecpar, m_timeBase, true, m_preallocBytes)) {
+        if (m_quota) {
+            m_quota->segmentAbandoned(path);
+        }
+        emit errorOccurred(QString("无法创建录像文件: %1").arg(path));
+        return false;
+    }
+    m_segmentStartMs = wallMs;
+    m_segmentSuffix = suffix;
+    m_initBytes = m_muxer.position();
+    return true;
+}
+
+void SegmentRecorder::closeSegment()
+{
+    if (!m_muxer.isOpen()) {
+        return;
+    }
+    QString path = m_muxer.path();
+    bool ok = m_muxer.close();
+    // 文件尾写出了最后一个分片
+    commitIndexEntry();
+    qint64 bytes = QFileInfo(path).size();
+    if (!ok) {
+        qWarning() << "录像分段未正常结束:" << path;
+    }
+    if (m_quota) {
+        m_quota->segmentClosed(path, bytes);
+    }
+    emit segmentFinished(path, bytes);
+}
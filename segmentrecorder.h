@@ -0,0 +1,137 @@
+#ifndef SEGMENTRECORDER_H
+#define SEGMENTRECORDER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QMultiMap>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+#include <atomic>
+#include "packetsink.h"
+#include "streamcopymuxer.h"
+#include "recordingindex.h"
+
+// 录像目录的磁盘配额
+// 所有录像线程共用一个实例，每关闭一个分段登记一次，超出配额时从最旧的分段开始删除。
+// 目录下已有的分段在构造时由后台线程扫描，扫描完成前只登记不删除。
+// 分段按绝对路径登记，重复登记不会重复计数；正在写的分段不计入。线程安全。
+class RecordingQuota
+{
+public:
+    RecordingQuota(const QString &rootDir, qint64 maxBytes);
+    ~RecordingQuota();
+
+    // 录像线程在创建分段文件之前登记，创建失败时撤销
+    void segmentOpened(const QString &path);
+    void segmentAbandoned(const QString &path);
+    void segmentClosed(const QString &path, qint64 bytes);
+    qint64 usedBytes();
+
+private:
+    friend class RecordingQuotaScanTask;
+
+    struct Segment
+    {
+        qint64 bytes;
+        qint64 modifiedMs;
+    };
+
+    void scan();
+    // 调用者持有m_mutex
+    void addSegment(const QString &path, qint64 bytes, qint64 modifiedMs);
+    void enforce();
+
+    QString m_rootDir;
+    qint64 m_maxBytes;
+    QMutex m_mutex;
+    bool m_scanned;
+    std::atomic<bool> m_abortScan;
+    qint64 m_usedBytes;
+    QHash<QString, Segment> m_segments;     // 绝对路径 -> 分段
+    QMultiMap<qint64, QString> m_byAge;     // 修改时间 -> 路径，由旧到新
+    QSet<QString> m_openPaths;              // 正在写的分段
+    QThreadPool m_scanPool;
+};
+
+// 按时间分段的连续录像
+// 作为PacketSink接收StreamPlayer解复用出的包，按流拷贝写成分片MP4：dir/yyyyMMdd/hhmmss.mp4。
+// 分段时长到达后在下一个关键帧处切换文件，每段都从关键帧开始。
+// 每个关键帧（分片）在当天的RecordingIndex中记一项，用于按时间直接定位。
+// 封装和写盘在本线程上进行；待写队列按字节数限制，写盘跟不上时丢弃到下一个关键帧为止。
+class SegmentRecorder : public QThread, public PacketSink
+{
+    Q_OBJECT
+public:
+    explicit SegmentRecorder(const QString &dir, QObject *parent = nullptr);
+    ~SegmentRecorder();
+
+    // 以下设置需在start()之前调用
+    void setSegmentSeconds(int seconds);
+    void setPreallocBytes(qint64 bytes) { m_preallocBytes = bytes; }
+    void setQueueLimit(qint64 bytes) { m_queueLimit = bytes; }
+    void setQuota(RecordingQuota *quota) { m_quota = quota; }
+
+    QString dir() const { return m_dir; }
+    quint64 droppedPackets() const { return m_dropped; }
+    void stop();
+
+    // PacketSink，在解复用线程上调用
+    void streamOpened(const AVCodecParameters *codecpar, AVRational timeBase) override;
+    void packetReceived(const AVPacket *packet, qint64 wallMs) override;
+    void streamClosed() override;
+
+signals:
+    void segmentFinished(const QString &path, qint64 bytes);
+    void errorOccurred(const QString &error_msg);
+
+protected:
+    void run() override;
+
+private:
+    // packet和codecpar都为空表示流已关闭
+    struct Item
+    {
+        AVPacket *packet = nullptr;
+        AVCodecParameters *codecpar = nullptr;
+        AVRational timeBase;
+        qint64 wallMs = 0;
+    };
+
+    void enqueue(const Item &item, qint64 bytes);
+    static void freeItem(Item &item);
+    void writePacket(const AVPacket *packet, qint64 wallMs);
+    bool openSegment(qint64 wallMs);
+    void closeSegment();
+    void commitIndexEntry();
+
+    QString m_dir;
+    qint64 m_segmentMs;
+    qint64 m_preallocBytes;
+    qint64 m_queueLimit;
+    RecordingQuota *m_quota;
+
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    QVector<Item> m_pending;
+    qint64 m_pendingBytes;
+    bool m_dropping;            // 队列溢出后丢弃到下一个关键帧
+    bool m_stop;
+    std::atomic<quint64> m_dropped;
+
+    // 只在录像线程中访问
+    StreamCopyMuxer m_muxer;
+    AVCodecParameters *m_codecpar;
+    AVRational m_timeBase;
+    qint64 m_segmentStartMs;
+    int m_segmentSuffix;
+    qint64 m_initBytes;
+    RecordingIndex m_index;
+    RecordingIndexEntry m_pendingEntry;     // 最近一个分片的索引项，分片写完后才提交
+    bool m_hasPendingEntry;
+};
+
+#endif // SEGMENTRECORDER_H
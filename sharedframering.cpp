@@ -0,0 +1,167 @@
+#include "sharedframering.h"
+#include <QDebug>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(SharedFrameRing::RingHeader) == 64, "共享内存布局的头部必须为64字节");
+static_assert(sizeof(SharedFrameRing::SlotHeader) == 64, "共享内存布局的槽头部必须为64字节");
+
+SharedFrameRing::SharedFrameRing()
+    : m_base(nullptr)
+    , m_mappedBytes(0)
+    , m_header(nullptr)
+    , m_slotCount(0)
+    , m_slotBytes(0)
+    , m_nextSlot(0)
+    , m_frameCount(0)
+#ifdef Q_OS_WIN
+    , m_mapping(nullptr)
+#endif
+{
+}
+
+SharedFrameRing::~SharedFrameRing()
+{
+    destroy();
+}
+
+bool SharedFrameRing::create(const QString &name, int slotCount, int slotBytes)
+{
+    destroy();
+    if (slotCount < 2 || slotBytes <= 0) {
+        return false;
+    }
+    int alignedSlotBytes = (slotBytes + 63) & ~63;
+    qint64 totalBytes = qint64(sizeof(RingHeader))
+                        + qint64(slotCount) * (qint64(sizeof(SlotHeader)) + alignedSlotBytes);
+
+#ifdef Q_OS_WIN
+    HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        DWORD(quint64(totalBytes) >> 32), DWORD(totalBytes & 0xffffffff),
+                                        reinterpret_cast<LPCWSTR>(name.utf16()));
+    if (!mapping) {
+        qWarning() << "创建共享内存失败:" << name << GetLastError();
+        return false;
+    }
+    void *base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, SIZE_T(totalBytes));
+    if (!base) {
+        qWarning() << "映射共享内存失败:" << name << GetLastError();
+        CloseHandle(mapping);
+        return false;
+    }
+    m_mapping = mapping;
+#else
+    QByteArray shmName = "/" + name.toUtf8();
+    int fd = shm_open(shmName.constData(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+    if (fd < 0) {
+        qWarning() << "创建共享内存失败:" << name << strerror(errno);
+        return false;
+    }
+    if (ftruncate(fd, off_t(totalBytes)) != 0) {
+        qWarning() << "设置共享内存大小失败:" << name << strerror(errno);
+        ::close(fd);
+        shm_unlink(shmName.constData());
+        return false;
+    }
+    void *base = mmap(nullptr, size_t(totalBytes), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        qWarning() << "映射共享内存失败:" << name << strerror(errno);
+        shm_unlink(shmName.constData());
+        return false;
+    }
+#endif
+
+    m_name = name;
+    m_base = static_cast<uchar *>(base);
+    m_mappedBytes = totalBytes;
+    m_slotCount = slotCount;
+    m_slotBytes = alignedSlotBytes;
+    m_nextSlot = 0;
+    m_frameCount = 0;
+
+    // 先写好各槽再写魔数，读者看到魔数时布局已经完整
+    std::memset(m_base, 0, size_t(sizeof(RingHeader)));
+    for (int i = 0; i < slotCount; ++i) {
+        SlotHeader *slot = new (slotHeader(i)) SlotHeader();
+        slot->seq.store(0, std::memory_order_relaxed);
+    }
+    m_header = new (m_base) RingHeader();
+    m_header->version = VERSION;
+    m_header->slotCount = quint32(slotCount);
+    m_header->slotBytes = quint32(alignedSlotBytes);
+    m_header->headerBytes = quint32(sizeof(RingHeader));
+    m_header->slotHeaderBytes = quint32(sizeof(SlotHeader));
+    m_header->closed = 0;
+    m_header->frameCount.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = MAGIC;
+    return true;
+}
+
+void SharedFrameRing::destroy()
+{
+    if (!m_base) {
+        return;
+    }
+    m_header->closed = 1;
+    std::atomic_thread_fence(std::memory_order_release);
+#ifdef Q_OS_WIN
+    UnmapViewOfFile(m_base);
+    CloseHandle(static_cast<HANDLE>(m_mapping));
+    m_mapping = nullptr;
+#else
+    munmap(m_base, size_t(m_mappedBytes));
+    shm_unlink(("/" + m_name.toUtf8()).constData());
+#endif
+    m_base = nullptr;
+    m_header = nullptr;
+    m_mappedBytes = 0;
+}
+
+SharedFrameRing::SlotHeader *SharedFrameRing::slotHeader(int slot) const
+{
+    return reinterpret_cast<SlotHeader *>(m_base + sizeof(RingHeader)
+                                          + qint64(slot) * (qint64(sizeof(SlotHeader)) + m_slotBytes));
+}
+
+uchar *SharedFrameRing::beginWrite(int *slot)
+{
+    if (!m_base) {
+        return nullptr;
+    }
+    *slot = m_nextSlot;
+    SlotHeader *header = slotHeader(*slot);
+    // 奇数表示正在写，读者看到后放弃这一槽
+    header->seq.store(header->seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return reinterpret_cast<uchar *>(header) + sizeof(SlotHeader);
+}
+
+quint64 SharedFrameRing::commit(int slot, const FrameInfo &info)
+{
+    SlotHeader *header = slotHeader(slot);
+    header->frameNumber = ++m_frameCount;
+    header->wallMs = info.wallMs;
+    header->pts = info.pts;
+    header->width = quint32(info.width);
+    header->height = quint32(info.height);
+    header->format = quint32(info.format);
+    header->dataBytes = quint32(info.dataBytes);
+    for (int i = 0; i < 4; ++i) {
+        header->strides[i] = quint32(info.strides[i]);
+    }
+    header->seq.store(header->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    m_header->frameCount.store(m_frameCount, std::memory_order_release);
+    m_nextSlot = (m_nextSlot + 1) % m_slotCount;
+    return m_frameCount;
+}
@@ -0,0 +1,101 @@
+#ifndef SHAREDFRAMERING_H
+#define SHAREDFRAMERING_H
+
+#include <QString>
+#include <QtGlobal>
+#include <atomic>
+
+// 共享内存中的画面环形缓冲，供外部分析进程零拷贝读取
+// Linux等为POSIX共享内存（/dev/shm/<name>），Windows为同名的命名文件映射。布局均为小端：
+//   RingHeader（64字节），之后是slotCount个槽，每个槽为SlotHeader（64字节）加slotBytes字节画面数据。
+// 写入采用顺序锁，写者从不等待读者：写槽前seq变为奇数，写完变为下一个偶数，再更新frameCount。
+// 读者先读seq（为奇数则跳过），直接在映射上使用画面，用完后再读一次seq，不变即有效；
+// 写者按槽轮转，读者有slotCount-1帧的时间处理一个槽。closed非0表示该缓冲已废弃（例如分辨率变大后换了新缓冲）。
+class SharedFrameRing
+{
+public:
+    enum PixelFormat {
+        YUV420P = 0,    // 三个平面，紧密排列
+        RGB24 = 1
+    };
+
+    struct RingHeader
+    {
+        quint32 magic;                      // 'SHFR'
+        quint32 version;
+        quint32 slotCount;
+        quint32 slotBytes;
+        quint32 headerBytes;
+        quint32 slotHeaderBytes;
+        quint32 closed;
+        quint32 reserved0;
+        std::atomic<quint64> frameCount;    // 已写完的帧数，最新一帧在(frameCount-1)%slotCount
+        quint8 reserved[24];
+    };
+
+    struct SlotHeader
+    {
+        std::atomic<quint64> seq;
+        quint64 frameNumber;                // 从1开始
+        qint64 wallMs;
+        qint64 pts;
+        quint32 width;
+        quint32 height;
+        quint32 format;
+        quint32 dataBytes;
+        quint32 strides[4];
+    };
+
+    // 写入一帧时填写的画面信息，seq由环形缓冲维护
+    struct FrameInfo
+    {
+        qint64 wallMs = 0;
+        qint64 pts = 0;
+        int width = 0;
+        int height = 0;
+        PixelFormat format = YUV420P;
+        int dataBytes = 0;
+        int strides[4] = {0, 0, 0, 0};
+    };
+
+    SharedFrameRing();
+    ~SharedFrameRing();
+
+    // 创建（同名已存在时覆盖）并映射，slotBytes按64字节对齐
+    bool create(const QString &name, int slotCount, int slotBytes);
+    // 标记为废弃并解除映射；POSIX下同时删除名字，已映射的读者不受影响
+    void destroy();
+
+    bool isOpen() const { return m_header != nullptr; }
+    QString name() const { return m_name; }
+    int slotCount() const { return m_slotCount; }
+    int slotBytes() const { return m_slotBytes; }
+    quint64 frameCount() const { return m_frameCount; }
+
+    // 开始写下一个槽，返回槽的画面数据区；必须与commit()成对调用
+    uchar *beginWrite(int *slot);
+    // 写完画面后提交，返回该帧的帧号
+    quint64 commit(int slot, const FrameInfo &info);
+
+    static const quint32 MAGIC = 0x52464853;    // "SHFR"
+    static const quint32 VERSION = 1;
+
+private:
+    SlotHeader *slotHeader(int slot) const;
+
+    QString m_name;
+    uchar *m_base;
+    qint64 m_mappedBytes;
+    RingHeader *m_header;
+    int m_slotCount;
+    int m_slotBytes;
+    int m_nextSlot;
+    quint64 m_frameCount;
+#ifdef Q_OS_WIN
+    void *m_mapping;
+#endif
+
+    Q_DISABLE_COPY(SharedFrameRing)
+};
+
+#endif // SHAREDFRAMERING_H
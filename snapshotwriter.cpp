@@ -0,0 +1,223 @@
+#include "snapshotwriter.h"
+#include "frameconverter.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegExp>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QDebug>
+
+extern "C"
+{
+    #include "libavcodec/avcodec.h"
+}
+
+class SnapshotTask : public QRunnable
+{
+public:
+    SnapshotTask(SnapshotWriter *writer, const QString &path, const QImage &frame,
+                 const QSharedPointer<PacketClip> &clip, AVFrame *decoded = nullptr)
+        : m_writer(writer), m_path(path), m_frame(frame), m_clip(clip), m_decoded(decoded) {}
+    ~SnapshotTask() override { av_frame_free(&m_decoded); }
+
+    void run() override
+    {
+        QByteArray data;
+        bool ok = m_decoded ? m_writer->encode(m_decoded, &data)
+                            : (m_clip ? encodeKeyframe(&data) : encodeImage(&data));
+        if (ok) {
+            QDir().mkpath(QFileInfo(m_path).absolutePath());
+            QSaveFile file(m_path);
+            ok = file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+        }
+        m_writer->m_pending.fetch_sub(1);
+        if (!ok) {
+            qWarning() << "截图保存失败:" << m_path;
+        }
+        emit m_writer->saved(m_path, ok);
+    }
+
+private:
+    bool encodeImage(QByteArray *out)
+    {
+        // 直接引用QImage的像素，不转换格式时不产生复制
+        QImage image = m_frame.format() == QImage::Format_RGB888 ? m_frame
+                                                                  : m_frame.convertToFormat(QImage::Format_RGB888);
+        AVFrame *src = av_frame_alloc();
+        if (!src || image.isNull()) {
+            av_frame_free(&src);
+            return false;
+        }
+        src->format = AV_PIX_FMT_RGB24;
+        src->width = image.width();
+        src->height = image.height();
+        src->data[0] = const_cast<uint8_t *>(image.constBits());
+        src->linesize[0] = int(image.bytesPerLine());
+        bool ok = m_writer->encode(src, out);
+        av_frame_free(&src);
+        return ok;
+    }
+
+    bool encodeKeyframe(QByteArray *out)
+    {
+        if (!m_clip->codecpar || m_clip->packets.isEmpty()) {
+            return false;
+        }
+        const AVCodec *codec = avcodec_find_decoder(m_clip->codecpar->codec_id);
+        if (!codec) {
+            return false;
+        }
+        AVCodecContext *codecCtx = avcodec_alloc_context3(codec);
+        AVFrame *frame = av_frame_alloc();
+        bool ok = false;
+        if (codecCtx && frame && avcodec_parameters_to_context(codecCtx, m_clip->codecpar) >= 0) {
+            // 只解一个关键帧，并行度由线程池提供
+            codecCtx->thread_count = 1;
+            if (avcodec_open2(codecCtx, codec, nullptr) >= 0
+                && avcodec_send_packet(codecCtx, m_clip->packets.first()) >= 0
+                && avcodec_send_packet(codecCtx, nullptr) >= 0
+                && avcodec_receive_frame(codecCtx, frame) >= 0) {
+                ok = m_writer->encode(frame, out);
+            }
+        }
+        av_frame_free(&frame);
+        avcodec_free_context(&codecCtx);
+        return ok;
+    }
+
+    SnapshotWriter *m_writer;
+    QString m_path;
+    QImage m_frame;
+    QSharedPointer<PacketClip> m_clip;
+    AVFrame *m_decoded;
+};
+
+SnapshotWriter::SnapshotWriter(const QString &dir, const QString &format, int quality, int threads, QObject *parent)
+    : QObject(parent)
+    , m_dir(dir)
+    , m_png(format.compare("png", Qt::CaseInsensitive) == 0)
+    , m_quality(qBound(1, quality, 100))
+    , m_groupByName(false)
+    , m_maxPending(32)
+    , m_pending(0)
+    , m_dropped(0)
+{
+    m_pool.setMaxThreadCount(qMax(1, threads));
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    // 已经排队的截图仍然写完，避免用户以为保存了却没有文件
+    m_pool.waitForDone();
+}
+
+bool SnapshotWriter::capture(const QString &name, const QImage &frame)
+{
+    if (frame.isNull() || !reserve()) {
+        return false;
+    }
+    m_pool.start(new SnapshotTask(this, nextPath(name, QDateTime::currentMSecsSinceEpoch()), frame,
+                                  QSharedPointer<PacketClip>()));
+    return true;
+}
+
+bool SnapshotWriter::captureKeyframe(const QString &name, const QSharedPointer<PacketClip> &clip)
+{
+    if (!clip || !reserve()) {
+        return false;
+    }
+    m_pool.start(new SnapshotTask(this, nextPath(name, QDateTime::currentMSecsSinceEpoch()), QImage(), clip));
+    return true;
+}
+
+bool SnapshotWriter::captureFrame(const QString &name, const AVFrame *frame, qint64 wallMs)
+{
+    if (!frame || !reserve()) {
+        return false;
+    }
+    AVFrame *ref = av_frame_clone(frame);
+    if (!ref) {
+        m_pending.fetch_sub(1);
+        return false;
+    }
+    m_pool.start(new SnapshotTask(this, nextPath(name, wallMs), QImage(), QSharedPointer<PacketClip>(), ref));
+    return true;
+}
+
+bool SnapshotWriter::reserve()
+{
+    if (m_pending.fetch_add(1) >= m_maxPending) {
+        m_pending.fetch_sub(1);
+        if (m_dropped.fetch_add(1) % 100 == 0) {
+            qDebug() << "截图积压过多，丢弃本次请求，累计丢弃:" << m_dropped.load();
+        }
+        return false;
+    }
+    return true;
+}
+
+QString SnapshotWriter::nextPath(const QString &name, qint64 wallMs) const
+{
+    QString safeName = name;
+    safeName.replace(QRegExp("[\\\\/:*?\"<>|\\s]"), "_");
+    QString time = QDateTime::fromMSecsSinceEpoch(wallMs).toString("yyyyMMdd_hhmmss_zzz");
+    QString suffix = m_png ? "png" : "jpg";
+    if (m_groupByName) {
+        return QDir(m_dir).filePath(QString("%1/%2.%3").arg(safeName, time, suffix));
+    }
+    return QDir(m_dir).filePath(QString("%1_%2.%3").arg(safeName, time, suffix));
+}
+
+bool SnapshotWriter::encode(const AVFrame *src, QByteArray *out) const
+{
+    AVCodecID codecId = m_png ? AV_CODEC_ID_PNG : AV_CODEC_ID_MJPEG;
+    AVPixelFormat dstFormat = m_png ? AV_PIX_FMT_RGB24 : AV_PIX_FMT_YUVJ420P;
+    const AVCodec *codec = avcodec_find_encoder(codecId);
+    if (!codec) {
+        qWarning() << "找不到截图编码器:" << (m_png ? "png" : "mjpeg");
+        return false;
+    }
+
+    AVCodecContext *codecCtx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    AVPacket *pkt = av_packet_alloc();
+    bool ok = false;
+    if (codecCtx && frame && pkt) {
+        // 缩小时宽高取偶数，MJPEG的4:2:0采样不必补边
+        QSize size(src->width, src->height);
+        if (!m_scaledSize.isEmpty() && (size.width() > m_scaledSize.width() || size.height() > m_scaledSize.height())) {
+            size.scale(m_scaledSize, Qt::KeepAspectRatio);
+            size = QSize(qMax(2, size.width() & ~1), qMax(2, size.height() & ~1));
+        }
+        codecCtx->width = size.width();
+        codecCtx->height = size.height();
+        codecCtx->pix_fmt = dstFormat;
+        codecCtx->time_base = AVRational{1, 25};
+        codecCtx->thread_count = 1;
+        if (!m_png) {
+            // quality 100对应qscale 2，1对应31
+            codecCtx->flags |= AV_CODEC_FLAG_QSCALE;
+            codecCtx->global_quality = FF_QP2LAMBDA * (2 + (100 - m_quality) * 29 / 99);
+        }
+        frame->format = dstFormat;
+        frame->width = size.width();
+        frame->height = size.height();
+        if (avcodec_open2(codecCtx, codec, nullptr) >= 0 && av_frame_get_buffer(frame, 0) >= 0) {
+            FrameConverter converter(FrameConverter::Smooth);
+            if (converter.prepare(src, size, dstFormat)) {
+                converter.scale(src, frame->data, frame->linesize);
+                frame->quality = codecCtx->global_quality;
+                frame->pts = 0;
+                if (avcodec_send_frame(codecCtx, frame) >= 0 && avcodec_receive_packet(codecCtx, pkt) >= 0) {
+                    out->append(reinterpret_cast<const char *>(pkt->data), pkt->size);
+                    ok = true;
+                }
+            }
+        }
+    }
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    avcodec_free_context(&codecCtx);
+    return ok;
+}
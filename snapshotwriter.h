@@ -0,0 +1,65 @@
+#ifndef SNAPSHOTWRITER_H
+#define SNAPSHOTWRITER_H
+
+#include <QObject>
+#include <QImage>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include "packetring.h"
+
+struct AVFrame;
+
+// 截图保存
+// 在独立的小线程池中用libavcodec的MJPEG/PNG编码器编码并写盘，调用方只交出画面的引用，
+// 不在GUI线程或解码线程上复制、编码或写文件。积压过多时丢弃新的请求，调用方不会被阻塞。
+class SnapshotWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    // format为jpg或png，quality为1-100，只对jpg有效
+    SnapshotWriter(const QString &dir, const QString &format, int quality, int threads = 2, QObject *parent = nullptr);
+    ~SnapshotWriter();
+
+    // 以下设置需在第一次保存之前调用
+    // 编码前缩小到此尺寸以内，宽或高为0表示保持原尺寸
+    void setScaledSize(const QSize &size) { m_scaledSize = size; }
+    // 每个name使用单独的子目录，文件名只有时间
+    void setGroupByName(bool enabled) { m_groupByName = enabled; }
+    void setMaxPending(int count) { m_maxPending = qMax(1, count); }
+
+    // 保存已解码的画面，QImage隐式共享，不复制像素；积压过多时返回false
+    bool capture(const QString &name, const QImage &frame);
+    // 保存片段的第一个关键帧，用于没有在解码的流（例如只在录像的流）
+    bool captureKeyframe(const QString &name, const QSharedPointer<PacketClip> &clip);
+    // 保存解码器输出的帧，只增加引用；wallMs用于文件名，线程安全
+    bool captureFrame(const QString &name, const AVFrame *frame, qint64 wallMs);
+
+    // 因积压丢弃的请求数
+    quint64 dropped() const { return m_dropped.load(); }
+
+signals:
+    void saved(const QString &path, bool ok);
+
+private:
+    friend class SnapshotTask;
+
+    bool reserve();
+    QString nextPath(const QString &name, qint64 wallMs) const;
+    bool encode(const AVFrame *src, QByteArray *out) const;
+
+    QThreadPool m_pool;
+    QString m_dir;
+    bool m_png;
+    int m_quality;
+    QSize m_scaledSize;
+    bool m_groupByName;
+    int m_maxPending;
+    std::atomic<int> m_pending;
+    std::atomic<quint64> m_dropped;
+};
+
+#endif // SNAPSHOTWRITER_H
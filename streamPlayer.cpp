@@ -1,21 +1,52 @@
 #include "streamPlayer.h"
+#include "frameconverter.h"
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QMetaMethod>
 
 extern "C"
 {
     #include "libavcodec/avcodec.h"
     #include "libavformat/avformat.h"
-    #include "libavutil/pixfmt.h"
-    #include "libswscale/swscale.h"
-    #include <libavutil/imgutils.h>
+}
+
+namespace {
+
+// 自动重连的退避间隔
+const int RECONNECT_MIN_MS = 1000;
+const int RECONNECT_MAX_MS = 30000;
+
+// 一次播放会话用到的FFmpeg资源，离开作用域时统一释放
+struct PlaybackSession
+{
+    AVFormatContext *fmtCtx = nullptr;
+    AVCodecContext *codecCtx = nullptr;
+    AVFrame *frame = nullptr;
+    AVPacket *pkt = nullptr;
+    FrameConverter converter;
+
+    ~PlaybackSession()
+    {
+        av_frame_free(&frame);
+        av_packet_free(&pkt);
+        avcodec_free_context(&codecCtx);
+        avformat_close_input(&fmtCtx);
+    }
+};
+
 }
 
 StreamPlayer::StreamPlayer(const QString &url, QObject *parent)
-    : QThread(parent), streamUrl(url) ,isStop(false){
+    : QThread(parent), streamUrl(url) ,isStop(false), autoReconnect(false), decodeEnabled(true)
+    , ring(nullptr), openedParams(nullptr), openedTimeBase({1, 90000}) {
     avformat_network_init();
 }
 
 StreamPlayer::~StreamPlayer() {
+    delete ring;
+    avcodec_parameters_free(&openedParams);
     avformat_network_deinit();
 }
 
@@ -23,37 +54,113 @@ void StreamPlayer::stop() {
     isStop.store(true);  // 设置停止标志位
 }
 
+void StreamPlayer::setStatsCounters(const QSharedPointer<StreamCounters> &counters) {
+    stats = counters;
+}
+
+void StreamPlayer::enablePacketRing(qint64 durationMs, qint64 maxBytes) {
+    if (ring || durationMs <= 0) {
+        return;
+    }
+    ring = new PacketRing(durationMs, maxBytes);
+    addPacketSink(ring);
+}
+
+void StreamPlayer::setAutoReconnect(bool enabled) {
+    autoReconnect.store(enabled);
+}
+
+void StreamPlayer::setDecodeEnabled(bool enabled) {
+    decodeEnabled.store(enabled);
+}
+
+void StreamPlayer::addPacketSink(PacketSink *sink) {
+    QMutexLocker locker(&sinkMutex);
+    if (sinks.contains(sink)) {
+        return;
+    }
+    sinks.append(sink);
+    // 流已经打开时立即补发参数，后加入的接收者不必等到下一次重连
+    if (openedParams) {
+        sink->streamOpened(openedParams, openedTimeBase);
+    }
+}
+
+void StreamPlayer::removePacketSink(PacketSink *sink) {
+    QMutexLocker locker(&sinkMutex);
+    sinks.removeAll(sink);
+}
+
+void StreamPlayer::addFrameSink(FrameSink *sink) {
+    QMutexLocker locker(&sinkMutex);
+    if (!frameSinks.contains(sink)) {
+        frameSinks.append(sink);
+    }
+}
+
+void StreamPlayer::removeFrameSink(FrameSink *sink) {
+    QMutexLocker locker(&sinkMutex);
+    frameSinks.removeAll(sink);
+}
+
+void StreamPlayer::reportError(int stopCode) {
+    // 自动重连时错误只记日志，由重连循环处理
+    if (!autoReconnect.load()) {
+        emit errorSignal(stopCode);
+    }
+}
+
 void StreamPlayer::run() {
-    AVFormatContext *fmtCtx = nullptr;
-    AVCodecContext *codecCtx = nullptr;
+    int retryMs = RECONNECT_MIN_MS;
+    while (!isStop.load()) {
+        bool streamed = playOnce();
+        if (isStop.load() || !autoReconnect.load()) {
+            break;
+        }
+        
+        // 播放过一段时间后断开的立即按最小间隔重连，连续失败时逐步加大间隔
+        retryMs = streamed ? RECONNECT_MIN_MS : qMin(retryMs * 2, RECONNECT_MAX_MS);
+        qWarning() << "流已断开，" << retryMs << "ms后重连:" << streamUrl;
+        if (stats) {
+            stats->reconnects.fetch_add(1, std::memory_order_relaxed);
+        }
+        for (int waited = 0; waited < retryMs && !isStop.load(); waited += 100) {
+            msleep(100);
+        }
+    }
+    qDebug() << "播放线程安全退出";
+}
+
+bool StreamPlayer::playOnce() {
+    PlaybackSession session;
     const AVCodec *codec = nullptr;
-    AVFrame *frame = nullptr, *rgbFrame = nullptr;
-    AVPacket *pkt = av_packet_alloc();
-    if (!pkt) {
+    session.pkt = av_packet_alloc();
+    if (!session.pkt) {
         qWarning() << "Could not allocate packet";
-        emit errorSignal(2);
-        return;
+        reportError(2);
+        return false;
     }
-    uint8_t *rgbBuffer = nullptr;
-    SwsContext *swsCtx = nullptr;
 
     AVDictionary *opts = nullptr;
-    fmtCtx = avformat_alloc_context();
+    session.fmtCtx = avformat_alloc_context();
     av_dict_set(&opts, "rtsp_transport", "tcp", 0);
     av_dict_set(&opts, "stimeout", "5000000", 0); // 5秒超时
 
-    if (avformat_open_input(&fmtCtx, streamUrl.toStdString().c_str(), nullptr, &opts) < 0) {
+    int ret = avformat_open_input(&session.fmtCtx, streamUrl.toStdString().c_str(), nullptr, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
         qWarning() << "Could not open input";
-        emit errorSignal(1);
-        return;
+        reportError(1);
+        return false;
     }
 
-    if (avformat_find_stream_info(fmtCtx, nullptr) < 0) {
+    if (avformat_find_stream_info(session.fmtCtx, nullptr) < 0) {
         qWarning() << "Could not find stream info";
-        emit errorSignal(3);
-        return;
+        reportError(3);
+        return false;
     }
 
+    AVFormatContext *fmtCtx = session.fmtCtx;
     int videoStreamIndex = -1;
     for (unsigned i = 0; i < fmtCtx->nb_streams; ++i) {
         if (fmtCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
@@ -64,57 +171,148 @@ void StreamPlayer::run() {
             break;
         }
     }
-    if (videoStreamIndex == -1) return;
+    if (videoStreamIndex == -1) return false;
 
     codec = avcodec_find_decoder(fmtCtx->streams[videoStreamIndex]->codecpar->codec_id);
     if(!codec){
         qWarning()<<"decoder not found";
-        emit errorSignal(4);
-        return;
+        reportError(4);
+        return false;
     }
-    codecCtx = avcodec_alloc_context3(codec);
-    if(!codecCtx){
-        qWarning()<<"codecctx is wrong";
-        return;
-    }
-    avcodec_parameters_to_context(codecCtx, fmtCtx->streams[videoStreamIndex]->codecpar);
-    avcodec_open2(codecCtx, codec, nullptr);
-
-    frame = av_frame_alloc();
-    rgbFrame = av_frame_alloc();
-
-    int w = codecCtx->width, h = codecCtx->height;
-    rgbBuffer = (uint8_t *)av_malloc(av_image_get_buffer_size(AV_PIX_FMT_RGB24, w, h, 1));
-    av_image_fill_arrays(rgbFrame->data, rgbFrame->linesize, rgbBuffer, AV_PIX_FMT_RGB24, w, h, 1);
+    
+    // 解码器在第一次需要画面时才创建，只录像、取样的流不占这部分内存和CPU
+    AVPacket *pkt = session.pkt;
+    auto openDecoder = [&]() -> bool {
+        session.codecCtx = avcodec_alloc_context3(codec);
+        if (!session.codecCtx
+            || avcodec_parameters_to_context(session.codecCtx, fmtCtx->streams[videoStreamIndex]->codecpar) < 0
+            || avcodec_open2(session.codecCtx, codec, nullptr) < 0) {
+            qWarning() << "Could not open decoder";
+            avcodec_free_context(&session.codecCtx);
+            reportError(4);
+            return false;
+        }
 
-    swsCtx = sws_getContext(w, h, codecCtx->pix_fmt, w, h, AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
-    if (!swsCtx) {
-        qWarning() << "sws_getContext failed";
-        emit errorSignal(5);
-        return;
+        session.frame = av_frame_alloc();
+        if (!session.frame) {
+            qWarning() << "Could not allocate frame";
+            avcodec_free_context(&session.codecCtx);
+            reportError(2);
+            return false;
+        }
+        return true;
+    };
+    
+    AVStream *videoStream = fmtCtx->streams[videoStreamIndex];
+    {
+        QMutexLocker locker(&sinkMutex);
+        if (!openedParams) {
+            openedParams = avcodec_parameters_alloc();
+        }
+        avcodec_parameters_copy(openedParams, videoStream->codecpar);
+        openedTimeBase = videoStream->time_base;
+        for (PacketSink *sink : sinks) {
+            sink->streamOpened(openedParams, openedTimeBase);
+        }
     }
-    while (!isStop.load()) {
+    
+    // 不解码时（例如只录像）跳过解码器；重新开始解码时从下一个关键帧开始
+    bool decoding = false;
+    bool streamed = false;
+    bool failed = false;
+    while (!isStop.load() && !failed) {
         if (av_read_frame(fmtCtx, pkt) < 0) break;
+        streamed = true;
         if (pkt->stream_index == videoStreamIndex) {
-            if (avcodec_send_packet(codecCtx, pkt) == 0) {
-                while (avcodec_receive_frame(codecCtx, frame) == 0) {
-                    sws_scale(swsCtx, frame->data, frame->linesize, 0, h, rgbFrame->data, rgbFrame->linesize);
-                    QImage img(rgbFrame->data[0], w, h, rgbFrame->linesize[0], QImage::Format_RGB888);
-                    emit frameReady(img.copy());
+            // 压缩包先交给旁路接收者（报警前缓冲、片段导出、录像等），再解码
+            {
+                QMutexLocker locker(&sinkMutex);
+                if (!sinks.isEmpty()) {
+                    qint64 wallMs = QDateTime::currentMSecsSinceEpoch();
+                    for (PacketSink *sink : sinks) {
+                        sink->packetReceived(pkt, wallMs);
+                    }
                 }
             }
+            if (stats && ring) {
+                stats->ringBytes.store(ring->bytes(), std::memory_order_relaxed);
+            }
+            
+            bool wantDecode = decodeEnabled.load();
+            if (wantDecode && !decoding) {
+                if (!(pkt->flags & AV_PKT_FLAG_KEY)) {
+                    av_packet_unref(pkt);
+                    continue;
+                }
+                if (!session.codecCtx && !openDecoder()) {
+                    av_packet_unref(pkt);
+                    break;
+                }
+                avcodec_flush_buffers(session.codecCtx);
+            }
+            decoding = wantDecode;
+            if (!decoding) {
+                av_packet_unref(pkt);
+                continue;
+            }
+            
+            // 解码耗时只计send/receive本身，不含转换、拷贝和分发
+            QElapsedTimer decodeTimer;
+            decodeTimer.start();
+            int sent = avcodec_send_packet(session.codecCtx, pkt);
+            qint64 decodeNs = decodeTimer.nsecsElapsed();
+            quint64 decoded = 0;
+            if (sent == 0) {
+                // 没有人显示时（只有帧总线等使用者）不做RGB转换
+                bool wantImage = isSignalConnected(QMetaMethod::fromSignal(&StreamPlayer::frameReady));
+                for (;;) {
+                    decodeTimer.restart();
+                    int received = avcodec_receive_frame(session.codecCtx, session.frame);
+                    decodeNs += decodeTimer.nsecsElapsed();
+                    if (received != 0) {
+                        break;
+                    }
+                    AVFrame *frame = session.frame;
+                    {
+                        QMutexLocker locker(&sinkMutex);
+                        if (!frameSinks.isEmpty()) {
+                            qint64 wallMs = QDateTime::currentMSecsSinceEpoch();
+                            for (FrameSink *sink : frameSinks) {
+                                sink->frameDecoded(frame, wallMs);
+                            }
+                        }
+                    }
+                    if (wantImage) {
+                        // 直接转换到新图像中，发出后不再拷贝
+                        QImage img = session.converter.toImage(frame);
+                        if (img.isNull()) {
+                            qWarning() << "sws_getContext failed";
+                            reportError(5);
+                            failed = true;
+                            break;
+                        }
+                        emit frameReady(img);
+                    }
+                    ++decoded;
+                }
+            } else if (stats) {
+                stats->drops.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (stats) {
+                stats->frames.fetch_add(decoded, std::memory_order_relaxed);
+                stats->decodeUs.fetch_add(quint64(decodeNs / 1000), std::memory_order_relaxed);
+            }
         }
         av_packet_unref(pkt);
         msleep(0.02);
     }
 
-    // 清理资源
-    av_frame_free(&frame);
-    av_frame_free(&rgbFrame);
-    av_packet_free(&pkt);
-    avcodec_free_context(&codecCtx);
-    avformat_close_input(&fmtCtx);
-    sws_freeContext(swsCtx);
-    av_free(rgbBuffer);
-    qDebug() << "播放线程安全退出";
+    {
+        QMutexLocker locker(&sinkMutex);
+        avcodec_parameters_free(&openedParams);
+        for (PacketSink *sink : sinks) {
+            sink->streamClosed();
+        }
+    }
+    return streamed;
 }
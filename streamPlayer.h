@@ -4,6 +4,12 @@
 #include <QThread>
 #include <QImage>
 #include <QString>
+#include <QSharedPointer>
+#include <QMutex>
+#include <QVector>
+#include "clienttelemetry.h"
+#include "packetring.h"
+#include "framesink.h"
 
 //extern "C" {
 //#include <libavformat/avformat.h>
@@ -18,6 +24,24 @@ public:
     StreamPlayer(const QString &url, QObject *parent = nullptr);
     ~StreamPlayer();
     void stop();
+    // 解码统计写入的计数器，需在start()之前设置
+    void setStatsCounters(const QSharedPointer<StreamCounters> &counters);
+    
+    // 保留最近durationMs的压缩包用于导出报警片段，需在start()之前调用
+    void enablePacketRing(qint64 durationMs, qint64 maxBytes);
+    PacketRing *packetRing() const { return ring; }
+    
+    // 断开或打开失败后按退避间隔重连，此时不发出errorSignal；用于无人值守的录像
+    void setAutoReconnect(bool enabled);
+    // 关闭解码时只解复用并分发压缩包，不占用解码和转换的CPU
+    void setDecodeEnabled(bool enabled);
+    
+    // 线程安全，移除返回后不会再收到回调；流已打开时会立即收到streamOpened
+    void addPacketSink(PacketSink *sink);
+    void removePacketSink(PacketSink *sink);
+    // 解码后的画面，只在解码开启时才有；同样线程安全
+    void addFrameSink(FrameSink *sink);
+    void removeFrameSink(FrameSink *sink);
 
 signals:
     void frameReady(const QImage &img);
@@ -27,8 +51,22 @@ protected:
     void run() override;
 
 private:
+    // 打开并播放一次，直到出错、断流或停止；返回是否读到过数据
+    bool playOnce();
+    void reportError(int stopCode);
+
     QString streamUrl;
     std::atomic<bool> isStop;
+    std::atomic<bool> autoReconnect;
+    std::atomic<bool> decodeEnabled;
+    QSharedPointer<StreamCounters> stats;
+    PacketRing *ring;
+    
+    QMutex sinkMutex;
+    QVector<PacketSink *> sinks;
+    QVector<FrameSink *> frameSinks;
+    AVCodecParameters *openedParams;    // 当前打开的流的参数，未打开时为空
+    AVRational openedTimeBase;
 };
 
 
@@ -0,0 +1,216 @@
+#include "streamcopymuxer.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QDebug>
+
+extern "C"
+{
+    #include "libavcodec/avcodec.h"
+    #include "libavformat/avformat.h"
+    #include "libavutil/mem.h"
+}
+
+namespace {
+
+const int IO_BUFFER_SIZE = 256 * 1024;
+
+}
+
+StreamCopyMuxer::StreamCopyMuxer()
+    : m_output(nullptr)
+    , m_io(nullptr)
+    , m_stream(nullptr)
+    , m_inTimeBase({1, 90000})
+    , m_firstDts(AV_NOPTS_VALUE)
+    , m_lastDts(AV_NOPTS_VALUE)
+    , m_size(0)
+    , m_headerWritten(false)
+{
+}
+
+StreamCopyMuxer::~StreamCopyMuxer()
+{
+    close();
+}
+
+int StreamCopyMuxer::writeCallback(void *opaque, const uint8_t *buf, int size)
+{
+    StreamCopyMuxer *muxer = static_cast<StreamCopyMuxer *>(opaque);
+    qint64 written = muxer->m_file.write(reinterpret_cast<const char *>(buf), size);
+    if (written != size) {
+        return AVERROR(EIO);
+    }
+    muxer->m_size = qMax(muxer->m_size, muxer->m_file.pos());
+    return size;
+}
+
+int64_t StreamCopyMuxer::seekCallback(void *opaque, int64_t offset, int whence)
+{
+    StreamCopyMuxer *muxer = static_cast<StreamCopyMuxer *>(opaque);
+    // 预分配后文件长度不是实际长度，按已写入的长度回答
+    switch (whence & ~AVSEEK_FORCE) {
+    case AVSEEK_SIZE:
+        return muxer->m_size;
+    case SEEK_SET:
+        break;
+    case SEEK_CUR:
+        offset += muxer->m_file.pos();
+        break;
+    case SEEK_END:
+        offset += muxer->m_size;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+    return muxer->m_file.seek(offset) ? offset : AVERROR(EIO);
+}
+
+bool StreamCopyMuxer::open(const QString &path, const AVCodecParameters *codecpar, AVRational timeBase,
+                           bool fragmented, qint64 preallocBytes)
+{
+    close();
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        qWarning() << "无法创建文件:" << path << m_file.errorString();
+        return false;
+    }
+    // 一次性预留空间，减少长时间录像的碎片；失败不影响写入
+    if (preallocBytes > 0) {
+        m_file.resize(preallocBytes);
+    }
+    m_size = 0;
+
+    QByteArray utf8Path = path.toUtf8();
+    if (avformat_alloc_output_context2(&m_output, nullptr, nullptr, utf8Path.constData()) < 0 || !m_output) {
+        qWarning() << "无法创建封装器:" << path;
+        release();
+        return false;
+    }
+
+    m_stream = avformat_new_stream(m_output, nullptr);
+    if (!m_stream || avcodec_parameters_copy(m_stream->codecpar, codecpar) < 0) {
+        release();
+        return false;
+    }
+    // RTSP的codec_tag不一定适用于目标容器，交给封装器重新选择
+    m_stream->codecpar->codec_tag = 0;
+    m_stream->time_base = timeBase;
+    m_inTimeBase = timeBase;
+
+    uint8_t *buffer = static_cast<uint8_t *>(av_malloc(IO_BUFFER_SIZE));
+    m_io = avio_alloc_context(buffer, IO_BUFFER_SIZE, 1, this, nullptr, &StreamCopyMuxer::writeCallback,
+                              &StreamCopyMuxer::seekCallback);
+    if (!m_io) {
+        av_free(buffer);
+        release();
+        return false;
+    }
+    m_output->pb = m_io;
+    m_output->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+    AVDictionary *opts = nullptr;
+    if (fragmented) {
+        av_dict_set(&opts, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+    }
+    int ret = avformat_write_header(m_output, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        qWarning() << "写入文件头失败:" << path;
+        release();
+        return false;
+    }
+    m_headerWritten = true;
+    m_firstDts = AV_NOPTS_VALUE;
+    m_lastDts = AV_NOPTS_VALUE;
+    return true;
+}
+
+bool StreamCopyMuxer::write(const AVPacket *packet)
+{
+    if (!m_output) {
+        return false;
+    }
+    AVPacket *out = av_packet_clone(packet);
+    if (!out) {
+        return false;
+    }
+
+    // 缺失的一项用另一项补齐，都缺失的包无法封装
+    if (out->dts == AV_NOPTS_VALUE) {
+        out->dts = out->pts;
+    }
+    if (out->pts == AV_NOPTS_VALUE) {
+        out->pts = out->dts;
+    }
+    if (out->dts == AV_NOPTS_VALUE) {
+        av_packet_free(&out);
+        return true;
+    }
+    if (m_firstDts == AV_NOPTS_VALUE) {
+        m_firstDts = out->dts;
+    }
+    out->dts -= m_firstDts;
+    out->pts -= m_firstDts;
+
+    // 封装器要求dts严格递增，乱序或重复的包直接丢弃
+    if (m_lastDts != AV_NOPTS_VALUE && out->dts <= m_lastDts) {
+        av_packet_free(&out);
+        return true;
+    }
+    m_lastDts = out->dts;
+
+    av_packet_rescale_ts(out, m_inTimeBase, m_stream->time_base);
+    out->stream_index = m_stream->index;
+    out->pos = -1;
+    // 只有一路流，不需要交织缓冲，写入后position()即为下一个包的位置
+    int ret = av_write_frame(m_output, out);
+    av_packet_free(&out);
+    return ret >= 0;
+}
+
+qint64 StreamCopyMuxer::position() const
+{
+    return m_io ? avio_tell(m_io) : 0;
+}
+
+void StreamCopyMuxer::flush()
+{
+    if (m_io) {
+        avio_flush(m_io);
+        m_file.flush();
+    }
+}
+
+bool StreamCopyMuxer::close()
+{
+    if (!m_output) {
+        release();
+        return false;
+    }
+    bool ok = !m_headerWritten || av_write_trailer(m_output) >= 0;
+    release();
+    return ok;
+}
+
+void StreamCopyMuxer::release()
+{
+    if (m_io) {
+        avio_flush(m_io);
+        av_freep(&m_io->buffer);
+        avio_context_free(&m_io);
+    }
+    if (m_output) {
+        m_output->pb = nullptr;
+        avformat_free_context(m_output);
+        m_output = nullptr;
+    }
+    m_stream = nullptr;
+    m_headerWritten = false;
+    if (m_file.isOpen()) {
+        // 去掉预分配多出的部分
+        m_file.resize(m_size);
+        m_file.close();
+    }
+}
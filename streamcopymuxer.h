@@ -0,0 +1,52 @@
+#ifndef STREAMCOPYMUXER_H
+#define STREAMCOPYMUXER_H
+
+#include <QFile>
+#include <QString>
+#include "packetsink.h"
+
+struct AVFormatContext;
+struct AVIOContext;
+struct AVStream;
+
+// 单路视频的流拷贝封装
+// 输出经自定义AVIO写入QFile，可预先为文件分配空间，关闭时截断到实际长度。
+// 时间戳平移到从0开始，dts不递增的包直接丢弃。只在一个线程中使用。
+class StreamCopyMuxer
+{
+public:
+    StreamCopyMuxer();
+    ~StreamCopyMuxer();
+
+    // 容器格式由扩展名决定；fragmented为true时MP4按关键帧分片写出，进程崩溃也能播放已写入的部分
+    bool open(const QString &path, const AVCodecParameters *codecpar, AVRational timeBase,
+              bool fragmented = false, qint64 preallocBytes = 0);
+    bool write(const AVPacket *packet);
+    // 把AVIO缓冲中的数据交给文件，已写出的分片对其他读者可见
+    void flush();
+    bool close();
+
+    bool isOpen() const { return m_output != nullptr; }
+    QString path() const { return m_file.fileName(); }
+    // 已交给封装器的逻辑字节数（包括AVIO缓冲中尚未落盘的部分）
+    qint64 position() const;
+    // 第一个包的原始dts，未写入时为AV_NOPTS_VALUE
+    qint64 firstDts() const { return m_firstDts; }
+
+private:
+    static int writeCallback(void *opaque, const uint8_t *buf, int size);
+    static int64_t seekCallback(void *opaque, int64_t offset, int whence);
+    void release();
+
+    QFile m_file;
+    AVFormatContext *m_output;
+    AVIOContext *m_io;
+    AVStream *m_stream;
+    AVRational m_inTimeBase;
+    qint64 m_firstDts;
+    qint64 m_lastDts;
+    qint64 m_size;
+    bool m_headerWritten;
+};
+
+#endif // STREAMCOPYMUXER_H
@@ -0,0 +1,104 @@
+#include "streamhub.h"
+#include "streamPlayer.h"
+#include "clienttelemetry.h"
+#include <QDebug>
+
+StreamHub::StreamHub(QObject *parent)
+    : QObject(parent)
+    , m_ringDurationMs(0)
+    , m_ringMaxBytes(0)
+{
+}
+
+StreamHub::~StreamHub()
+{
+    for (auto it = m_players.begin(); it != m_players.end(); ++it) {
+        stopPlayer(it->player);
+        delete it->player;
+    }
+}
+
+void StreamHub::setPacketRing(qint64 durationMs, qint64 maxBytes)
+{
+    m_ringDurationMs = durationMs;
+    m_ringMaxBytes = maxBytes;
+}
+
+StreamPlayer *StreamHub::acquire(const QString &url, const QString &streamId, bool decode, bool reconnect)
+{
+    Entry &entry = m_players[url];
+    if (!entry.player) {
+        entry.player = new StreamPlayer(url);
+        entry.streamId = streamId.isEmpty() ? url : streamId;
+        entry.player->setStatsCounters(StreamStatsRegistry::instance().counters(entry.streamId));
+        entry.player->enablePacketRing(m_ringDurationMs, m_ringMaxBytes);
+    }
+
+    entry.users++;
+    if (decode) {
+        entry.decoders++;
+    }
+    if (reconnect) {
+        entry.reconnectors++;
+    }
+    applyMode(entry);
+
+    if (!entry.player->isRunning()) {
+        entry.player->start();
+        qDebug() << "打开流:" << url << "使用者:" << entry.users;
+    }
+    return entry.player;
+}
+
+void StreamHub::release(StreamPlayer *player, bool decode, bool reconnect)
+{
+    for (auto it = m_players.begin(); it != m_players.end(); ++it) {
+        if (it->player != player) {
+            continue;
+        }
+
+        it->users--;
+        if (decode) {
+            it->decoders--;
+        }
+        if (reconnect) {
+            it->reconnectors--;
+        }
+        if (it->users > 0) {
+            applyMode(*it);
+            return;
+        }
+
+        qDebug() << "关闭流:" << it.key();
+        stopPlayer(player);
+        player->deleteLater();
+        m_players.erase(it);
+        return;
+    }
+}
+
+QList<QPair<QString, StreamPlayer *> > StreamHub::openStreams() const
+{
+    QList<QPair<QString, StreamPlayer *> > streams;
+    for (auto it = m_players.constBegin(); it != m_players.constEnd(); ++it) {
+        streams.append(qMakePair(it->streamId, it->player));
+    }
+    return streams;
+}
+
+void StreamHub::applyMode(Entry &entry)
+{
+    entry.player->setDecodeEnabled(entry.decoders > 0);
+    // 有无人值守的使用者（录像、只订阅画面的导出等）时不能因为一次断流就停下
+    entry.player->setAutoReconnect(entry.reconnectors > 0);
+}
+
+void StreamHub::stopPlayer(StreamPlayer *player)
+{
+    player->stop();
+    // 等待线程结束，设置超时避免无限等待
+    if (!player->wait(3000)) {
+        player->terminate();
+        player->wait();
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef STREAMHUB_H
+#define STREAMHUB_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+class StreamPlayer;
+
+// 按URL共享StreamPlayer
+// 观看、录像等使用者共用同一路RTSP连接和解复用；只要有一个使用者需要画面就解码，
+// 不需要画面时关闭解码。有无人值守的使用者（录像、取样、帧总线订阅等）时自动重连，
+// 只剩观看窗口时断流即报错。只在GUI线程中使用。
+class StreamHub : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StreamHub(QObject *parent = nullptr);
+    ~StreamHub();
+
+    // 报警前缓冲参数，对之后新建的播放器生效
+    void setPacketRing(qint64 durationMs, qint64 maxBytes);
+
+    // 取得（必要时创建并启动）url对应的播放器，decode表示该使用者需要解码后的画面，
+    // reconnect表示该使用者无人值守，断流后需要自动重连而不是报错
+    StreamPlayer *acquire(const QString &url, const QString &streamId, bool decode, bool reconnect = true);
+    // 与acquire成对调用，参数相同；最后一个使用者释放时停止播放器
+    void release(StreamPlayer *player, bool decode, bool reconnect = true);
+
+    int playerCount() const { return m_players.size(); }
+    // 当前打开的全部流，first为流ID（没有ID时为URL）
+    QList<QPair<QString, StreamPlayer *> > openStreams() const;
+
+private:
+    struct Entry
+    {
+        StreamPlayer *player = nullptr;
+        QString streamId;
+        int users = 0;
+        int decoders = 0;
+        int reconnectors = 0;
+    };
+
+    void applyMode(Entry &entry);
+    static void stopPlayer(StreamPlayer *player);
+
+    QHash<QString, Entry> m_players;
+    qint64 m_ringDurationMs;
+    qint64 m_ringMaxBytes;
+};
+
+#endif // STREAMHUB_H
@@ -1,4 +1,5 @@
 #include "streamlistwidget.h"
+#include "msgClient.hpp"
 #include <QMouseEvent>
 #include <QApplication>
 #include <QFont>
@@ -9,6 +10,7 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonParseError>
+#include <QDateTime>
 
 StreamListWidget::StreamListWidget(QWidget *parent)
     : QWidget(parent)
@@ -39,13 +41,36 @@ void StreamListWidget::setupUI()
     m_titleLabel = new QLabel("RTSP流监控列表", this);
     m_titleLabel->setAlignment(Qt::AlignLeft | Qt::AlignVCenter);
     
+    // 创建连接状态标签
+    m_connectionLabel = new QLabel("连接中...", this);
+    m_connectionLabel->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    
     // 创建刷新按钮
     m_refreshButton = new QPushButton("刷新列表", this);
     m_refreshButton->setFixedSize(100, 40);
     connect(m_refreshButton, &QPushButton::clicked, this, &StreamListWidget::onRefreshButtonClicked);
     
+    // 创建报警查询按钮
+    m_searchButton = new QPushButton("报警查询", this);
+    m_searchButton->setFixedSize(100, 40);
+    connect(m_searchButton, &QPushButton::clicked, this, &StreamListWidget::alarmSearchRequested);
+    
+    // 创建多路回放按钮
+    m_playbackButton = new QPushButton("多路回放", this);
+    m_playbackButton->setFixedSize(100, 40);
+    connect(m_playbackButton, &QPushButton::clicked, this, &StreamListWidget::syncPlaybackRequested);
+    
+    // 创建全部截图按钮
+    m_snapshotButton = new QPushButton("全部截图", this);
+    m_snapshotButton->setFixedSize(100, 40);
+    connect(m_snapshotButton, &QPushButton::clicked, this, &StreamListWidget::snapshotAllRequested);
+    
     m_headerLayout->addWidget(m_titleLabel);
     m_headerLayout->addStretch();
+    m_headerLayout->addWidget(m_connectionLabel);
+    m_headerLayout->addWidget(m_snapshotButton);
+    m_headerLayout->addWidget(m_playbackButton);
+    m_headerLayout->addWidget(m_searchButton);
     m_headerLayout->addWidget(m_refreshButton);
     
     m_mainLayout->addLayout(m_headerLayout);
@@ -82,8 +107,17 @@ void StreamListWidget::addRtspStream(const QString &rtspUrl)
             return;
         }
         
+        // 没有ID的流以URL作为ID
+        if (id.isEmpty()) {
+            id = url;
+        }
+        if (m_streamsById.contains(id)) {
+            qDebug() << "流ID已存在，跳过:" << id;
+            return;
+        }
+        
         // 添加到列表
-        addStreamItem(streamName, url, "在线");
+        addStreamItem(id, streamName, url, "在线");
         
         // 添加到已存在URL集合
         m_existingUrls.insert(url);
@@ -103,7 +137,7 @@ void StreamListWidget::addRtspStream(const QString &rtspUrl)
         QString streamName = extractStreamName(rtspUrl);
         
         // 添加到列表
-        addStreamItem(streamName, rtspUrl, "在线");
+        addStreamItem(rtspUrl, streamName, rtspUrl, "在线");
         
         // 添加到已存在URL集合
         m_existingUrls.insert(rtspUrl);
@@ -114,40 +148,7 @@ void StreamListWidget::addRtspStream(const QString &rtspUrl)
 
 bool StreamListWidget::parseJsonStreamInfo(const QString &jsonData, QString &name, QString &url, QString &id)
 {
-    QJsonParseError error;
-    QJsonDocument doc = QJsonDocument::fromJson(jsonData.toUtf8(), &error);
-    
-    if (error.error != QJsonParseError::NoError) {
-        qDebug() << "JSON解析错误:" << error.errorString();
-        return false;
-    }
-    
-    if (!doc.isObject()) {
-        qDebug() << "JSON数据不是对象格式";
-        return false;
-    }
-    
-    QJsonObject obj = doc.object();
-    
-    // 检查必需的字段
-    if (!obj.contains("name") || !obj.contains("url")) {
-        qDebug() << "JSON缺少必需字段 (name 或 url)";
-        return false;
-    }
-    
-    // 提取字段值
-    name = obj["name"].toString();
-    url = obj["url"].toString();
-    id = obj["id"].toString(); // id是可选的
-    
-    // 验证数据有效性
-    if (name.isEmpty() || url.isEmpty()) {
-        qDebug() << "JSON字段值为空";
-        return false;
-    }
-    
-    qDebug() << "JSON解析成功 - 名称:" << name << "URL:" << url << "ID:" << id;
-    return true;
+    return msgClient::parseStreamInfo(jsonData, name, url, id);
 }
 
 void StreamListWidget::clearStreamList()
@@ -160,8 +161,8 @@ void StreamListWidget::clearStreamList()
     // 清空URL集合
     m_existingUrls.clear();
     
-    // 清空ID集合
-    m_existingIds.clear();
+    // 清空ID索引
+    m_streamsById.clear();
     
     qDebug() << "流列表已清空";
 }
@@ -204,7 +205,34 @@ QString StreamListWidget::extractStreamName(const QString &rtspUrl)
     return QString("RTSP流-%1").arg(m_streamList->count() + 1);
 }
 
-void StreamListWidget::addStreamItem(const QString &name, const QString &url, const QString &status)
+bool StreamListWidget::routeAlarm(const AlarmEvent &alarm)
+{
+    auto it = m_streamsById.find(alarm.streamId);
+    if (it == m_streamsById.end()) {
+        return false;
+    }
+    
+    StreamAlarmStats &stats = it->alarms;
+    stats.count++;
+    stats.lastAlarmTime = qMax(stats.lastAlarmTime, alarm.timestamp);
+    stats.lastType = alarm.type;
+    it->widget->setAlarmStats(stats);
+    return true;
+}
+
+StreamAlarmStats StreamListWidget::alarmStats(const QString &streamId) const
+{
+    return m_streamsById.value(streamId).alarms;
+}
+
+void StreamListWidget::setConnectionStatus(const QString &text, bool healthy)
+{
+    m_connectionLabel->setText(text);
+    m_connectionLabel->setStyleSheet(QString("QLabel { color: %1; font-size: 13px; }")
+                                     .arg(healthy ? "#4CAF50" : "#FF5252"));
+}
+
+void StreamListWidget::addStreamItem(const QString &id, const QString &name, const QString &url, const QString &status)
 {
     StreamItemWidget *itemWidget = new StreamItemWidget(name, url, status);
     QListWidgetItem *item = new QListWidgetItem(m_streamList);
@@ -225,10 +253,16 @@ void StreamListWidget::addStreamItem(const QString &name, const QString &url, co
     
     m_streamList->setItemWidget(item, itemWidget);
     
+    StreamEntry entry;
+    entry.widget = itemWidget;
+    m_streamsById.insert(id, entry);
+    
     // 连接点击信号
-    connect(itemWidget, &StreamItemWidget::clicked, [this, name, url]() {
-        emit streamSelected(name, url);
+    connect(itemWidget, &StreamItemWidget::clicked, [this, name, url, id]() {
+        emit streamSelected(name, url, id);
     });
+    
+    emit streamAdded(id, name, url);
 }
 
 void StreamListWidget::applyStyles()
@@ -274,6 +308,28 @@ void StreamListWidget::applyStyles()
         }
     )");
     
+    m_searchButton->setStyleSheet(R"(
+        QPushButton {
+            background-color: #3d3d3d;
+            border: 1px solid #4d4d4d;
+            border-radius: 6px;
+            color: #ffffff;
+            font-size: 14px;
+            font-weight: bold;
+            padding: 8px 16px;
+        }
+        QPushButton:hover {
+            background-color: #4d4d4d;
+            border: 1px solid #5d5d5d;
+        }
+        QPushButton:pressed {
+            background-color: #2d2d2d;
+        }
+    )");
+    
+    m_playbackButton->setStyleSheet(m_searchButton->styleSheet());
+    m_snapshotButton->setStyleSheet(m_searchButton->styleSheet());
+    
     // 设置列表样式
     m_streamList->setStyleSheet(R"(
         QListWidget {
@@ -358,9 +414,20 @@ void StreamItemWidget::setupUI()
     m_statusLabel = new QLabel(m_status, this);
     m_statusLabel->setFont(QFont("Arial", 12, QFont::Bold));
     
+    // 报警统计标签，收到报警前不显示
+    m_alarmLabel = new QLabel(this);
+    m_alarmLabel->setFont(QFont("Arial", 11));
+    m_alarmLabel->hide();
+    
+    QHBoxLayout *statusLayout = new QHBoxLayout();
+    statusLayout->setSpacing(15);
+    statusLayout->addWidget(m_statusLabel);
+    statusLayout->addWidget(m_alarmLabel);
+    statusLayout->addStretch();
+    
     m_infoLayout->addWidget(m_nameLabel);
     m_infoLayout->addWidget(m_urlLabel);
-    m_infoLayout->addWidget(m_statusLabel);
+    m_infoLayout->addLayout(statusLayout);
     
     m_layout->addLayout(m_infoLayout);
     m_layout->addStretch();
@@ -424,6 +491,15 @@ void StreamItemWidget::applyStyles()
         }
     )").arg(statusColor));
     
+    m_alarmLabel->setStyleSheet(R"(
+        QLabel {
+            color: #FF9800;
+            font-size: 11px;
+            background-color: transparent;
+            border: none;
+        }
+    )");
+    
     // 设置箭头颜色
     m_arrowLabel->setStyleSheet(R"(
         QLabel {
@@ -435,6 +511,13 @@ void StreamItemWidget::applyStyles()
     )");
 }
 
+void StreamItemWidget::setAlarmStats(const StreamAlarmStats &stats)
+{
+    QString timeStr = QDateTime::fromMSecsSinceEpoch(stats.lastAlarmTime).toString("hh:mm:ss");
+    m_alarmLabel->setText(QString("报警 %1 次  最近: %2 %3").arg(stats.count).arg(timeStr, stats.lastType));
+    m_alarmLabel->setVisible(stats.count > 0);
+}
+
 void StreamItemWidget::mousePressEvent(QMouseEvent *event)
 {
     if (event->button() == Qt::LeftButton) {
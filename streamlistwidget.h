@@ -13,9 +13,19 @@
 #include <QSet>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QHash>
+#include "alarmevent.h"
 
 class StreamItemWidget;
 
+// 按流ID索引的报警统计
+struct StreamAlarmStats
+{
+    int count = 0;
+    qint64 lastAlarmTime = 0;
+    QString lastType;
+};
+
 class StreamListWidget : public QWidget
 {
     Q_OBJECT
@@ -23,12 +33,24 @@ class StreamListWidget : public QWidget
 public:
     explicit StreamListWidget(QWidget *parent = nullptr);
 
+    // 将报警计入对应流的统计并刷新列表项，未知流返回false
+    bool routeAlarm(const AlarmEvent &alarm);
+    StreamAlarmStats alarmStats(const QString &streamId) const;
+    
+    // 在标题栏显示消息服务器的连接状态
+    void setConnectionStatus(const QString &text, bool healthy);
+
 public slots:
     void addRtspStream(const QString &rtspUrl);
     void clearStreamList();
 
 signals:
-    void streamSelected(const QString &streamName, const QString &streamUrl);
+    void streamSelected(const QString &streamName, const QString &streamUrl, const QString &streamId);
+    void alarmSearchRequested();
+    void syncPlaybackRequested();
+    void snapshotAllRequested();
+    // 列表中新增了一路流
+    void streamAdded(const QString &id, const QString &name, const QString &url);
 
 private slots:
     void onItemClicked(QListWidgetItem *item);
@@ -36,7 +58,7 @@ private slots:
 
 private:
     void setupUI();
-    void addStreamItem(const QString &name, const QString &url, const QString &status = "在线");
+    void addStreamItem(const QString &id, const QString &name, const QString &url, const QString &status = "在线");
     void applyStyles();
     bool parseJsonStreamInfo(const QString &jsonData, QString &name, QString &url, QString &id);
     QString extractStreamName(const QString &rtspUrl);
@@ -44,13 +66,22 @@ private:
     QVBoxLayout *m_mainLayout;
     QHBoxLayout *m_headerLayout;
     QLabel *m_titleLabel;
+    QLabel *m_connectionLabel;
     QPushButton *m_refreshButton;
+    QPushButton *m_searchButton;
+    QPushButton *m_playbackButton;
+    QPushButton *m_snapshotButton;
     QListWidget *m_streamList;
     
     // 用于检查重复的URL集合
     QSet<QString> m_existingUrls;
-    // 用于检查重复的ID集合
-    QSet<QString> m_existingIds;
+    // 流ID -> 列表项及报警统计，既用于去重也用于报警路由
+    struct StreamEntry
+    {
+        StreamItemWidget *widget = nullptr;
+        StreamAlarmStats alarms;
+    };
+    QHash<QString, StreamEntry> m_streamsById;
 
     // 样式常量
     static const int ITEM_HEIGHT = 80;
@@ -67,6 +98,8 @@ public:
 
     QString getName() const { return m_name; }
     QString getUrl() const { return m_url; }
+    
+    void setAlarmStats(const StreamAlarmStats &stats);
 
 protected:
     void mousePressEvent(QMouseEvent *event) override;
@@ -89,6 +122,7 @@ private:
     QLabel *m_nameLabel;
     QLabel *m_urlLabel;
     QLabel *m_statusLabel;
+    QLabel *m_alarmLabel;
     QLabel *m_arrowLabel;
 };
 
@@ -0,0 +1,127 @@
+#include "syncplayback.h"
+#include "recordingplayer.h"
+#include <QDebug>
+
+SyncPlaybackController::SyncPlaybackController(QObject *parent)
+    : QObject(parent)
+    , m_anchorWallMs(0)
+    , m_speed(0)
+    , m_prepareTarget(0)
+    , m_pendingPrepares(0)
+    , m_readyPlayers(0)
+    , m_speedAfterPrepare(0)
+{
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.setInterval(TICK_MS);
+    connect(&m_timer, &QTimer::timeout, this, &SyncPlaybackController::onTick);
+
+    m_prepareTimer.setSingleShot(true);
+    m_prepareTimer.setInterval(PREPARE_TIMEOUT_MS);
+    connect(&m_prepareTimer, &QTimer::timeout, this, &SyncPlaybackController::finishPrepare);
+
+    m_anchorClock.start();
+}
+
+void SyncPlaybackController::addPlayer(RecordingPlayer *player)
+{
+    m_players.append(player);
+    connect(player, &RecordingPlayer::prepared, this, &SyncPlaybackController::onPrepared);
+}
+
+qint64 SyncPlaybackController::position() const
+{
+    return m_anchorWallMs + qint64(m_anchorClock.elapsed() * m_speed);
+}
+
+void SyncPlaybackController::setAnchor(qint64 wallMs)
+{
+    m_anchorWallMs = wallMs;
+    m_anchorClock.restart();
+}
+
+void SyncPlaybackController::present(qint64 wallMs)
+{
+    for (RecordingPlayer *player : m_players) {
+        player->seek(wallMs);
+    }
+    emit positionChanged(wallMs);
+}
+
+void SyncPlaybackController::seek(qint64 wallMs)
+{
+    // 定位期间时钟停住，各路就绪后再按原来的速度继续
+    if (m_pendingPrepares == 0) {
+        m_speedAfterPrepare = m_speed;
+    }
+    m_speed = 0;
+    m_timer.stop();
+    setAnchor(wallMs);
+
+    m_prepareTarget = wallMs;
+    m_pendingPrepares = m_players.size();
+    m_readyPlayers = 0;
+    for (RecordingPlayer *player : m_players) {
+        player->prepare(wallMs);
+    }
+    m_prepareTimer.start();
+    if (m_players.isEmpty()) {
+        finishPrepare();
+    }
+}
+
+void SyncPlaybackController::onPrepared(qint64 wallMs, bool ok)
+{
+    // 已被更新的定位取代
+    if (m_pendingPrepares == 0 || wallMs != m_prepareTarget) {
+        return;
+    }
+    if (ok) {
+        ++m_readyPlayers;
+    }
+    if (--m_pendingPrepares == 0) {
+        finishPrepare();
+    }
+}
+
+void SyncPlaybackController::finishPrepare()
+{
+    m_prepareTimer.stop();
+    if (m_pendingPrepares > 0) {
+        qDebug() << "同步回放定位超时，未就绪路数:" << m_pendingPrepares;
+    }
+    m_pendingPrepares = 0;
+
+    present(m_prepareTarget);
+    emit seekCompleted(m_prepareTarget, m_readyPlayers);
+    play(m_speedAfterPrepare);
+}
+
+void SyncPlaybackController::play(double speed)
+{
+    if (m_pendingPrepares > 0) {
+        m_speedAfterPrepare = speed;
+        return;
+    }
+    setAnchor(position());
+    m_speed = speed;
+    if (speed != 0) {
+        m_timer.start();
+    } else {
+        m_timer.stop();
+    }
+}
+
+void SyncPlaybackController::step(int frames)
+{
+    if (m_pendingPrepares > 0) {
+        return;
+    }
+    play(0);
+    setAnchor(m_anchorWallMs + qint64(frames) * FRAME_STEP_MS);
+    present(m_anchorWallMs);
+}
+
+void SyncPlaybackController::onTick()
+{
+    present(position());
+}
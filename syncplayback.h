@@ -0,0 +1,70 @@
+#ifndef SYNCPLAYBACK_H
+#define SYNCPLAYBACK_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QTimer>
+
+class RecordingPlayer;
+
+// 多路录像的同步回放
+// 一个主时钟按本机时间驱动所有RecordingPlayer，每个时钟周期把同一时间下发给各路，
+// 各路显示该时间之前（含）的最后一帧。定位时先让各路在后台把目标GOP解码好，
+// 全部就绪（或超时）后再同时显示，之后播放中各路都从缓存取帧，相邻GOP提前解码。
+// 只在GUI线程中使用。
+class SyncPlaybackController : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SyncPlaybackController(QObject *parent = nullptr);
+
+    void addPlayer(RecordingPlayer *player);
+
+    qint64 position() const;
+    double speed() const { return m_speed; }
+
+public slots:
+    void seek(qint64 wallMs);
+    // speed为倍速，负数表示倒放，0表示暂停
+    void play(double speed);
+    void pause() { play(0); }
+    // 主时钟按帧间隔前进或后退，同时暂停
+    void step(int frames);
+
+signals:
+    void positionChanged(qint64 wallMs);
+    // 定位后各路都已就绪，ready为就绪的路数
+    void seekCompleted(qint64 wallMs, int ready);
+
+private slots:
+    void onTick();
+    void onPrepared(qint64 wallMs, bool ok);
+
+private:
+    void setAnchor(qint64 wallMs);
+    void present(qint64 wallMs);
+    void finishPrepare();
+
+    QList<RecordingPlayer *> m_players;
+    QTimer m_timer;
+    QTimer m_prepareTimer;
+
+    // 主时钟：m_anchorWallMs + 经过的时间 * m_speed
+    qint64 m_anchorWallMs;
+    QElapsedTimer m_anchorClock;
+    double m_speed;
+
+    // 正在等待各路解码的定位
+    qint64 m_prepareTarget;
+    int m_pendingPrepares;
+    int m_readyPlayers;
+    double m_speedAfterPrepare;
+
+    static const int TICK_MS = 10;
+    static const int FRAME_STEP_MS = 40;        // 逐帧时主时钟的步长，按25fps
+    static const int PREPARE_TIMEOUT_MS = 2000; // 个别路解码过慢时不再等待
+};
+
+#endif // SYNCPLAYBACK_H
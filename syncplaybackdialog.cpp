@@ -0,0 +1,185 @@
+#include "syncplaybackdialog.h"
+#include "syncplayback.h"
+#include "recordingplayer.h"
+#include <QDateTime>
+#include <QPixmap>
+#include <QtMath>
+#include <QDebug>
+
+SyncPlaybackDialog::SyncPlaybackDialog(const QList<QPair<QString, QString> > &streams, qint64 cacheBytes,
+                                       QWidget *parent)
+    : QDialog(parent)
+    , m_controller(new SyncPlaybackController(this))
+{
+    QList<QPair<QString, QString> > tiles = streams.mid(0, MAX_TILES);
+    int count = qMax(1, tiles.size());
+    int columns = qCeil(qSqrt(count));
+    int rows = (count + columns - 1) / columns;
+    QSize tileSize(GRID_WIDTH / columns - 4, GRID_HEIGHT / rows - 4);
+
+    // 缓存上限由各路平分，画面按格子尺寸解码
+    for (int i = 0; i < tiles.size(); ++i) {
+        RecordingPlayer *player = new RecordingPlayer(tiles.at(i).second, cacheBytes / count, this);
+        player->setFrameSize(tileSize);
+        m_players.append(player);
+        m_controller->addPlayer(player);
+    }
+
+    setupUI(tiles);
+    applyStyles();
+
+    for (int i = 0; i < m_players.size(); ++i) {
+        QLabel *tile = m_tiles.at(i);
+        tile->setFixedSize(tileSize);
+        connect(m_players.at(i), &RecordingPlayer::frameReady, tile, [tile](const QImage &img, qint64) {
+            tile->setPixmap(QPixmap::fromImage(img).scaled(tile->size(), Qt::KeepAspectRatio,
+                                                           Qt::FastTransformation));
+        });
+        QString name = tiles.at(i).first;
+        connect(m_players.at(i), &RecordingPlayer::positionUnavailable, tile, [tile, name](qint64) {
+            tile->clear();
+            tile->setText(QString("%1\n没有录像").arg(name));
+        });
+        m_players.at(i)->start();
+    }
+    connect(m_controller, &SyncPlaybackController::positionChanged, this, &SyncPlaybackDialog::onPositionChanged);
+    connect(m_controller, &SyncPlaybackController::seekCompleted, this, [this](qint64 wallMs, int ready) {
+        qDebug() << "同步回放定位:" << QDateTime::fromMSecsSinceEpoch(wallMs) << "就绪:" << ready << "/" << m_players.size();
+    });
+
+    setWindowTitle(QString("多路同步回放 (%1路)").arg(m_players.size()));
+    resize(GRID_WIDTH + 40, GRID_HEIGHT + 160);
+}
+
+SyncPlaybackDialog::~SyncPlaybackDialog()
+{
+    m_controller->pause();
+    for (RecordingPlayer *player : m_players) {
+        player->stop();
+    }
+    for (RecordingPlayer *player : m_players) {
+        player->wait();
+    }
+}
+
+void SyncPlaybackDialog::setupUI(const QList<QPair<QString, QString> > &streams)
+{
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+    mainLayout->setContentsMargins(20, 20, 20, 20);
+    mainLayout->setSpacing(10);
+
+    // 定位时间，默认一分钟前
+    QHBoxLayout *seekLayout = new QHBoxLayout();
+    seekLayout->setSpacing(10);
+    m_timeEdit = new QDateTimeEdit(QDateTime::currentDateTime().addSecs(-60), this);
+    m_timeEdit->setDisplayFormat("yyyy-MM-dd hh:mm:ss");
+    m_timeEdit->setCalendarPopup(true);
+    m_seekButton = new QPushButton("定位", this);
+    m_seekButton->setFixedSize(80, 32);
+    connect(m_seekButton, &QPushButton::clicked, this, &SyncPlaybackDialog::onSeekClicked);
+    seekLayout->addWidget(m_timeEdit, 1);
+    seekLayout->addWidget(m_seekButton);
+    mainLayout->addLayout(seekLayout);
+
+    // 画面网格
+    QGridLayout *grid = new QGridLayout();
+    grid->setSpacing(4);
+    int columns = qCeil(qSqrt(qMax(1, streams.size())));
+    for (int i = 0; i < streams.size(); ++i) {
+        QLabel *tile = new QLabel(streams.at(i).first, this);
+        tile->setAlignment(Qt::AlignCenter);
+        tile->setToolTip(streams.at(i).first);
+        grid->addWidget(tile, i / columns, i % columns);
+        m_tiles.append(tile);
+    }
+    mainLayout->addLayout(grid);
+
+    // 播放控制
+    QHBoxLayout *controlLayout = new QHBoxLayout();
+    controlLayout->setSpacing(10);
+    QPushButton *reverseButton = new QPushButton("◀◀ 倒放", this);
+    QPushButton *stepBackButton = new QPushButton("◀| 上一帧", this);
+    QPushButton *pauseButton = new QPushButton("暂停", this);
+    QPushButton *stepForwardButton = new QPushButton("|▶ 下一帧", this);
+    QPushButton *playButton = new QPushButton("▶ 播放", this);
+    m_speedCombo = new QComboBox(this);
+    m_speedCombo->addItem("0.5x", 0.5);
+    m_speedCombo->addItem("1x", 1.0);
+    m_speedCombo->addItem("2x", 2.0);
+    m_speedCombo->addItem("4x", 4.0);
+    m_speedCombo->setCurrentIndex(1);
+
+    for (QPushButton *button : {reverseButton, stepBackButton, pauseButton, stepForwardButton, playButton}) {
+        button->setFixedHeight(32);
+        controlLayout->addWidget(button);
+    }
+    controlLayout->addWidget(m_speedCombo);
+
+    connect(reverseButton, &QPushButton::clicked, this, [this]() {
+        m_controller->play(-selectedSpeed());
+    });
+    connect(stepBackButton, &QPushButton::clicked, this, [this]() {
+        m_controller->step(-1);
+    });
+    connect(pauseButton, &QPushButton::clicked, m_controller, &SyncPlaybackController::pause);
+    connect(stepForwardButton, &QPushButton::clicked, this, [this]() {
+        m_controller->step(1);
+    });
+    connect(playButton, &QPushButton::clicked, this, [this]() {
+        m_controller->play(selectedSpeed());
+    });
+    mainLayout->addLayout(controlLayout);
+
+    m_statusLabel = new QLabel(this);
+    mainLayout->addWidget(m_statusLabel);
+}
+
+void SyncPlaybackDialog::applyStyles()
+{
+    setStyleSheet(R"(
+        QDialog {
+            background-color: #1e1e1e;
+            color: #ffffff;
+        }
+        QLabel {
+            color: #ffffff;
+        }
+        QDateTimeEdit, QComboBox {
+            background-color: #2d2d2d;
+            border: 1px solid #3d3d3d;
+            border-radius: 4px;
+            color: #ffffff;
+            padding: 4px;
+        }
+        QPushButton {
+            background-color: #3d3d3d;
+            border: 1px solid #4d4d4d;
+            border-radius: 6px;
+            color: #ffffff;
+            font-weight: bold;
+            padding: 4px 12px;
+        }
+        QPushButton:hover {
+            background-color: #4d4d4d;
+        }
+    )");
+    for (QLabel *tile : m_tiles) {
+        tile->setStyleSheet("QLabel { background-color: #000000; border: 1px solid #3d3d3d; }");
+    }
+}
+
+double SyncPlaybackDialog::selectedSpeed() const
+{
+    return m_speedCombo->currentData().toDouble();
+}
+
+void SyncPlaybackDialog::onSeekClicked()
+{
+    m_statusLabel->setText("定位中...");
+    m_controller->seek(m_timeEdit->dateTime().toMSecsSinceEpoch());
+}
+
+void SyncPlaybackDialog::onPositionChanged(qint64 wallMs)
+{
+    m_statusLabel->setText(QDateTime::fromMSecsSinceEpoch(wallMs).toString("yyyy-MM-dd hh:mm:ss.zzz"));
+}
@@ -0,0 +1,53 @@
+#ifndef SYNCPLAYBACKDIALOG_H
+#define SYNCPLAYBACKDIALOG_H
+
+#include <QDialog>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QGridLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QDateTimeEdit>
+#include <QComboBox>
+#include <QPair>
+#include <QList>
+#include <QImage>
+
+class RecordingPlayer;
+class SyncPlaybackController;
+
+// 多路录像同步回放对话框，最多MAX_TILES路，按本机时间对齐
+class SyncPlaybackDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    // streams为(名称, 录像目录)
+    SyncPlaybackDialog(const QList<QPair<QString, QString> > &streams, qint64 cacheBytes, QWidget *parent = nullptr);
+    ~SyncPlaybackDialog();
+
+    static const int MAX_TILES = 9;
+
+private slots:
+    void onSeekClicked();
+    void onPositionChanged(qint64 wallMs);
+
+private:
+    void setupUI(const QList<QPair<QString, QString> > &streams);
+    void applyStyles();
+    double selectedSpeed() const;
+
+    SyncPlaybackController *m_controller;
+    QList<RecordingPlayer *> m_players;
+    QList<QLabel *> m_tiles;
+
+    QDateTimeEdit *m_timeEdit;
+    QPushButton *m_seekButton;
+    QComboBox *m_speedCombo;
+    QLabel *m_statusLabel;
+
+    static const int GRID_WIDTH = 960;
+    static const int GRID_HEIGHT = 540;
+};
+
+#endif // SYNCPLAYBACKDIALOG_H
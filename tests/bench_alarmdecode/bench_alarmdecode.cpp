@@ -0,0 +1,181 @@
+#include <QtTest>
+#include "alarmevent.h"
+
+// 同一条报警分别用JSON和二进制格式解析的耗时
+// 二进制消息按alarmevent.h中的格式说明在测试内编码
+class BenchAlarmDecode : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void binaryMatchesJson();
+    void negativeTimestamp();
+    void storedRoundTrip_data();
+    void storedRoundTrip();
+    void decode_data();
+    void decode();
+
+private:
+    static QByteArray encodeBinary(const AlarmEvent &event, qint64 timestamp);
+    static void appendVarint(QByteArray &out, quint64 value);
+    static void appendZigzag(QByteArray &out, qint64 value);
+
+    AlarmEvent m_event;
+    QByteArray m_json;
+    QByteArray m_binary;
+};
+
+void BenchAlarmDecode::appendVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+void BenchAlarmDecode::appendZigzag(QByteArray &out, qint64 value)
+{
+    appendVarint(out, (quint64(value) << 1) ^ quint64(value >> 63));
+}
+
+QByteArray BenchAlarmDecode::encodeBinary(const AlarmEvent &event, qint64 timestamp)
+{
+    QByteArray out("SHAB");
+    out.append(char(1));
+    out.append(char(0));
+    quint64 ts = quint64(timestamp);
+    for (int i = 0; i < 8; ++i) {
+        out.append(char((ts >> (8 * i)) & 0xFF));
+    }
+
+    // 字符串表去重，序号从1开始
+    QStringList table;
+    auto indexOf = [&](const QString &value) -> quint64 {
+        if (value.isEmpty()) {
+            return 0;
+        }
+        int index = table.indexOf(value);
+        if (index < 0) {
+            table.append(value);
+            index = table.size() - 1;
+        }
+        return quint64(index + 1);
+    };
+    quint64 id = indexOf(event.id);
+    quint64 streamId = indexOf(event.streamId);
+    quint64 type = indexOf(event.type);
+    quint64 msg = indexOf(event.message);
+
+    appendVarint(out, quint64(table.size()));
+    for (const QString &value : table) {
+        QByteArray utf8 = value.toUtf8();
+        appendVarint(out, quint64(utf8.size()));
+        out.append(utf8);
+    }
+    appendVarint(out, id);
+    appendVarint(out, streamId);
+    appendVarint(out, type);
+    appendVarint(out, msg);
+
+    appendVarint(out, quint64(event.boxes.size()));
+    for (const QRect &box : event.boxes) {
+        appendZigzag(out, box.x());
+        appendZigzag(out, box.y());
+        appendZigzag(out, box.width());
+        appendZigzag(out, box.height());
+    }
+    return out;
+}
+
+void BenchAlarmDecode::initTestCase()
+{
+    m_event.id = "cam042-1718000000123";
+    m_event.streamId = "cam042";
+    m_event.type = "intrusion";
+    m_event.timestamp = 1718000000123LL;
+    m_event.boxes << QRect(120, 80, 64, 128) << QRect(400, 220, 96, 180) << QRect(-8, 300, 40, 72);
+    m_event.message = QString::fromUtf8("北门岗亭检测到人员闯入，置信度87");
+
+    // JSON取二进制报警写入报警历史时的形式
+    m_binary = encodeBinary(m_event, m_event.timestamp);
+    m_json = AlarmEvent::fromMessage(m_binary).toJson();
+    qDebug() << "消息大小: JSON" << m_json.size() << "二进制" << m_binary.size();
+}
+
+void BenchAlarmDecode::binaryMatchesJson()
+{
+    AlarmEvent json = AlarmEvent::fromMessage(m_json);
+    AlarmEvent binary = AlarmEvent::fromMessage(m_binary);
+    QVERIFY(!json.binary);
+    QVERIFY(binary.binary);
+    QCOMPARE(binary.id, json.id);
+    QCOMPARE(binary.streamId, json.streamId);
+    QCOMPARE(binary.type, json.type);
+    QCOMPARE(binary.timestamp, json.timestamp);
+    QCOMPARE(binary.boxes, json.boxes);
+    QCOMPARE(binary.message, json.message);
+    QCOMPARE(binary.text, json.text);
+    QCOMPARE(binary.text, QString("intrusion: %1").arg(m_event.message));
+}
+
+void BenchAlarmDecode::negativeTimestamp()
+{
+    // 最高字节置位的时间戳按有符号解释为负数，应改用接收时间
+    qint64 before = QDateTime::currentMSecsSinceEpoch();
+    AlarmEvent event = AlarmEvent::fromMessage(encodeBinary(m_event, -1));
+    QVERIFY(event.binary);
+    QVERIFY(event.timestamp >= before);
+    QCOMPARE(event.id, m_event.id);
+}
+
+void BenchAlarmDecode::storedRoundTrip_data()
+{
+    QTest::addColumn<QString>("type");
+    QTest::addColumn<QString>("message");
+    QTest::newRow("类型和描述") << QString("intrusion") << QString::fromUtf8("检测到人员闯入");
+    QTest::newRow("只有类型") << QString("fire") << QString();
+    QTest::newRow("只有描述") << QString() << QString::fromUtf8("未分类报警");
+}
+
+void BenchAlarmDecode::storedRoundTrip()
+{
+    QFETCH(QString, type);
+    QFETCH(QString, message);
+
+    // 二进制报警以toJson()存入历史，重新加载后显示文本不能变
+    AlarmEvent source = m_event;
+    source.type = type;
+    source.message = message;
+    AlarmEvent received = AlarmEvent::fromMessage(encodeBinary(source, source.timestamp));
+    AlarmEvent reloaded = AlarmEvent::fromMessage(received.toJson());
+    QCOMPARE(reloaded.text, received.text);
+    QCOMPARE(reloaded.message, received.message);
+    QCOMPARE(reloaded.type, received.type);
+}
+
+void BenchAlarmDecode::decode_data()
+{
+    QTest::addColumn<bool>("binary");
+    QTest::newRow("json") << false;
+    QTest::newRow("binary") << true;
+}
+
+void BenchAlarmDecode::decode()
+{
+    QFETCH(bool, binary);
+
+    // 与msgClient一致，输入为引用接收缓冲区的fromRawData
+    const QByteArray &source = binary ? m_binary : m_json;
+    QByteArray data = QByteArray::fromRawData(source.constData(), source.size());
+    AlarmEvent event;
+    QBENCHMARK {
+        event = AlarmEvent::fromMessage(data);
+    }
+    QCOMPARE(event.binary, binary);
+}
+
+QTEST_GUILESS_MAIN(BenchAlarmDecode)
+
+#include "bench_alarmdecode.moc"
@@ -0,0 +1,15 @@
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = bench_alarmdecode
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    bench_alarmdecode.cpp \
+    ../../alarmevent.cpp
+
+HEADERS += \
+    ../../alarmevent.h
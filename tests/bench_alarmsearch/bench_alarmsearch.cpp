@@ -0,0 +1,164 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include "alarmsearchindex.h"
+
+// 报警全文索引的建索引和查询耗时
+// 语料为合成的报警JSON，文档数默认100万，可用环境变量ALARM_BENCH_DOCS调整。
+class BenchAlarmSearch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void buildIndex();
+    void query_data();
+    void query();
+    void commonQueries_data();
+    void commonQueries();
+    void dropBefore();
+
+private:
+    static QVector<AlarmRecord> makeCorpus(int count, quint64 firstId, qint64 firstMs);
+
+    AlarmSearchIndex m_index;
+    int m_docCount = 1000000;
+    qint64 m_firstMs = 0;
+    qint64 m_lastMs = 0;
+
+    // 每条报警相隔约一秒
+    static const int STEP_MS = 1000;
+    // 查询耗时目标，超出时只告警，墙钟时间在繁忙的机器上不可靠
+    static const int QUERY_BUDGET_MS = 50;
+};
+
+QVector<AlarmRecord> BenchAlarmSearch::makeCorpus(int count, quint64 firstId, qint64 firstMs)
+{
+    static const char *const places[] = { "门口", "大厅", "停车场", "仓库", "东侧通道", "北门岗亭", "电梯间", "楼顶" };
+    static const char *const types[] = { "intrusion", "loitering", "fire", "smoke", "helmet", "crowd" };
+    static const char *const details[] = { "检测到人员闯入", "人员长时间逗留", "疑似明火", "烟雾浓度超标",
+                                           "未佩戴安全帽", "人员聚集" };
+
+    QRandomGenerator random(20240601);
+    QVector<AlarmRecord> records;
+    records.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        int place = int(random.bounded(8));
+        int type = int(random.bounded(6));
+        AlarmRecord record;
+        record.id = firstId + quint64(i);
+        record.timestamp = firstMs + qint64(i) * STEP_MS;
+        record.payload = QString("{\"id\":\"cam%1-%2\",\"stream\":\"cam%1\",\"type\":\"%3\",\"msg\":\"%4%5，置信度%6\"}")
+                             .arg(random.bounded(200), 3, 10, QChar('0'))
+                             .arg(record.id)
+                             .arg(types[type])
+                             .arg(places[place])
+                             .arg(details[type])
+                             .arg(random.bounded(50, 100))
+                             .toUtf8();
+        records.append(record);
+    }
+    return records;
+}
+
+void BenchAlarmSearch::initTestCase()
+{
+    bool ok = false;
+    int docs = qEnvironmentVariableIntValue("ALARM_BENCH_DOCS", &ok);
+    if (ok && docs > 0) {
+        m_docCount = docs;
+    }
+    m_firstMs = QDate(2024, 6, 1).startOfDay().toMSecsSinceEpoch();
+    m_lastMs = m_firstMs + qint64(m_docCount - 1) * STEP_MS;
+}
+
+void BenchAlarmSearch::buildIndex()
+{
+    QVector<AlarmRecord> corpus = makeCorpus(m_docCount, 1, m_firstMs);
+
+    // 按写线程提交的批大小增量加入
+    QElapsedTimer timer;
+    timer.start();
+    const int batchSize = 256;
+    for (int i = 0; i < corpus.size(); i += batchSize) {
+        m_index.addRecords(corpus.mid(i, batchSize));
+    }
+    qint64 elapsed = timer.elapsed();
+    qDebug() << "建索引: 文档" << m_docCount << "耗时(ms)" << elapsed
+             << "每秒" << (elapsed > 0 ? qint64(m_docCount) * 1000 / elapsed : 0);
+    QCOMPARE(m_index.documentCount(), m_docCount);
+}
+
+void BenchAlarmSearch::query_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::addColumn<qint64>("rangeMs");
+
+    const qint64 all = qint64(m_docCount) * STEP_MS;
+    const qint64 week = 7LL * 24 * 3600 * 1000;
+    QTest::newRow("门口/全部") << QString("门口") << all;
+    QTest::newRow("门口/最近一周") << QString("门口") << week;
+    QTest::newRow("单字") << QString("门") << all;
+    QTest::newRow("中英混合") << QString("helmet 安全帽") << all;
+    QTest::newRow("多词低频") << QString("北门岗亭 闯入 cam042") << all;
+    QTest::newRow("无结果") << QString("地下室") << all;
+}
+
+void BenchAlarmSearch::query()
+{
+    QFETCH(QString, query);
+    QFETCH(qint64, rangeMs);
+
+    QVector<AlarmSearchHit> hits;
+    QBENCHMARK {
+        hits = m_index.search(query, m_lastMs - rangeMs, m_lastMs, 200);
+    }
+    Q_UNUSED(hits);
+}
+
+void BenchAlarmSearch::commonQueries_data()
+{
+    QTest::addColumn<QString>("query");
+    QTest::newRow("门口") << QString("门口");
+    QTest::newRow("helmet 安全帽") << QString("helmet 安全帽");
+    QTest::newRow("停车场 烟雾") << QString("停车场 烟雾");
+    QTest::newRow("cam007") << QString("cam007");
+}
+
+void BenchAlarmSearch::commonQueries()
+{
+    QFETCH(QString, query);
+
+    // 最常见的查询在全部时间范围内，耗时由QBENCHMARK给出
+    QVector<AlarmSearchHit> hits;
+    QBENCHMARK {
+        hits = m_index.search(query, m_firstMs, m_lastMs, 200);
+    }
+    QVERIFY(hits.size() <= 200);
+
+    QElapsedTimer timer;
+    timer.start();
+    m_index.search(query, m_firstMs, m_lastMs, 200);
+    if (timer.elapsed() > QUERY_BUDGET_MS) {
+        qWarning() << "查询超出目标:" << query << timer.elapsed() << "ms";
+    }
+}
+
+void BenchAlarmSearch::dropBefore()
+{
+    // 淘汰前一半，模拟报警存储删除旧段
+    quint64 half = quint64(m_docCount / 2) + 1;
+    QElapsedTimer timer;
+    timer.start();
+    m_index.dropBefore(half);
+    qDebug() << "淘汰一半文档耗时(ms):" << timer.elapsed();
+    QCOMPARE(m_index.documentCount(), m_docCount - m_docCount / 2);
+
+    QVector<AlarmSearchHit> hits = m_index.search("门口", m_firstMs, m_lastMs, 1000);
+    for (const AlarmSearchHit &hit : hits) {
+        QVERIFY(hit.id >= half);
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchAlarmSearch)
+
+#include "bench_alarmsearch.moc"
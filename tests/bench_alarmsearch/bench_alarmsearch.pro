@@ -0,0 +1,17 @@
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = bench_alarmsearch
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    bench_alarmsearch.cpp \
+    ../../alarmsearchindex.cpp \
+    ../../alarmstore.cpp
+
+HEADERS += \
+    ../../alarmsearchindex.h \
+    ../../alarmstore.h
@@ -0,0 +1,8 @@
+# 单元测试和基准测试，与主程序分开构建：qmake tests/tests.pro && make && make check
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    bench_alarmdecode \
+    bench_alarmsearch \
+    tst_msgclient \
+    tst_recordingindex
@@ -0,0 +1,225 @@
+#include <QtTest>
+#include <QSignalSpy>
+#include "msgClient.hpp"
+#include <zmq.h>
+
+// msgClient多服务器连接、目录合并、报警去重和故障切换
+// 每台"服务器"是本进程内的一对PUB socket，绑定在不同的回环地址上（127.0.0.1、127.0.0.2），
+// 端口与正式服务端相同：5555为流目录，5556为报警。
+class FakeServer
+{
+public:
+    FakeServer(void *context, const QString &ip)
+        : m_catalog(zmq_socket(context, ZMQ_PUB))
+        , m_alarms(zmq_socket(context, ZMQ_PUB))
+    {
+        int linger = 0;
+        zmq_setsockopt(m_catalog, ZMQ_LINGER, &linger, sizeof(linger));
+        zmq_setsockopt(m_alarms, ZMQ_LINGER, &linger, sizeof(linger));
+        m_ok = zmq_bind(m_catalog, qPrintable("tcp://" + ip + ":5555")) == 0
+            && zmq_bind(m_alarms, qPrintable("tcp://" + ip + ":5556")) == 0;
+    }
+
+    ~FakeServer() { close(); }
+
+    bool ok() const { return m_ok; }
+
+    void publishStream(const QByteArray &json)
+    {
+        zmq_send(m_catalog, json.constData(), size_t(json.size()), 0);
+    }
+
+    void publishAlarm(const QByteArray &streamId, const QByteArray &json)
+    {
+        QByteArray topic = msgClient::alarmTopic(QString::fromUtf8(streamId));
+        zmq_send(m_alarms, topic.constData(), size_t(topic.size()), ZMQ_SNDMORE);
+        zmq_send(m_alarms, json.constData(), size_t(json.size()), 0);
+    }
+
+    // 模拟服务器宕机
+    void close()
+    {
+        if (m_catalog) {
+            zmq_close(m_catalog);
+            m_catalog = nullptr;
+        }
+        if (m_alarms) {
+            zmq_close(m_alarms);
+            m_alarms = nullptr;
+        }
+    }
+
+private:
+    void *m_catalog;
+    void *m_alarms;
+    bool m_ok = false;
+};
+
+class TestMsgClient : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void mergesCatalogsFromAllServers();
+    void dedupsAlarmsById();
+    void keepsAlarmsWithoutIdApart();
+    void failsOverWhenServerStops();
+
+private:
+    // 等待客户端与两台服务器的两个通道都连通，并给订阅留出传播时间
+    bool waitForConnections(int servers);
+    static QByteArray alarmJson(const QString &id, const QString &streamId, const QString &type);
+
+    void *m_context = nullptr;
+    FakeServer *m_serverA = nullptr;
+    FakeServer *m_serverB = nullptr;
+    msgClient *m_client = nullptr;
+
+    // 与msgClient的心跳间隔一致
+    static const int HEARTBEAT_IVL_MS = 1000;
+    static const int CONNECT_TIMEOUT_MS = 5000;
+};
+
+void TestMsgClient::initTestCase()
+{
+    qRegisterMetaType<AlarmEvent>("AlarmEvent");
+    m_context = zmq_ctx_new();
+    QVERIFY(m_context);
+}
+
+void TestMsgClient::cleanupTestCase()
+{
+    zmq_ctx_destroy(m_context);
+}
+
+void TestMsgClient::init()
+{
+    m_serverA = new FakeServer(m_context, "127.0.0.1");
+    m_serverB = new FakeServer(m_context, "127.0.0.2");
+    if (!m_serverA->ok() || !m_serverB->ok()) {
+        QSKIP("无法绑定回环地址上的5555/5556端口");
+    }
+    m_client = new msgClient(QStringList() << "127.0.0.1" << "127.0.0.2", false);
+    m_client->start();
+}
+
+void TestMsgClient::cleanup()
+{
+    delete m_client;
+    m_client = nullptr;
+    delete m_serverA;
+    m_serverA = nullptr;
+    delete m_serverB;
+    m_serverB = nullptr;
+}
+
+bool TestMsgClient::waitForConnections(int servers)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (timer.elapsed() < CONNECT_TIMEOUT_MS) {
+        MsgClientStats stats = m_client->stats();
+        if (stats.rtsp_servers == servers && stats.alarm_servers == servers) {
+            QTest::qWait(200);
+            return true;
+        }
+        QTest::qWait(50);
+    }
+    return false;
+}
+
+QByteArray TestMsgClient::alarmJson(const QString &id, const QString &streamId, const QString &type)
+{
+    QJsonObject alarm;
+    if (!id.isEmpty()) {
+        alarm["id"] = id;
+    }
+    alarm["stream_id"] = streamId;
+    alarm["type"] = type;
+    alarm["message"] = "test";
+    return QJsonDocument(alarm).toJson(QJsonDocument::Compact);
+}
+
+void TestMsgClient::mergesCatalogsFromAllServers()
+{
+    QSignalSpy spy(m_client, &msgClient::rtspUrlReceived);
+    QVERIFY(waitForConnections(2));
+
+    m_serverA->publishStream("{\"name\":\"门口\",\"url\":\"rtsp://10.0.0.1/a\",\"id\":\"cam-a\"}");
+    m_serverB->publishStream("{\"name\":\"大厅\",\"url\":\"rtsp://10.0.0.2/b\",\"id\":\"cam-b\"}");
+
+    QTRY_COMPARE_WITH_TIMEOUT(spy.count(), 2, CONNECT_TIMEOUT_MS);
+    QSet<QString> ids;
+    for (const QList<QVariant> &args : spy) {
+        QString name, url, id;
+        QVERIFY(msgClient::parseStreamInfo(args.at(0).toString(), name, url, id));
+        ids.insert(id);
+    }
+    QCOMPARE(ids, QSet<QString>() << "cam-a" << "cam-b");
+}
+
+void TestMsgClient::dedupsAlarmsById()
+{
+    QSignalSpy spy(m_client, &msgClient::alarmReceived);
+    QVERIFY(waitForConnections(2));
+
+    // 两台服务器发布同一批报警，每条只应收到一次
+    for (int i = 0; i < 10; ++i) {
+        QByteArray json = alarmJson(QString("alarm-%1").arg(i), "cam-a", "intrusion");
+        m_serverA->publishAlarm("cam-a", json);
+        m_serverB->publishAlarm("cam-a", json);
+    }
+
+    QTRY_COMPARE_WITH_TIMEOUT(m_client->stats().alarms_received, quint64(20), CONNECT_TIMEOUT_MS);
+    QTRY_COMPARE(spy.count(), 10);
+    QCOMPARE(m_client->stats().alarms_duplicated, quint64(10));
+
+    QSet<QString> ids;
+    for (const QList<QVariant> &args : spy) {
+        ids.insert(args.at(0).value<AlarmEvent>().id);
+    }
+    QCOMPARE(ids.size(), 10);
+}
+
+void TestMsgClient::keepsAlarmsWithoutIdApart()
+{
+    QSignalSpy spy(m_client, &msgClient::alarmReceived);
+    QVERIFY(waitForConnections(2));
+
+    // 没有ID的报警无法判断是否重复，全部放行
+    QByteArray json = alarmJson(QString(), "cam-b", "smoke");
+    m_serverA->publishAlarm("cam-b", json);
+    m_serverB->publishAlarm("cam-b", json);
+
+    QTRY_COMPARE_WITH_TIMEOUT(spy.count(), 2, CONNECT_TIMEOUT_MS);
+    QCOMPARE(m_client->stats().alarms_duplicated, quint64(0));
+}
+
+void TestMsgClient::failsOverWhenServerStops()
+{
+    QSignalSpy spy(m_client, &msgClient::alarmReceived);
+    QVERIFY(waitForConnections(2));
+
+    m_serverA->close();
+    QElapsedTimer timer;
+    timer.start();
+
+    // 另一台服务器的报警不经过任何切换，一个心跳间隔内就能收到
+    m_serverB->publishAlarm("cam-a", alarmJson("after-failover", "cam-a", "intrusion"));
+    QTRY_COMPARE_WITH_TIMEOUT(spy.count(), 1, HEARTBEAT_IVL_MS);
+    QVERIFY(timer.elapsed() <= HEARTBEAT_IVL_MS);
+    QCOMPARE(spy.at(0).at(0).value<AlarmEvent>().id, QString("after-failover"));
+
+    // 断开被监视器发现，连通数降为1
+    QTRY_COMPARE_WITH_TIMEOUT(m_client->stats().alarm_servers, 1, CONNECT_TIMEOUT_MS);
+    QVERIFY(m_client->stats().disconnects >= 1);
+}
+
+QTEST_GUILESS_MAIN(TestMsgClient)
+
+#include "tst_msgclient.moc"
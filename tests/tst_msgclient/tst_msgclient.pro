@@ -0,0 +1,27 @@
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_msgclient
+INCLUDEPATH += $$PWD/../..
+
+INCLUDEPATH += $$PWD/../../zmq/include
+LIBS += -L$$PWD/../../zmq/lib -llibzmq-v140-mt-4_3_4
+win32: LIBS += -lpsapi
+
+SOURCES += \
+    tst_msgclient.cpp \
+    ../../alarmevent.cpp \
+    ../../alarmratelimiter.cpp \
+    ../../alarmrules.cpp \
+    ../../clienttelemetry.cpp \
+    ../../msgClient.cpp
+
+HEADERS += \
+    ../../alarmevent.h \
+    ../../alarmratelimiter.h \
+    ../../alarmrules.h \
+    ../../clienttelemetry.h \
+    ../../msgClient.hpp
@@ -0,0 +1,179 @@
+#include <QtTest>
+#include <QTemporaryDir>
+#include "recordingindex.h"
+
+// 录像索引的按时间定位，以及跳过被录像配额删除的分段
+// 索引按SegmentRecorder的方式写入，分段文件只创建空文件，查询不读取分段内容。
+class TstRecordingIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void findWithinDay();
+    void findBeforeFirstOfDay();
+    void findNextAcrossDays();
+    void keyframes();
+    void skipsDeletedSegment();
+    void skipsDeletedDay();
+
+private:
+    void addSegment(qint64 startMs, int keyframes);
+    bool removeSegment(qint64 startMs);
+
+    QScopedPointer<QTemporaryDir> m_dir;
+    qint64 m_dayStart = 0;
+    qint64 m_t0 = 0;                // 当天第一个分段的开始时间
+    qint64 m_yesterdayMs = 0;       // 前一天最后一个分段的开始时间
+
+    // 每个分段的关键帧间隔、分段间隔
+    static const int KEY_MS = 2000;
+    static const int SEGMENT_MS = 10000;
+    static const int INIT_BYTES = 1000;
+};
+
+void TstRecordingIndex::addSegment(qint64 startMs, int keyframes)
+{
+    QString path = RecordingIndex::segmentPath(m_dir->path(), startMs, 0);
+    QVERIFY(QDir().mkpath(QFileInfo(path).absolutePath()));
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.close();
+
+    RecordingIndex index(m_dir->path());
+    for (int i = 0; i < keyframes; ++i) {
+        RecordingIndexEntry entry;
+        entry.wallMs = startMs + qint64(i) * KEY_MS;
+        entry.segmentStartMs = startMs;
+        entry.offset = INIT_BYTES + qint64(i) * 50000;
+        entry.ptsMs = qint64(i) * KEY_MS;
+        entry.initBytes = INIT_BYTES;
+        entry.suffix = 0;
+        entry.reserved = 0;
+        QVERIFY(index.append(entry));
+    }
+    index.close();
+}
+
+bool TstRecordingIndex::removeSegment(qint64 startMs)
+{
+    return QFile::remove(RecordingIndex::segmentPath(m_dir->path(), startMs, 0));
+}
+
+void TstRecordingIndex::init()
+{
+    m_dir.reset(new QTemporaryDir());
+    QVERIFY(m_dir->isValid());
+    m_dayStart = QDate(2024, 6, 1).startOfDay().toMSecsSinceEpoch();
+    m_t0 = m_dayStart + 10 * 3600 * 1000;
+    m_yesterdayMs = m_dayStart - 60 * 1000;
+
+    // 前一天最后一段，当天三段，每段3个关键帧
+    addSegment(m_yesterdayMs, 3);
+    for (int i = 0; i < 3; ++i) {
+        addSegment(m_t0 + qint64(i) * SEGMENT_MS, 3);
+    }
+}
+
+void TstRecordingIndex::cleanup()
+{
+    m_dir.reset();
+}
+
+void TstRecordingIndex::findWithinDay()
+{
+    RecordingIndex index(m_dir->path());
+    RecordingPosition position;
+
+    // 落在两个关键帧之间取前一个
+    QVERIFY(index.find(m_t0 + SEGMENT_MS + 3000, &position));
+    QCOMPARE(position.keyframeWallMs, m_t0 + SEGMENT_MS + KEY_MS);
+    QCOMPARE(position.path, RecordingIndex::segmentPath(m_dir->path(), m_t0 + SEGMENT_MS, 0));
+    QCOMPARE(position.offset, qint64(INIT_BYTES + 50000));
+    QCOMPARE(position.initBytes, qint64(INIT_BYTES));
+
+    // 正好是关键帧时间
+    QVERIFY(index.find(m_t0 + 2 * SEGMENT_MS, &position));
+    QCOMPARE(position.keyframeWallMs, m_t0 + 2 * SEGMENT_MS);
+}
+
+void TstRecordingIndex::findBeforeFirstOfDay()
+{
+    RecordingIndex index(m_dir->path());
+    RecordingPosition position;
+    QVERIFY(index.find(m_t0 - 1000, &position));
+    QCOMPARE(position.keyframeWallMs, m_yesterdayMs + 2 * KEY_MS);
+
+    // 前一天第一个关键帧之前，再往前没有索引
+    QVERIFY(!index.find(m_yesterdayMs - 1000, &position));
+}
+
+void TstRecordingIndex::findNextAcrossDays()
+{
+    RecordingIndex index(m_dir->path());
+    RecordingPosition position;
+    QVERIFY(index.findNext(m_t0 + 1000, &position));
+    QCOMPARE(position.keyframeWallMs, m_t0 + KEY_MS);
+
+    // 前一天最后一个关键帧之后取当天第一个
+    QVERIFY(index.findNext(m_yesterdayMs + 2 * KEY_MS, &position));
+    QCOMPARE(position.keyframeWallMs, m_t0);
+
+    QVERIFY(!index.findNext(m_t0 + 2 * SEGMENT_MS + 2 * KEY_MS, &position));
+}
+
+void TstRecordingIndex::keyframes()
+{
+    RecordingIndex index(m_dir->path());
+    QVector<RecordingPosition> all = index.keyframes(m_yesterdayMs, m_t0 + 3 * SEGMENT_MS, 0);
+    QCOMPARE(all.size(), 12);
+    for (int i = 1; i < all.size(); ++i) {
+        QVERIFY(all.at(i).keyframeWallMs > all.at(i - 1).keyframeWallMs);
+    }
+
+    // 间隔至少5秒：每段取第一个关键帧和间隔足够的后续关键帧
+    QVector<RecordingPosition> sparse = index.keyframes(m_t0, m_t0 + 3 * SEGMENT_MS, 5000);
+    QCOMPARE(sparse.size(), 3);
+    QCOMPARE(sparse.at(1).keyframeWallMs, m_t0 + SEGMENT_MS);
+}
+
+void TstRecordingIndex::skipsDeletedSegment()
+{
+    // 配额删除中间一段，索引项仍在
+    QVERIFY(removeSegment(m_t0 + SEGMENT_MS));
+    QString deleted = RecordingIndex::segmentPath(m_dir->path(), m_t0 + SEGMENT_MS, 0);
+
+    RecordingIndex index(m_dir->path());
+    RecordingPosition position;
+    QVERIFY(index.find(m_t0 + SEGMENT_MS + 3000, &position));
+    QCOMPARE(position.keyframeWallMs, m_t0 + 2 * KEY_MS);
+
+    QVERIFY(index.findNext(m_t0 + 2 * KEY_MS, &position));
+    QCOMPARE(position.keyframeWallMs, m_t0 + 2 * SEGMENT_MS);
+
+    QVector<RecordingPosition> positions = index.keyframes(m_t0, m_t0 + 3 * SEGMENT_MS, 0);
+    QCOMPARE(positions.size(), 6);
+    for (const RecordingPosition &keyframe : positions) {
+        QVERIFY(keyframe.path != deleted);
+    }
+}
+
+void TstRecordingIndex::skipsDeletedDay()
+{
+    // 当天的分段全部删除但索引还在时，往前一天找
+    for (int i = 0; i < 3; ++i) {
+        QVERIFY(removeSegment(m_t0 + qint64(i) * SEGMENT_MS));
+    }
+    RecordingIndex index(m_dir->path());
+    RecordingPosition position;
+    QVERIFY(index.find(m_t0 + 2 * SEGMENT_MS + 3000, &position));
+    QCOMPARE(position.keyframeWallMs, m_yesterdayMs + 2 * KEY_MS);
+
+    QVERIFY(!index.findNext(m_yesterdayMs + 2 * KEY_MS, &position));
+    QVERIFY(index.keyframes(m_t0, m_t0 + 3 * SEGMENT_MS, 0).isEmpty());
+}
+
+QTEST_GUILESS_MAIN(TstRecordingIndex)
+
+#include "tst_recordingindex.moc"
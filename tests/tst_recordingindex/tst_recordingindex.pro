@@ -0,0 +1,18 @@
+QT       += core testlib
+QT       -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_recordingindex
+INCLUDEPATH += $$PWD/../..
+
+INCLUDEPATH += $$PWD/../../ffmpeg/include
+LIBS += -L$$PWD/../../ffmpeg/lib/ -lavformat -lavcodec -lavutil
+
+SOURCES += \
+    tst_recordingindex.cpp \
+    ../../recordingindex.cpp
+
+HEADERS += \
+    ../../recordingindex.h
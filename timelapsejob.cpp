@@ -0,0 +1,263 @@
+#include "timelapsejob.h"
+#include "frameconverter.h"
+#include "streamcopymuxer.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QtMath>
+#include <QDebug>
+
+extern "C"
+{
+    #include "libavcodec/avcodec.h"
+    #include "libavformat/avformat.h"
+}
+
+class KeyframeTask : public QRunnable
+{
+public:
+    KeyframeTask(const TimelapseJob *job, const RecordingPosition &position, TimelapseJob::Keyframe *keyframe,
+                 double duty)
+        : m_job(job), m_position(position), m_keyframe(keyframe), m_duty(duty) {}
+
+    void run() override
+    {
+        // 批处理让位于播放和录像线程
+        QThread::currentThread()->setPriority(QThread::LowestPriority);
+        QElapsedTimer timer;
+        timer.start();
+        m_job->extract(m_position, m_keyframe);
+        // 按占空比休眠，把每个线程的CPU占用压到预算以内
+        if (m_duty < 1.0) {
+            QThread::msleep(ulong(timer.elapsed() * (1.0 / m_duty - 1.0)));
+        }
+    }
+
+private:
+    const TimelapseJob *m_job;
+    RecordingPosition m_position;
+    TimelapseJob::Keyframe *m_keyframe;
+    double m_duty;
+};
+
+TimelapseJob::TimelapseJob(const QString &streamDir, qint64 fromMs, qint64 toMs, QObject *parent)
+    : QThread(parent)
+    , m_streamDir(streamDir)
+    , m_fromMs(fromMs)
+    , m_toMs(toMs)
+    , m_intervalMs(60 * 1000)
+    , m_thumbWidth(160)
+    , m_columns(20)
+    , m_cpuBudget(1.0)
+    , m_fps(25)
+    , m_cancelled(false)
+{
+}
+
+TimelapseJob::~TimelapseJob()
+{
+    cancel();
+    wait();
+}
+
+void TimelapseJob::setOutputs(const QString &spritePath, const QString &timelapsePath)
+{
+    m_spritePath = spritePath;
+    m_timelapsePath = timelapsePath;
+}
+
+void TimelapseJob::extract(const RecordingPosition &position, Keyframe *keyframe) const
+{
+    keyframe->wallMs = position.keyframeWallMs;
+    RecordingInput input;
+    if (!input.open(position)) {
+        return;
+    }
+    AVFormatContext *fmtCtx = input.context();
+    int streamIndex = av_find_best_stream(fmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (streamIndex < 0) {
+        return;
+    }
+
+    // 拼接后的输入第一个视频包就是关键帧，读到即止
+    AVPacket *pkt = av_packet_alloc();
+    while (pkt && av_read_frame(fmtCtx, pkt) >= 0) {
+        if (pkt->stream_index == streamIndex && (pkt->flags & AV_PKT_FLAG_KEY)) {
+            keyframe->packet = pkt;
+            pkt = nullptr;
+            break;
+        }
+        av_packet_unref(pkt);
+    }
+    av_packet_free(&pkt);
+    if (!keyframe->packet) {
+        return;
+    }
+
+    keyframe->codecpar = avcodec_parameters_alloc();
+    if (keyframe->codecpar) {
+        avcodec_parameters_copy(keyframe->codecpar, fmtCtx->streams[streamIndex]->codecpar);
+    }
+    if (!m_spritePath.isEmpty() && keyframe->codecpar) {
+        keyframe->thumbnail = decodeThumbnail(keyframe->codecpar, keyframe->packet);
+    }
+}
+
+QImage TimelapseJob::decodeThumbnail(const AVCodecParameters *codecpar, const AVPacket *packet) const
+{
+    const AVCodec *codec = avcodec_find_decoder(codecpar->codec_id);
+    if (!codec || codecpar->width <= 0 || codecpar->height <= 0) {
+        return QImage();
+    }
+    AVCodecContext *codecCtx = avcodec_alloc_context3(codec);
+    AVFrame *frame = av_frame_alloc();
+    QImage thumbnail;
+    if (codecCtx && frame && avcodec_parameters_to_context(codecCtx, codecpar) >= 0) {
+        // 每个任务只解一帧，并行度由线程池提供
+        codecCtx->thread_count = 1;
+        codecCtx->skip_frame = AVDISCARD_NONKEY;
+        if (avcodec_open2(codecCtx, codec, nullptr) >= 0
+            && avcodec_send_packet(codecCtx, packet) >= 0
+            && avcodec_send_packet(codecCtx, nullptr) >= 0
+            && avcodec_receive_frame(codecCtx, frame) >= 0) {
+            int height = qMax(2, m_thumbWidth * frame->height / frame->width) & ~1;
+            FrameConverter converter(FrameConverter::Fast);
+            thumbnail = converter.toImage(frame, QSize(m_thumbWidth, height));
+        }
+    }
+    av_frame_free(&frame);
+    avcodec_free_context(&codecCtx);
+    return thumbnail;
+}
+
+bool TimelapseJob::writeSpriteInfo(const QVector<qint64> &times, const QSize &tileSize) const
+{
+    QJsonObject info;
+    info.insert("columns", m_columns);
+    info.insert("tile_width", tileSize.width());
+    info.insert("tile_height", tileSize.height());
+    QJsonArray timeArray;
+    for (qint64 time : times) {
+        timeArray.append(double(time));
+    }
+    info.insert("times", timeArray);
+
+    QFile file(QFileInfo(m_spritePath).absolutePath() + "/" + QFileInfo(m_spritePath).completeBaseName() + ".json");
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return file.write(QJsonDocument(info).toJson(QJsonDocument::Compact)) > 0;
+}
+
+void TimelapseJob::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<RecordingPosition> positions = RecordingIndex(m_streamDir).keyframes(m_fromMs, m_toMs, m_intervalMs);
+    if (positions.isEmpty()) {
+        emit jobFinished(false, "该时间段没有录像");
+        return;
+    }
+
+    int threads = qMax(1, qCeil(m_cpuBudget));
+    double duty = qMin(1.0, m_cpuBudget / threads);
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+
+    StreamCopyMuxer muxer;
+    const AVCodecParameters *timelapseParams = nullptr;
+    AVCodecParameters *firstParams = nullptr;
+    qint64 timelapseFrames = 0;
+    bool muxerFailed = false;
+
+    QImage sprite;
+    QSize tileSize;
+    QVector<qint64> spriteTimes;
+    int total = positions.size();
+
+    for (int start = 0; start < total && !m_cancelled.load(); start += CHUNK_SIZE) {
+        int count = qMin(CHUNK_SIZE, total - start);
+        QVector<Keyframe> chunk(count);
+        for (int i = 0; i < count; ++i) {
+            pool.start(new KeyframeTask(this, positions.at(start + i), &chunk[i], duty));
+        }
+        pool.waitForDone();
+
+        // 按时间顺序写入，结果随即释放，内存只与块大小有关
+        for (Keyframe &keyframe : chunk) {
+            if (!m_spritePath.isEmpty() && !keyframe.thumbnail.isNull()) {
+                if (sprite.isNull()) {
+                    tileSize = keyframe.thumbnail.size();
+                    int rows = (total + m_columns - 1) / m_columns;
+                    sprite = QImage(tileSize.width() * m_columns, tileSize.height() * rows, QImage::Format_RGB888);
+                    sprite.fill(Qt::black);
+                }
+                int tile = spriteTimes.size();
+                QPainter painter(&sprite);
+                painter.drawImage(QRect(QPoint((tile % m_columns) * tileSize.width(), (tile / m_columns) * tileSize.height()),
+                                        tileSize), keyframe.thumbnail);
+                spriteTimes.append(keyframe.wallMs);
+            }
+
+            if (!m_timelapsePath.isEmpty() && keyframe.packet && keyframe.codecpar && !muxerFailed) {
+                if (!timelapseParams) {
+                    firstParams = keyframe.codecpar;
+                    keyframe.codecpar = nullptr;
+                    timelapseParams = firstParams;
+                    muxerFailed = !muxer.open(m_timelapsePath, timelapseParams, AVRational{1, m_fps});
+                }
+                // 分辨率或编码变化的关键帧无法接在同一路流里
+                if (!muxerFailed && (!keyframe.codecpar
+                                     || (keyframe.codecpar->codec_id == timelapseParams->codec_id
+                                         && keyframe.codecpar->width == timelapseParams->width
+                                         && keyframe.codecpar->height == timelapseParams->height))) {
+                    keyframe.packet->pts = keyframe.packet->dts = timelapseFrames++;
+                    keyframe.packet->duration = 1;
+                    if (!muxer.write(keyframe.packet)) {
+                        muxerFailed = true;
+                    }
+                }
+            }
+
+            av_packet_free(&keyframe.packet);
+            avcodec_parameters_free(&keyframe.codecpar);
+        }
+        emit progress(start + count, total);
+    }
+
+    bool ok = !m_cancelled.load();
+    QStringList outputs;
+    if (!m_timelapsePath.isEmpty()) {
+        bool closed = muxer.close();
+        if (ok && closed && !muxerFailed && timelapseFrames > 0) {
+            outputs << m_timelapsePath;
+        } else {
+            ok = false;
+        }
+    }
+    avcodec_parameters_free(&firstParams);
+    if (!m_spritePath.isEmpty()) {
+        QDir().mkpath(QFileInfo(m_spritePath).absolutePath());
+        if (ok && !sprite.isNull() && sprite.save(m_spritePath, nullptr, 85) && writeSpriteInfo(spriteTimes, tileSize)) {
+            outputs << m_spritePath;
+        } else {
+            ok = false;
+        }
+    }
+
+    qDebug() << "延时/缩略图生成:" << m_streamDir << "关键帧:" << total << "耗时(ms):" << timer.elapsed()
+             << (ok ? "完成" : "失败");
+    if (m_cancelled.load()) {
+        emit jobFinished(false, "已取消");
+    } else {
+        emit jobFinished(ok, ok ? outputs.join(", ") : QString("生成失败"));
+    }
+}
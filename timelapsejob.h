@@ -0,0 +1,80 @@
+#ifndef TIMELAPSEJOB_H
+#define TIMELAPSEJOB_H
+
+#include <QThread>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <atomic>
+#include "recordingindex.h"
+
+extern "C"
+{
+    #include "libavutil/rational.h"
+}
+
+struct AVPacket;
+struct AVCodecParameters;
+
+// 由录像生成缩略图条和延时视频
+// 只读取索引中按间隔选出的关键帧：缩略图在线程池上以缩略图尺寸解码，拼成一张精灵图，
+// 旁边的JSON记录每格的时间，供进度条预览使用；延时视频直接把这些关键帧按流拷贝重新排时间戳，
+// 不解码也不编码。解码线程数和占空比受CPU预算限制，不影响实时观看。
+class TimelapseJob : public QThread
+{
+    Q_OBJECT
+public:
+    TimelapseJob(const QString &streamDir, qint64 fromMs, qint64 toMs, QObject *parent = nullptr);
+    ~TimelapseJob();
+
+    // 以下设置需在start()之前调用
+    void setInterval(qint64 ms) { m_intervalMs = qMax<qint64>(1000, ms); }
+    void setThumbnailWidth(int width) { m_thumbWidth = qMax(16, width); }
+    void setColumns(int columns) { m_columns = qMax(1, columns); }
+    // 允许占用的CPU核数，可以是小数
+    void setCpuBudget(double cores) { m_cpuBudget = qMax(0.1, cores); }
+    void setFps(int fps) { m_fps = qMax(1, fps); }
+    // 路径为空表示不生成该项；精灵图的说明写在同名.json中
+    void setOutputs(const QString &spritePath, const QString &timelapsePath);
+
+    void cancel() { m_cancelled.store(true); }
+
+signals:
+    void progress(int done, int total);
+    void jobFinished(bool ok, const QString &message);
+
+protected:
+    void run() override;
+
+private:
+    friend class KeyframeTask;
+
+    struct Keyframe
+    {
+        AVPacket *packet = nullptr;
+        AVCodecParameters *codecpar = nullptr;
+        QImage thumbnail;
+        qint64 wallMs = 0;
+    };
+
+    // 在线程池上执行：取出关键帧，需要时解码为缩略图
+    void extract(const RecordingPosition &position, Keyframe *keyframe) const;
+    QImage decodeThumbnail(const AVCodecParameters *codecpar, const AVPacket *packet) const;
+    bool writeSpriteInfo(const QVector<qint64> &times, const QSize &tileSize) const;
+
+    QString m_streamDir;
+    qint64 m_fromMs;
+    qint64 m_toMs;
+    qint64 m_intervalMs;
+    int m_thumbWidth;
+    int m_columns;
+    double m_cpuBudget;
+    int m_fps;
+    QString m_spritePath;
+    QString m_timelapsePath;
+    std::atomic<bool> m_cancelled;
+
+    static const int CHUNK_SIZE = 32;
+};
+
+#endif // TIMELAPSEJOB_H
@@ -1,18 +1,40 @@
 #include "videoplayerwidget.h"
 #include "streamPlayer.h"
+#include "alarmlogmodel.h"
+#include "alarmsnapshotdecoder.h"
+#include "clipexporter.h"
+#include "streamhub.h"
+#include "instantreplayplayer.h"
+#include "snapshotwriter.h"
 #include <QApplication>
 #include <QFont>
 #include <QDateTime>
 #include <QMessageBox>
 #include <QDebug> // Added for qDebug
+#include <QDir>
+#include <QRegExp>
 
 VideoPlayerWidget::VideoPlayerWidget(QWidget *parent)
     : QWidget(parent)
     , m_streamPlayer(nullptr)
+    , m_alarmModel(new AlarmLogModel(ALARM_HISTORY_LIMIT, this))
+    , m_snapshotDecoder(new AlarmSnapshotDecoder(QSize(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT), 2, this))
+    , m_clipPreMs(10000)
+    , m_clipPostMs(10000)
+    , m_clipFormat("mp4")
+    , m_replayPlayer(nullptr)
+    , m_replayMs(30000)
 {
+    connect(m_snapshotDecoder, &AlarmSnapshotDecoder::decoded,
+            m_alarmModel, &AlarmLogModel::setThumbnail);
+
     setupUI();
     applyStyles();
     
+    m_bufferStatsTimer = new QTimer(this);
+    connect(m_bufferStatsTimer, &QTimer::timeout, this, &VideoPlayerWidget::updateBufferStats);
+    m_bufferStatsTimer->start(1000);
+    
 //    // 初始化报警定时器
 //    m_alarmTimer = new QTimer(this);
 //    connect(m_alarmTimer, &QTimer::timeout, this, &VideoPlayerWidget::updateAlarmInfo);
@@ -25,20 +47,29 @@ VideoPlayerWidget::VideoPlayerWidget(QWidget *parent)
 
 VideoPlayerWidget::~VideoPlayerWidget()
 {
+    stopReplay();
+    
+    // 播放器可能仍被录像使用，片段导出器随本对象销毁，先从播放器上摘下
+    for (auto it = m_clipExporters.constBegin(); it != m_clipExporters.constEnd(); ++it) {
+        if (it.value()) {
+            it.value()->removePacketSink(it.key());
+        }
+    }
+    
     // 确保在析构时停止播放
-    if (m_streamPlayer) {
+    // StreamHub先销毁时播放器已随之释放
+    if (m_streamPlayer && m_streamHub) {
         disconnect(m_streamPlayer, &StreamPlayer::frameReady, this, &VideoPlayerWidget::onFrameReady);
         disconnect(m_streamPlayer, &StreamPlayer::errorSignal, this, &VideoPlayerWidget::onStreamError);
-        
-        m_streamPlayer->stop();
-        if (!m_streamPlayer->wait(1000)) {
-            m_streamPlayer->terminate();
-            m_streamPlayer->wait();
-        }
-        m_streamPlayer->deleteLater();
+        m_streamHub->release(m_streamPlayer, true, false);
     }
 }
 
+void VideoPlayerWidget::setStreamHub(StreamHub *hub)
+{
+    m_streamHub = hub;
+}
+
 void VideoPlayerWidget::setupUI()
 {
     m_mainLayout = new QVBoxLayout(this);
@@ -60,9 +91,35 @@ void VideoPlayerWidget::setupUI()
     m_streamTitleLabel = new QLabel("视频播放", this);
     m_streamTitleLabel->setAlignment(Qt::AlignCenter);
     
+    // 保存片段按钮
+    m_clipButton = new QPushButton("保存片段", this);
+    m_clipButton->setFixedSize(100, 40);
+    connect(m_clipButton, &QPushButton::clicked, this, &VideoPlayerWidget::onClipButtonClicked);
+    
+    // 截图按钮
+    m_snapshotButton = new QPushButton("截图", this);
+    m_snapshotButton->setFixedSize(100, 40);
+    connect(m_snapshotButton, &QPushButton::clicked, this, &VideoPlayerWidget::snapshot);
+    
+    // 即时回看按钮，回看中再次点击返回直播
+    m_replayButton = new QPushButton("即时回看", this);
+    m_replayButton->setFixedSize(100, 40);
+    connect(m_replayButton, &QPushButton::clicked, this, &VideoPlayerWidget::onReplayButtonClicked);
+    
+    // 录像回放按钮
+    m_playbackButton = new QPushButton("录像回放", this);
+    m_playbackButton->setFixedSize(100, 40);
+    connect(m_playbackButton, &QPushButton::clicked, this, [this]() {
+        emit playbackRequested(m_currentStreamName, m_currentStreamUrl, m_currentStreamId);
+    });
+    
     m_topLayout->addWidget(m_backButton);
     m_topLayout->addWidget(m_streamTitleLabel);
     m_topLayout->addStretch();
+    m_topLayout->addWidget(m_snapshotButton);
+    m_topLayout->addWidget(m_replayButton);
+    m_topLayout->addWidget(m_playbackButton);
+    m_topLayout->addWidget(m_clipButton);
     
     m_mainLayout->addWidget(topWidget);
     
@@ -85,7 +142,10 @@ void VideoPlayerWidget::setupUI()
     m_videoDisplayLabel->setText("等待视频流...");
     m_videoDisplayLabel->setStyleSheet("QLabel { background-color: #000000; color: #ffffff; }");
     
+    m_bufferStatsLabel = new QLabel(this);
+    
     m_videoLayout->addWidget(m_videoDisplayLabel);
+    m_videoLayout->addWidget(m_bufferStatsLabel);
     
     m_contentLayout->addWidget(videoContainer);
     
@@ -99,14 +159,22 @@ void VideoPlayerWidget::setupUI()
     m_alarmTitleLabel = new QLabel("报警信息", this);
     m_alarmTitleLabel->setAlignment(Qt::AlignCenter);
     
-    // 报警信息文本框
-    m_alarmTextEdit = new QTextEdit(this);
-    m_alarmTextEdit->setFixedSize(ALARM_WIDTH, 400);
-    m_alarmTextEdit->setReadOnly(true);
-    m_alarmTextEdit->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    // 报警信息列表，只绘制可见行，条目高度统一避免逐行测量
+    m_alarmListView = new QListView(this);
+    m_alarmListView->setModel(m_alarmModel);
+    m_alarmListView->setFixedSize(ALARM_WIDTH, 400);
+    m_alarmListView->setUniformItemSizes(true);
+    m_alarmListView->setIconSize(QSize(THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT));
+    m_alarmModel->setRowHeight(THUMBNAIL_HEIGHT + 4);
+    m_alarmListView->setTextElideMode(Qt::ElideRight);
+    m_alarmListView->setSelectionMode(QAbstractItemView::NoSelection);
+    m_alarmListView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_alarmListView->setFocusPolicy(Qt::NoFocus);
+    m_alarmListView->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    m_alarmListView->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     
     m_alarmLayout->addWidget(m_alarmTitleLabel);
-    m_alarmLayout->addWidget(m_alarmTextEdit);
+    m_alarmLayout->addWidget(m_alarmListView);
     m_alarmLayout->addStretch();
     
     m_contentLayout->addWidget(alarmContainer);
@@ -143,6 +211,11 @@ void VideoPlayerWidget::applyStyles()
             background-color: #2d2d2d;
         }
     )");
+    m_clipButton->setStyleSheet(m_backButton->styleSheet());
+    m_playbackButton->setStyleSheet(m_backButton->styleSheet());
+    m_replayButton->setStyleSheet(m_backButton->styleSheet());
+    m_snapshotButton->setStyleSheet(m_backButton->styleSheet());
+    m_bufferStatsLabel->setStyleSheet("QLabel { color: #aaaaaa; font-size: 12px; }");
     
     m_streamTitleLabel->setStyleSheet(R"(
         QLabel {
@@ -175,8 +248,8 @@ void VideoPlayerWidget::applyStyles()
         }
     )");
     
-    m_alarmTextEdit->setStyleSheet(R"(
-        QTextEdit {
+    m_alarmListView->setStyleSheet(R"(
+        QListView {
             background-color: #2d2d2d;
             border: 1px solid #3d3d3d;
             border-radius: 6px;
@@ -203,10 +276,11 @@ void VideoPlayerWidget::applyStyles()
     )");
 }
 
-void VideoPlayerWidget::playStream(const QString &streamName, const QString &streamUrl)
+void VideoPlayerWidget::playStream(const QString &streamName, const QString &streamUrl, const QString &streamId)
 {
     m_currentStreamName = streamName;
     m_currentStreamUrl = streamUrl;
+    m_currentStreamId = streamId;
     
     // 更新标题
     m_streamTitleLabel->setText(QString("正在播放: %1").arg(streamName));
@@ -218,16 +292,17 @@ void VideoPlayerWidget::playStream(const QString &streamName, const QString &str
     // 停止当前播放
     stopStream();
     
-    // 创建新的FFmpeg播放器
-    m_streamPlayer = new StreamPlayer(streamUrl, this);
+    // 同一路流正在录像时直接共用其连接，只是打开解码
+    if (!m_streamHub) {
+        m_streamHub = new StreamHub(this);
+    }
+    // 观看窗口自己显示断流错误，不要求自动重连
+    m_streamPlayer = m_streamHub->acquire(streamUrl, streamId, true, false);
     
     // 连接信号槽
     connect(m_streamPlayer, &StreamPlayer::frameReady, this, &VideoPlayerWidget::onFrameReady);
     connect(m_streamPlayer, &StreamPlayer::errorSignal, this, &VideoPlayerWidget::onStreamError);
     
-    // 开始播放
-    m_streamPlayer->start();
-    
     // 添加播放开始信息
     addAlarmMessage(QString("开始播放流: %1").arg(streamName));
     addAlarmMessage(QString("流地址: %1").arg(streamUrl));
@@ -235,23 +310,16 @@ void VideoPlayerWidget::playStream(const QString &streamName, const QString &str
 
 void VideoPlayerWidget::stopStream()
 {
+    stopReplay();
     if (m_streamPlayer) {
         // 断开信号槽连接，避免在清理过程中继续接收帧
         disconnect(m_streamPlayer, &StreamPlayer::frameReady, this, &VideoPlayerWidget::onFrameReady);
         disconnect(m_streamPlayer, &StreamPlayer::errorSignal, this, &VideoPlayerWidget::onStreamError);
         
-        // 停止播放器
-        m_streamPlayer->stop();
-        
-        // 等待线程结束，设置超时避免无限等待
-        if (!m_streamPlayer->wait(3000)) { // 等待3秒
-            m_streamPlayer->terminate(); // 强制终止
-            m_streamPlayer->wait(); // 再次等待
-        }
-        
-        // 清理资源
-        m_streamPlayer->deleteLater();
+        // 交还播放器，没有其他使用者时由StreamHub停止并释放
+        m_streamHub->release(m_streamPlayer, true, false);
         m_streamPlayer = nullptr;
+        m_lastFrame = QImage();
         
         // 清空显示
         m_videoDisplayLabel->clear();
@@ -263,10 +331,11 @@ void VideoPlayerWidget::stopStream()
 
 void VideoPlayerWidget::onFrameReady(const QImage &img)
 {
-    // 检查播放器是否还存在，避免在停止过程中继续显示
-    if (!m_streamPlayer) {
+    // 检查播放器是否还存在，避免在停止过程中继续显示；回看时直播照常解码但不显示
+    if (!m_streamPlayer || m_replayPlayer) {
         return;
     }
+    m_lastFrame = img;
     
     // 将QImage转换为QPixmap并显示
     QPixmap pixmap = QPixmap::fromImage(img);
@@ -332,36 +401,182 @@ void VideoPlayerWidget::updateAlarmInfo()
 //    }
 }
 
-void VideoPlayerWidget::addAlarmMessage(const QString &message)
+void VideoPlayerWidget::addAlarmMessage(const QString &message, qint64 timestamp, bool highlight,
+                                        const QByteArray &snapshot)
 {
-    QDateTime currentTime = QDateTime::currentDateTime();
-    QString timeStr = currentTime.toString("hh:mm:ss");
-    QString fullMessage = QString("[%1] %2").arg(timeStr, message);
-    
-    // 获取当前文本
-    QString currentText = m_alarmTextEdit->toPlainText();
-    QStringList lines = currentText.split('\n', QString::SkipEmptyParts);
+    if (timestamp <= 0) {
+        timestamp = QDateTime::currentMSecsSinceEpoch();
+    }
     
-    // 在开头插入新消息
-    lines.prepend(fullMessage);
+    // 新消息插入模型第0行，超出上限时自动淘汰最旧的一条
+    quint64 serial = m_alarmModel->addMessage(message, timestamp, highlight);
     
-    // 限制消息数量，保持最新的50条
-    const int maxMessages = 50;
-    if (lines.size() > maxMessages) {
-        lines = lines.mid(0, maxMessages); // 保留前50条（最新的）
+    // 抓拍图在后台解码，完成后再补到这一行上
+    if (!snapshot.isEmpty()) {
+        m_snapshotDecoder->decode(serial, snapshot);
     }
     
-    // 重新设置文本
-    QString newText = lines.join('\n');
-    if (!newText.isEmpty()) {
-        newText += '\n'; // 确保最后有换行符
+    qDebug() << "添加报警消息:" << message << "当前消息数量:" << m_alarmModel->rowCount();
+}
+
+void VideoPlayerWidget::setAlarmHistoryLimit(int limit)
+{
+    m_alarmModel->setCapacity(limit);
+}
+
+void VideoPlayerWidget::setClipOptions(const QString &dir, int preSeconds, int postSeconds, const QString &format)
+{
+    m_clipDir = dir;
+    m_clipPreMs = qint64(qMax(0, preSeconds)) * 1000;
+    m_clipPostMs = qint64(qMax(0, postSeconds)) * 1000;
+    m_clipFormat = format.isEmpty() ? "mp4" : format;
+}
+
+bool VideoPlayerWidget::saveClip(qint64 wallMs)
+{
+    if (!m_streamPlayer || !m_streamPlayer->packetRing()) {
+        addAlarmMessage("未在播放或未开启报警前缓冲，无法保存片段");
+        return false;
+    }
+    if (!m_clipExporters.isEmpty()) {
+        // 报警密集时不重复导出重叠的片段
+        qDebug() << "报警片段正在导出，忽略本次请求";
+        return false;
+    }
+    if (wallMs <= 0) {
+        wallMs = QDateTime::currentMSecsSinceEpoch();
     }
     
-    // 设置新文本
-    m_alarmTextEdit->setPlainText(newText);
+    QString name = m_currentStreamName;
+    name.replace(QRegExp("[\\\\/:*?\"<>|\\s]"), "_");
+    QString fileName = QString("%1_%2.%3").arg(name, QDateTime::fromMSecsSinceEpoch(wallMs)
+                                                     .toString("yyyyMMdd_hhmmss"), m_clipFormat);
+    
+    // 先注册再取缓冲，中间到达的包不会遗漏
+    ClipExporter *exporter = new ClipExporter(QDir(m_clipDir).filePath(fileName), wallMs + m_clipPostMs, this);
+    StreamPlayer *player = m_streamPlayer;
+    player->addPacketSink(exporter);
+    QSharedPointer<PacketClip> preRoll = player->packetRing()->extract(wallMs - m_clipPreMs);
+    if (!preRoll) {
+        player->removePacketSink(exporter);
+        delete exporter;
+        addAlarmMessage("报警前缓冲为空，无法保存片段");
+        return false;
+    }
+    exporter->setPreRoll(preRoll);
+    
+    connect(exporter, &ClipExporter::exportFinished, this, [this](const QString &path, bool ok) {
+        addAlarmMessage(ok ? QString("片段已保存: %1").arg(path) : QString("片段保存失败: %1").arg(path));
+    });
+    connect(exporter, &QThread::finished, this, [this, exporter]() {
+        // 观看的流可能已经换过，从注册时的播放器上移除；播放器已释放时QPointer为空
+        QPointer<StreamPlayer> owner = m_clipExporters.take(exporter);
+        if (owner) {
+            owner->removePacketSink(exporter);
+        }
+        exporter->deleteLater();
+    });
     
-    // 确保显示最新消息
-    m_alarmTextEdit->moveCursor(QTextCursor::Start);
+    m_clipExporters.insert(exporter, player);
+    exporter->start();
+    return true;
+}
+
+void VideoPlayerWidget::onClipButtonClicked()
+{
+    saveClip();
+}
+
+void VideoPlayerWidget::setReplaySeconds(int seconds)
+{
+    m_replayMs = qint64(qMax(1, seconds)) * 1000;
+}
+
+bool VideoPlayerWidget::startReplay()
+{
+    if (m_replayPlayer) {
+        return true;
+    }
+    if (!m_streamPlayer || !m_streamPlayer->packetRing()) {
+        addAlarmMessage("未在播放或未开启报警前缓冲，无法回看");
+        return false;
+    }
+    QSharedPointer<PacketClip> clip =
+            m_streamPlayer->packetRing()->extract(QDateTime::currentMSecsSinceEpoch() - m_replayMs);
+    if (!clip) {
+        addAlarmMessage("缓冲为空，无法回看");
+        return false;
+    }
     
-    qDebug() << "添加报警消息:" << fullMessage << "当前消息数量:" << lines.size();
-} 
+    // 独立解码器播放取出的片段，直播解码不受影响
+    m_replayPlayer = new InstantReplayPlayer(clip, this);
+    m_replayPlayer->setFrameSize(m_videoDisplayLabel->size());
+    connect(m_replayPlayer, &InstantReplayPlayer::frameReady, this, &VideoPlayerWidget::onReplayFrame);
+    connect(m_replayPlayer, &QThread::finished, this, &VideoPlayerWidget::stopReplay);
+    m_replayPlayer->start();
+    m_replayButton->setText("返回直播");
+    return true;
+}
+
+void VideoPlayerWidget::stopReplay()
+{
+    if (!m_replayPlayer) {
+        return;
+    }
+    disconnect(m_replayPlayer, nullptr, this, nullptr);
+    m_replayPlayer->stop();
+    m_replayPlayer->wait();
+    m_replayPlayer->deleteLater();
+    m_replayPlayer = nullptr;
+    m_replayButton->setText("即时回看");
+}
+
+void VideoPlayerWidget::onReplayButtonClicked()
+{
+    if (m_replayPlayer) {
+        stopReplay();
+    } else {
+        startReplay();
+    }
+}
+
+void VideoPlayerWidget::onReplayFrame(const QImage &img, qint64 wallMs)
+{
+    // 停止回看前已排队的帧不再显示
+    if (!m_replayPlayer) {
+        return;
+    }
+    m_videoDisplayLabel->setPixmap(QPixmap::fromImage(img).scaled(m_videoDisplayLabel->size(), Qt::KeepAspectRatio,
+                                                                  Qt::SmoothTransformation));
+    m_bufferStatsLabel->setText(QString("回看 %1").arg(QDateTime::fromMSecsSinceEpoch(wallMs).toString("hh:mm:ss.zzz")));
+}
+
+void VideoPlayerWidget::updateBufferStats()
+{
+    if (m_replayPlayer) {
+        return;
+    }
+    if (!m_streamPlayer || !m_streamPlayer->packetRing()) {
+        m_bufferStatsLabel->clear();
+        return;
+    }
+    PacketRing *ring = m_streamPlayer->packetRing();
+    m_bufferStatsLabel->setText(QString("回看缓冲 %1 秒 / %2 MB")
+                                    .arg(ring->bufferedMs() / 1000)
+                                    .arg(ring->bytes() / (1024.0 * 1024.0), 0, 'f', 1));
+}
+
+bool VideoPlayerWidget::snapshot()
+{
+    if (!m_snapshotWriter || m_lastFrame.isNull()) {
+        addAlarmMessage("没有可保存的画面");
+        return false;
+    }
+    // 只交出画面的引用，编码和写盘都在后台进行
+    QString name = m_currentStreamId.isEmpty() ? m_currentStreamName : m_currentStreamId;
+    if (!m_snapshotWriter->capture(name, m_lastFrame)) {
+        addAlarmMessage("截图请求过多，本次已忽略");
+        return false;
+    }
+    return true;
+}
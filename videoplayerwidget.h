@@ -6,16 +6,24 @@
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QPushButton>
-#include <QTextEdit>
+#include <QListView>
 #include <QTimer>
 #include <QPropertyAnimation>
 #include <QGraphicsOpacityEffect>
 #include <QFrame>
 #include <QPixmap>
 #include <QImage>
+#include <QHash>
+#include <QPointer>
 
 // 前向声明
 class StreamPlayer;
+class AlarmLogModel;
+class AlarmSnapshotDecoder;
+class ClipExporter;
+class StreamHub;
+class InstantReplayPlayer;
+class SnapshotWriter;
 
 class VideoPlayerWidget : public QWidget
 {
@@ -24,18 +32,48 @@ class VideoPlayerWidget : public QWidget
 public:
     explicit VideoPlayerWidget(QWidget *parent = nullptr);
     ~VideoPlayerWidget();
+    
+    QString currentStreamId() const { return m_currentStreamId; }
+    
+    // 播放器从StreamHub取得，与录像等共用连接；未设置时使用自己的StreamHub
+    void setStreamHub(StreamHub *hub);
+    // 截图由SnapshotWriter在后台编码写盘，未设置时不能截图
+    void setSnapshotWriter(SnapshotWriter *writer) { m_snapshotWriter = writer; }
+    StreamPlayer *currentPlayer() const { return m_streamPlayer; }
 
 public slots:
-    void playStream(const QString &streamName, const QString &streamUrl);
+    void playStream(const QString &streamName, const QString &streamUrl, const QString &streamId = QString());
     void stopStream();
-    void addAlarmMessage(const QString &message);
+    void addAlarmMessage(const QString &message, qint64 timestamp = 0, bool highlight = false,
+                         const QByteArray &snapshot = QByteArray());
+    void setAlarmHistoryLimit(int limit);
+    
+    // 报警片段参数，对之后打开的流生效
+    // 报警前缓冲的时长和内存由StreamHub::setPacketRing设置
+    void setClipOptions(const QString &dir, int preSeconds, int postSeconds, const QString &format);
+    // 导出wallMs前后的片段，wallMs为0表示当前时刻；已有片段在导出时返回false
+    bool saveClip(qint64 wallMs = 0);
+    
+    // 即时回看的时长，缓冲不足时从最早的关键帧开始
+    void setReplaySeconds(int seconds);
+    // 从报警前缓冲回看最近的画面，直播连接不中断；缓冲为空时返回false
+    bool startReplay();
+    void stopReplay();
+    
+    // 保存当前显示的直播画面，不阻塞界面；没有画面时返回false
+    bool snapshot();
 
 signals:
     void backToMain();
+    void playbackRequested(const QString &streamName, const QString &streamUrl, const QString &streamId);
 
 private slots:
     void onBackButtonClicked();
+    void onClipButtonClicked();
+    void onReplayButtonClicked();
     void onFrameReady(const QImage &img);
+    void onReplayFrame(const QImage &img, qint64 wallMs);
+    void updateBufferStats();
     void onStreamError(int stopCode);
     void updateAlarmInfo();
 
@@ -52,28 +90,54 @@ private:
     QHBoxLayout *m_topLayout;
     QPushButton *m_backButton;
     QLabel *m_streamTitleLabel;
+    QPushButton *m_clipButton;
+    QPushButton *m_playbackButton;
+    QPushButton *m_replayButton;
+    QPushButton *m_snapshotButton;
     
     // 内容区域
     QVBoxLayout *m_videoLayout;
     QLabel *m_videoDisplayLabel;  // 替换QVideoWidget，用于显示QImage
+    QLabel *m_bufferStatsLabel;   // 压缩包缓冲的时长和内存占用
+    QTimer *m_bufferStatsTimer;
     StreamPlayer *m_streamPlayer; // FFmpeg播放器
+    QPointer<StreamHub> m_streamHub;
+    QImage m_lastFrame;           // 最近一帧直播画面，与显示共享像素
+    QPointer<SnapshotWriter> m_snapshotWriter;
     
     // 右侧报警信息区域
     QVBoxLayout *m_alarmLayout;
     QLabel *m_alarmTitleLabel;
-    QTextEdit *m_alarmTextEdit;
+    QListView *m_alarmListView;
+    AlarmLogModel *m_alarmModel;
+    AlarmSnapshotDecoder *m_snapshotDecoder;
     
     // 定时器用于模拟报警信息
     QTimer *m_alarmTimer;
     
+    // 报警片段
+    QString m_clipDir;
+    qint64 m_clipPreMs;
+    qint64 m_clipPostMs;
+    QString m_clipFormat;
+    QHash<ClipExporter *, QPointer<StreamPlayer> > m_clipExporters;   // 导出器 -> 注册的播放器
+    
+    // 即时回看，回看期间不显示直播画面
+    InstantReplayPlayer *m_replayPlayer;
+    qint64 m_replayMs;
+    
     // 当前播放的流信息
     QString m_currentStreamName;
     QString m_currentStreamUrl;
+    QString m_currentStreamId;
     
     // 样式常量
     static const int VIDEO_WIDTH = 800;
     static const int ALARM_WIDTH = 200;
     static const int TOP_HEIGHT = 60;
+    static const int ALARM_HISTORY_LIMIT = 2000; // 默认保留的报警条数
+    static const int THUMBNAIL_WIDTH = 48;       // 报警抓拍缩略图尺寸
+    static const int THUMBNAIL_HEIGHT = 27;
 };
 
 #endif // VIDEOPLAYERWIDGET_H 